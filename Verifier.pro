@@ -24,15 +24,93 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 QMAKE_CXXFLAGS += -std=c++17
 
+LIBS += -lz
+
+unix:!macx: LIBS += -lrt
+
+# catalogrules.inc is generated from data/ by tools/rulegen, "make rules"
+# regenerates it. Pass RULEGEN=<path> to qmake when rulegen is not on PATH.
+isEmpty(RULEGEN): RULEGEN = rulegen
+
+rules.commands = $$RULEGEN $$PWD/data $$PWD/catalogrules.inc
+QMAKE_EXTRA_TARGETS += rules
+
+# scheme.dict, the preset dictionary of compressed schemes, is trained by
+# tools/schemedict on legacy and compact schemes that tools/schemegen
+# places from data/; "make dictionary" retrains it. Schemes compressed
+# with the previous one can only be read with that one.
+isEmpty(SCHEMEGEN):  SCHEMEGEN  = schemegen
+isEmpty(SCHEMEDICT): SCHEMEDICT = schemedict
+
+DICT_SAMPLES = $$OUT_PWD/dict_samples
+
+dictionary.commands = mkdir -p $$DICT_SAMPLES
+for(seed, $$list(1 2 3)) {
+    dictionary.commands += && $$SCHEMEGEN scheme --catalog $$PWD/data --out $$DICT_SAMPLES/legacy$${seed}.sch --nodes 2000 --seed $$seed
+    dictionary.commands += && $$SCHEMEGEN scheme --catalog $$PWD/data --out $$DICT_SAMPLES/compact$${seed}.sch --nodes 2000 --seed $$seed --compact
+}
+dictionary.commands += && $$SCHEMEDICT --out $$PWD/scheme.dict $$DICT_SAMPLES/*.sch
+QMAKE_EXTRA_TARGETS += dictionary
+
+# The application looks for data/ and scheme.dict in the parent of its
+# working directory, "make install" lays them out that way under PREFIX
+isEmpty(PREFIX): PREFIX = /opt/Verifier
+
+target.path         = $$PREFIX/bin
+catalog.files       = data
+catalog.path        = $$PREFIX
+scheme_dict.files   = scheme.dict
+scheme_dict.path    = $$PREFIX
+INSTALLS += target catalog scheme_dict
+
 SOURCES += \
         main.cpp \
         mainwindow.cpp \
     sgraphicsview.cpp \
+    portreach.cpp \
+    rule.cpp \
+    catalogrules.cpp \
+    autocomplete.cpp \
+    explorer.cpp \
+    bindall.cpp \
+    undo.cpp \
+    power.cpp \
+    components.cpp \
+    schemeio.cpp \
+    schemediff.cpp \
+    schemesnapshot.cpp \
+    schemecompress.cpp \
+    bom.cpp \
+    arenascheme.cpp \
+    schemeview.cpp \
+    catalog.cpp \
+    profiler.cpp \
+    spatial.cpp \
     LibBoolEE/LibBoolEE.cpp
 
 HEADERS += \
         mainwindow.h \
     sgraphicsview.h \
+    scheme.h \
+    portreach.h \
+    rule.h \
+    catalogrules.h \
+    autocomplete.h \
+    explorer.h \
+    bindall.h \
+    undo.h \
+    power.h \
+    components.h \
+    schemeio.h \
+    schemediff.h \
+    schemesnapshot.h \
+    schemecompress.h \
+    bom.h \
+    arenascheme.h \
+    schemeview.h \
+    catalog.h \
+    profiler.h \
+    spatial.h \
     LibBoolEE/LibBoolEE.h
 
 FORMS += \
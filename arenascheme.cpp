@@ -0,0 +1,123 @@
+#include "arenascheme.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "nop/utility/fd_reader.h"
+
+#include "schemecompress.h"
+#include "profiler.h"
+
+//----------------------------------------------------------------------
+// The decoded scheme takes about three times the file size, compressed
+// files inflate to about twice theirs
+static const size_t arena_per_file_byte         = 3;
+static const size_t arena_per_compressed_byte   = 6;
+static const size_t min_arena           = 64 * 1024;
+
+//----------------------------------------------------------------------
+struct ArenaScheme::SData
+{
+    SData(size_t size_, std::pmr::memory_resource* pUpstream_) :
+        arena(size_, pUpstream_), nodes(&arena), links(&arena) {}
+
+    std::pmr::monotonic_buffer_resource arena;
+    TArenaNodeList                      nodes;
+    TArenaLinkList                      links;
+};
+
+//----------------------------------------------------------------------
+SDevice SArenaDevice::ToDevice() const
+{
+    SDevice dev;
+
+    dev.id      = TDevId(id);
+    dev.name    = std::string(name);
+    dev.rule    = std::string(rule);
+    dev.gnode   = gnode;
+    dev.power   = power;
+
+    dev.inputs.reserve(inputs.size());
+    for (const auto& it : inputs)
+    {
+        SInput input(std::string(it.name));
+        input.connect.node  = TNodeId(it.connect.node);
+        input.connect.link  = TLinkId(it.connect.link);
+        input.connect.input = it.connect.input;
+
+        dev.inputs.push_back(std::move(input));
+    }
+
+    return dev;
+}
+
+//----------------------------------------------------------------------
+ArenaScheme::ArenaScheme(std::pmr::memory_resource* pUpstream_) :
+    m_pUpstream(pUpstream_)
+{
+}
+
+//----------------------------------------------------------------------
+ArenaScheme::~ArenaScheme() = default;
+
+//----------------------------------------------------------------------
+bool ArenaScheme::Load(const std::string& file_name_, const std::string* pDictionary_)
+{
+    PROFILE_SCOPE("load_scheme_arena");
+
+    Clear();
+
+    const bool compressed = IsCompressedScheme(file_name_);
+
+    const int fd = ::open(file_name_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat info {};
+    const size_t file_size = ::fstat(fd, &info) == 0 ? (size_t)info.st_size : 0;
+
+    m_pData.reset(new SData(std::max(file_size * (compressed ? arena_per_compressed_byte : arena_per_file_byte), min_arena), m_pUpstream));
+
+    bool loaded = false;
+
+    if (compressed)
+    {
+        nop::Deserializer<InflateFdReader> deserializer { fd, pDictionary_ };
+        loaded = deserializer.Read(&m_pData->nodes) && deserializer.Read(&m_pData->links);
+    }
+    else
+    {
+        nop::Deserializer<nop::BufferedFdReader> deserializer { fd };
+        loaded = deserializer.Read(&m_pData->nodes) && deserializer.Read(&m_pData->links);
+    }
+
+    if (!loaded)
+    {
+        Log("Failed to read scheme " + file_name_);
+
+        Clear();
+        return false;
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+void ArenaScheme::Clear()
+{
+    m_pData.reset();
+}
+
+//----------------------------------------------------------------------
+const TArenaNodeList& ArenaScheme::Nodes() const
+{
+    static const TArenaNodeList empty;
+    return m_pData ? m_pData->nodes : empty;
+}
+
+//----------------------------------------------------------------------
+const TArenaLinkList& ArenaScheme::Links() const
+{
+    static const TArenaLinkList empty;
+    return m_pData ? m_pData->links : empty;
+}
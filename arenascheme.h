@@ -0,0 +1,139 @@
+#ifndef ARENASCHEME_H
+#define ARENASCHEME_H
+
+#include <memory>
+#include <memory_resource>
+
+#include "scheme.h"
+
+//----------------------------------------------------------------------
+// Scheme types backed by a memory resource.
+//
+// They mirror SConnect/SInput/SDevice/SLink member for member, so they
+// read and write the same .sch encoding, but every string, vector and map
+// node is allocated from the resource of the container they are loaded
+// into. Loading into a monotonic arena turns the hundreds of thousands of
+// small allocations of a large scheme into a few big blocks.
+typedef std::pmr::polymorphic_allocator<char> TArenaAllocator;
+
+//----------------------------------------------------------------------
+struct SArenaConnect
+{
+    using allocator_type = TArenaAllocator;
+
+    std::pmr::string    node;
+    std::pmr::string    link;
+    int                 input { -1 };
+
+    explicit SArenaConnect(const allocator_type& alloc_ = {}) : node(alloc_), link(alloc_) {}
+    SArenaConnect(const SArenaConnect& other_, const allocator_type& alloc_ = {}) :
+        node(other_.node, alloc_), link(other_.link, alloc_), input(other_.input) {}
+    SArenaConnect(SArenaConnect&&) = default;
+    SArenaConnect(SArenaConnect&& other_, const allocator_type& alloc_) :
+        node(std::move(other_.node), alloc_), link(std::move(other_.link), alloc_), input(other_.input) {}
+
+    NOP_STRUCTURE(SArenaConnect, node, link, input);
+};
+
+//----------------------------------------------------------------------
+struct SArenaInput
+{
+    using allocator_type = TArenaAllocator;
+
+    std::pmr::string    name;
+    SArenaConnect       connect;
+
+    bool IsOn() const { return !connect.node.empty(); }
+
+    explicit SArenaInput(const allocator_type& alloc_ = {}) : name(alloc_), connect(alloc_) {}
+    SArenaInput(const SArenaInput& other_, const allocator_type& alloc_ = {}) :
+        name(other_.name, alloc_), connect(other_.connect, alloc_) {}
+    SArenaInput(SArenaInput&&) = default;
+    SArenaInput(SArenaInput&& other_, const allocator_type& alloc_) :
+        name(std::move(other_.name), alloc_), connect(std::move(other_.connect), alloc_) {}
+
+    NOP_STRUCTURE(SArenaInput, name, connect);
+};
+
+//----------------------------------------------------------------------
+struct SArenaDevice
+{
+    using allocator_type = TArenaAllocator;
+
+    std::pmr::string                id;
+    std::pmr::string                name;
+    std::pmr::vector<SArenaInput>   inputs;
+    std::pmr::string                rule;
+    SGraphNode                      gnode;
+    double                          power   {};
+
+    explicit SArenaDevice(const allocator_type& alloc_ = {}) : id(alloc_), name(alloc_), inputs(alloc_), rule(alloc_) {}
+    SArenaDevice(const SArenaDevice& other_, const allocator_type& alloc_ = {}) :
+        id(other_.id, alloc_), name(other_.name, alloc_), inputs(other_.inputs, alloc_), rule(other_.rule, alloc_),
+        gnode(other_.gnode), power(other_.power) {}
+    SArenaDevice(SArenaDevice&&) = default;
+    SArenaDevice(SArenaDevice&& other_, const allocator_type& alloc_) :
+        id(std::move(other_.id), alloc_), name(std::move(other_.name), alloc_), inputs(std::move(other_.inputs), alloc_),
+        rule(std::move(other_.rule), alloc_), gnode(other_.gnode), power(other_.power) {}
+
+    NOP_STRUCTURE(SArenaDevice, id, name, inputs, rule, gnode, power);
+
+    bool IsCable() const
+    {
+        return inputs.size() == 2 && power == 0.0;
+    }
+
+    // Copy with regular allocations, e.g. to pull a node into an editable scheme
+    SDevice ToDevice() const;
+};
+
+//----------------------------------------------------------------------
+struct SArenaLink
+{
+    using allocator_type = TArenaAllocator;
+
+    std::array<std::pmr::string, 2> nodes;
+
+    explicit SArenaLink(const allocator_type& alloc_ = {}) : nodes{ std::pmr::string(alloc_), std::pmr::string(alloc_) } {}
+    SArenaLink(const SArenaLink& other_, const allocator_type& alloc_ = {}) :
+        nodes{ std::pmr::string(other_.nodes[0], alloc_), std::pmr::string(other_.nodes[1], alloc_) } {}
+    SArenaLink(SArenaLink&&) = default;
+    SArenaLink(SArenaLink&& other_, const allocator_type& alloc_) :
+        nodes{ std::pmr::string(std::move(other_.nodes[0]), alloc_), std::pmr::string(std::move(other_.nodes[1]), alloc_) } {}
+
+    NOP_STRUCTURE(SArenaLink, nodes);
+};
+
+typedef std::pmr::map<std::pmr::string, SArenaDevice>  TArenaNodeList;
+typedef std::pmr::map<std::pmr::string, SArenaLink>    TArenaLinkList;
+
+//----------------------------------------------------------------------
+// Read-only scheme loaded into a monotonic arena sized after the file.
+// Clear() and reloading give the whole scheme back in one go instead of
+// node by node. Reads the legacy .sch encoding only, plain or compressed;
+// plain files are better mapped as a SchemeView, which compressed ones
+// can't be.
+class ArenaScheme
+{
+public:
+    explicit ArenaScheme(std::pmr::memory_resource* pUpstream_ = std::pmr::new_delete_resource());
+    ~ArenaScheme();
+
+    ArenaScheme(const ArenaScheme&) = delete;
+    ArenaScheme& operator=(const ArenaScheme&) = delete;
+
+    // pDictionary_ as for LoadScheme()
+    bool Load(const std::string& file_name_, const std::string* pDictionary_ = nullptr);
+    void Clear();
+
+    const TArenaNodeList& Nodes() const;
+    const TArenaLinkList& Links() const;
+
+private:
+    struct SData;
+
+    std::pmr::memory_resource*  m_pUpstream;
+    std::unique_ptr<SData>      m_pData;
+};
+
+#endif // ARENASCHEME_H
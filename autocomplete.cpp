@@ -0,0 +1,340 @@
+#include "autocomplete.h"
+
+#include <deque>
+#include <unordered_set>
+
+//----------------------------------------------------------------------
+AutoCompleter::AutoCompleter(const TCategoryList& catalog_, const PortReach& reach_) :
+    m_reach(reach_)
+{
+    std::set<std::pair<int, int>> known;
+
+    for (const auto& it_cat : catalog_)
+    {
+        if (it_cat.first == "connections")
+            continue;
+
+        for (const auto& it_dev : it_cat.second)
+        {
+            const SDevice& dev = it_dev.second;
+            if (!dev.IsCable())
+                continue;
+
+            auto p = m_reach.Index(dev.inputs[0].Type());
+            auto q = m_reach.Index(dev.inputs[1].Type());
+            if (!p.has_value() || !q.has_value())
+                continue;
+
+            // Cables differing only in length are interchangeable here
+            if (!known.insert( { std::min(p.value(), q.value()), std::max(p.value(), q.value()) } ).second)
+                continue;
+
+            m_cables.push_back( { &dev, { p.value(), q.value() } } );
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+const Rule* AutoCompleter::rule(const std::string& text_)
+{
+    auto it = m_rules.find(text_);
+    if (it == m_rules.end())
+        it = m_rules.insert( { text_, Rule::Compile(text_) } ).first;
+
+    return it->second.has_value() ? &it->second.value() : nullptr;
+}
+
+//----------------------------------------------------------------------
+void AutoCompleter::update(const TNodeId& node_)
+{
+    SState& state = m_states[node_];
+    const SDevice& dev = (*m_nodes)[node_];
+
+    state.on = 0;
+    for (int i = 0; i < (int)dev.inputs.size(); ++i)
+        if (dev.inputs[i].IsOn())
+            state.on |= uint32_t(1) << i;
+
+    state.satisfied = !state.rule || state.rule->Eval(state.on);
+}
+
+//----------------------------------------------------------------------
+std::optional<AutoCompleter::SPortRef> AutoCompleter::find_free(int type_, const TNodeId& exclude_)
+{
+    std::optional<SPortRef> fallback;
+
+    std::vector<SPortRef>& ports = m_free[type_];
+    for (size_t i = 0; i < ports.size(); )
+    {
+        const SPortRef& port = ports[i];
+
+        // Dropping ports bound since the list was built
+        if ((*m_nodes)[port.node].inputs[port.input].IsOn())
+        {
+            ports[i] = ports.back();
+            ports.pop_back();
+            continue;
+        }
+
+        if (port.node != exclude_)
+        {
+            if (!m_states[port.node].satisfied)
+                return port;
+
+            if (!fallback.has_value())
+                fallback = port;
+        }
+
+        ++i;
+    }
+
+    return fallback;
+}
+
+//----------------------------------------------------------------------
+bool AutoCompleter::connect(const TNodeId& node_, int input_)
+{
+    SDevice& dev = (*m_nodes)[node_];
+
+    auto type = m_reach.Index(dev.inputs[input_].Type());
+    if (!type.has_value())
+        return false;
+
+    // Direct binding
+    for (int u = 0; u < m_reach.Size(); ++u)
+    {
+        if (!m_reach.Mates(type.value(), u))
+            continue;
+
+        if (auto partner = find_free(u, node_))
+        {
+            TLinkId link = (*m_new_id)();
+
+            touch(node_);
+            touch(partner->node);
+            touch_link(link);
+
+            Bind(*m_nodes, *m_links, link, node_, input_, partner->node, partner->input);
+
+            m_result->links.push_back(link);
+            update(node_);
+            update(partner->node);
+            return true;
+        }
+    }
+
+    // Through a single catalog cable
+    for (const auto& cable : m_cables)
+    {
+        for (int side = 0; side < 2; ++side)
+        {
+            const int near = cable.port[side];
+            const int far  = cable.port[1 - side];
+
+            if (!m_reach.Mates(type.value(), near))
+                continue;
+
+            for (int u = 0; u < m_reach.Size(); ++u)
+            {
+                if (!m_reach.Mates(far, u))
+                    continue;
+
+                auto partner = find_free(u, node_);
+                if (!partner.has_value())
+                    continue;
+
+                TNodeId cable_id = (*m_new_id)();
+
+                touch(node_);
+                touch(cable_id);
+                touch(partner->node);
+
+                SDevice& cable_dev = (*m_nodes)[cable_id];
+                cable_dev = *cable.dev;
+
+                const SGraphNode& lnode = (*m_nodes)[node_].gnode;
+                const SGraphNode& rnode = (*m_nodes)[partner->node].gnode;
+                cable_dev.gnode.x = (lnode.x + rnode.x) / 2;
+                cable_dev.gnode.y = (lnode.y + rnode.y) / 2;
+
+                m_states[cable_id].rule = rule(cable_dev.rule);
+
+                TLinkId llink = (*m_new_id)();
+                TLinkId rlink = (*m_new_id)();
+
+                touch_link(llink);
+                touch_link(rlink);
+
+                Bind(*m_nodes, *m_links, llink, node_, input_, cable_id, side);
+                Bind(*m_nodes, *m_links, rlink, cable_id, 1 - side, partner->node, partner->input);
+
+                m_result->nodes.push_back(cable_id);
+                m_result->links.push_back(llink);
+                m_result->links.push_back(rlink);
+
+                update(node_);
+                update(cable_id);
+                update(partner->node);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+//----------------------------------------------------------------------
+// Takes back the bindings and cables of the result past the given counts
+void AutoCompleter::rollback(size_t links_, size_t nodes_)
+{
+    std::unordered_set<TNodeId> cables(m_result->nodes.begin() + nodes_, m_result->nodes.end());
+    std::vector<TNodeId> ends;
+
+    while (m_result->links.size() > links_)
+    {
+        const TLinkId link_id = m_result->links.back();
+        m_result->links.pop_back();
+
+        auto itLink = m_links->find(link_id);
+        if (itLink == m_links->end())
+            continue;
+
+        for (const TNodeId& node : itLink->second.nodes)
+        {
+            SDevice& dev = (*m_nodes)[node];
+
+            for (int i = 0; i < (int)dev.inputs.size(); ++i)
+            {
+                if (dev.inputs[i].connect.link != link_id)
+                    continue;
+
+                dev.inputs[i].connect.Reset();
+
+                // Dropped from the free lists once it was found bound
+                if (!cables.count(node))
+                    if (auto type = m_reach.Index(dev.inputs[i].Type()))
+                        m_free[type.value()].push_back( { node, i } );
+            }
+
+            if (!cables.count(node))
+                ends.push_back(node);
+        }
+
+        m_links->erase(itLink);
+    }
+
+    for (const auto& it : cables)
+    {
+        m_nodes->erase(it);
+        m_states.erase(it);
+    }
+
+    m_result->nodes.resize(nodes_);
+
+    for (const auto& it : ends)
+        update(it);
+}
+
+//----------------------------------------------------------------------
+void AutoCompleter::touch(const TNodeId& node_)
+{
+    if (m_pEdit)
+        m_pEdit->TouchNode(node_, *m_nodes);
+}
+
+//----------------------------------------------------------------------
+void AutoCompleter::touch_link(const TLinkId& link_)
+{
+    if (m_pEdit)
+        m_pEdit->TouchLink(link_, *m_links);
+}
+
+//----------------------------------------------------------------------
+SCompletion AutoCompleter::Run(TNodeList& nodes_, TLinkList& links_, const TIdGenerator& new_id_, SchemeEdit* pEdit_)
+{
+    SCompletion result;
+
+    m_nodes     = &nodes_;
+    m_links     = &links_;
+    m_new_id    = &new_id_;
+    m_result    = &result;
+    m_pEdit     = pEdit_;
+
+    m_states.clear();
+    m_free.assign(m_reach.Size(), std::vector<SPortRef>());
+
+    std::deque<TNodeId> queue;
+
+    for (const auto& it : nodes_)
+    {
+        const SDevice& dev = it.second;
+
+        m_states[it.first].rule = rule(dev.rule);
+        update(it.first);
+
+        if (!m_states[it.first].rule)
+            result.unsolved.push_back(it.first);
+
+        for (int i = 0; i < (int)dev.inputs.size(); ++i)
+        {
+            if (dev.inputs[i].IsOn())
+                continue;
+
+            if (auto type = m_reach.Index(dev.inputs[i].Type()))
+                m_free[type.value()].push_back( { it.first, i } );
+        }
+
+        if (!m_states[it.first].satisfied)
+            queue.push_back(it.first);
+    }
+
+    while (!queue.empty())
+    {
+        TNodeId node = queue.front();
+        queue.pop_front();
+
+        uint32_t blocked = 0;
+
+        while (!m_states[node].satisfied)
+        {
+            const SState& state = m_states[node];
+            const SDevice& dev  = nodes_[node];
+
+            const uint32_t free = ((dev.inputs.size() >= 32 ? ~uint32_t(0) : (uint32_t(1) << dev.inputs.size()) - 1)
+                                   & ~state.on & ~blocked);
+
+            auto extension = state.rule->MinExtension(state.on, free);
+            if (!extension.has_value())
+            {
+                result.unsolved.push_back(node);
+                break;
+            }
+
+            const size_t links = result.links.size();
+            const size_t cables = result.nodes.size();
+
+            for (int i = 0; i < (int)dev.inputs.size(); ++i)
+            {
+                const uint32_t bit = uint32_t(1) << i;
+                if (!(extension.value() & bit))
+                    continue;
+
+                if (!connect(node, i))
+                {
+                    rollback(links, cables);
+
+                    blocked |= bit;
+                    break;
+                }
+            }
+        }
+    }
+
+    m_nodes     = nullptr;
+    m_links     = nullptr;
+    m_new_id    = nullptr;
+    m_result    = nullptr;
+    m_pEdit     = nullptr;
+
+    return result;
+}
@@ -0,0 +1,87 @@
+#ifndef AUTOCOMPLETE_H
+#define AUTOCOMPLETE_H
+
+#include <functional>
+#include <unordered_map>
+
+#include "scheme.h"
+#include "portreach.h"
+#include "rule.h"
+#include "undo.h"
+
+//----------------------------------------------------------------------
+struct SCompletion
+{
+    std::vector<TNodeId> nodes;     // Cables taken from the catalog
+    std::vector<TLinkId> links;     // Bindings made
+    std::vector<TNodeId> unsolved;  // Nodes whose rule still fails
+};
+
+//----------------------------------------------------------------------
+// Connects unsatisfied devices of a scheme.
+//
+// Every node rule is compiled to a Rule; for a failing node the smallest
+// set of free inputs that makes the rule hold is searched for, and each
+// of those inputs is bound either directly to a free mating port of
+// another node or through one catalog cable. Inputs that turn out to be
+// impossible to bind are fixed as free and the search is repeated.
+// Partner ports on nodes that are failing themselves are preferred, so
+// a single binding usually satisfies two rules. When one input of an
+// extension can't be bound, the bindings and cables made for the others
+// are taken back before the search is repeated. Nodes whose rule does
+// not compile are left alone and reported unsolved. With an edit given, every
+// node and link is touched before it changes, so the edit holds the
+// bindings and nothing else.
+class AutoCompleter
+{
+public:
+    typedef std::function<std::string()> TIdGenerator;
+
+    AutoCompleter(const TCategoryList& catalog_, const PortReach& reach_);
+
+    SCompletion Run(TNodeList& nodes_, TLinkList& links_, const TIdGenerator& new_id_, SchemeEdit* pEdit_ = nullptr);
+
+private:
+    struct SPortRef
+    {
+        TNodeId node;
+        int     input;
+    };
+
+    struct SState
+    {
+        const Rule* rule    {};
+        uint32_t    on      {};
+        bool        satisfied { true };
+    };
+
+    struct SCable
+    {
+        const SDevice*  dev;
+        int             port[2];
+    };
+
+    const Rule* rule(const std::string& text_);
+    void        update(const TNodeId& node_);
+    bool        connect(const TNodeId& node_, int input_);
+    void        rollback(size_t links_, size_t nodes_);
+    void        touch(const TNodeId& node_);
+    void        touch_link(const TLinkId& link_);
+
+    std::optional<SPortRef> find_free(int type_, const TNodeId& exclude_);
+
+    const PortReach&                                    m_reach;
+    std::vector<SCable>                                 m_cables;
+    std::unordered_map<std::string, std::optional<Rule>> m_rules;
+
+    // Per solving run
+    TNodeList*                                          m_nodes {};
+    TLinkList*                                          m_links {};
+    const TIdGenerator*                                 m_new_id {};
+    SCompletion*                                        m_result {};
+    SchemeEdit*                                         m_pEdit {};
+    std::unordered_map<TNodeId, SState>                 m_states;
+    std::vector<std::vector<SPortRef>>                  m_free;
+};
+
+#endif // AUTOCOMPLETE_H
@@ -0,0 +1,46 @@
+#-------------------------------------------------
+#
+# Benchmarks of the Qt-free core: rule evaluation,
+# catalog loading and scheme I/O
+#
+#-------------------------------------------------
+
+TARGET = verifier_bench
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= qt app_bundle
+
+QMAKE_CXXFLAGS += -std=c++17
+
+INCLUDEPATH += ..
+
+unix:!macx: LIBS += -lstdc++fs
+
+LIBS += -lz
+
+SOURCES += \
+        main.cpp \
+    ../catalog.cpp \
+    ../rule.cpp \
+    ../catalogrules.cpp \
+    ../portreach.cpp \
+    ../arenascheme.cpp \
+    ../schemeview.cpp \
+    ../schemeio.cpp \
+    ../schemecompress.cpp \
+    ../profiler.cpp \
+    ../LibBoolEE/LibBoolEE.cpp
+
+HEADERS += \
+    ../scheme.h \
+    ../catalog.h \
+    ../rule.h \
+    ../catalogrules.h \
+    ../portreach.h \
+    ../arenascheme.h \
+    ../schemeview.h \
+    ../schemeio.h \
+    ../schemecompress.h \
+    ../profiler.h \
+    ../LibBoolEE/LibBoolEE.h
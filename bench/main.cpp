@@ -0,0 +1,559 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+
+#include "scheme.h"
+#include "catalog.h"
+#include "rule.h"
+#include "catalogrules.h"
+#include "portreach.h"
+#include "arenascheme.h"
+#include "schemeview.h"
+#include "schemeio.h"
+#include "schemecompress.h"
+
+#include "nop/utility/stream_writer.h"
+#include "nop/utility/stream_reader.h"
+#include "nop/utility/fd_writer.h"
+#include "nop/utility/buffer_writer.h"
+#include "nop/utility/fd_reader.h"
+
+#include <fcntl.h>
+
+//----------------------------------------------------------------------
+// Self-contained benchmark harness.
+//
+// Every case is run repeatedly until both a minimum number of runs and a
+// minimum total time are reached; the per-item time of each run is kept
+// and the min/median/mean are reported as JSON, one object per case.
+//
+// Usage: verifier_bench [--data <folder>] [--nodes <count>] [--devices <count>]
+//                       [--min-time <seconds>] [--filter <substring>] [--out <file>]
+
+//----------------------------------------------------------------------
+struct SOptions
+{
+    std::string data_folder = "../data/";
+    std::string out_file;
+    std::string filter;
+    int         nodes       = 10000;
+    int         devices     = 10000;
+    double      min_time    = 0.5;
+    int         min_runs    = 5;
+};
+
+//----------------------------------------------------------------------
+struct SResult
+{
+    std::string name;
+    int         runs  {};
+    size_t      items {};   // Items processed per run
+    double      min   {};   // ns per item
+    double      median{};
+    double      mean  {};
+};
+
+//----------------------------------------------------------------------
+// Keeps results observable so the measured work is not optimized away
+static volatile size_t sink = 0;
+
+// Centre of a node item relative to its position, as in MainWindow
+static const double blob_offset = 20.0;
+
+//----------------------------------------------------------------------
+class Harness
+{
+public:
+    explicit Harness(const SOptions& options_) : m_options(options_) {}
+
+    // run_ processes items_ items per call
+    void Run(const std::string& name_, size_t items_, const std::function<void()>& run_)
+    {
+        if (!m_options.filter.empty() && name_.find(m_options.filter) == std::string::npos)
+            return;
+
+        using clock = std::chrono::steady_clock;
+
+        // Warm-up
+        run_();
+
+        std::vector<double> samples;
+        double total = 0.0;
+
+        while ((int)samples.size() < m_options.min_runs || total < m_options.min_time)
+        {
+            auto start = clock::now();
+            run_();
+            double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+
+            total += elapsed;
+            samples.push_back(elapsed * 1e9 / std::max<size_t>(items_, 1));
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        SResult result;
+        result.name   = name_;
+        result.runs   = (int)samples.size();
+        result.items  = items_;
+        result.min    = samples.front();
+        result.median = samples[samples.size() / 2];
+        for (double it : samples)
+            result.mean += it / samples.size();
+
+        fprintf(stderr, "%-32s %12.1f ns/item (median, %d runs)\n", name_.c_str(), result.median, result.runs);
+
+        m_results.push_back(result);
+    }
+
+    std::string Json() const
+    {
+        std::ostringstream out;
+
+        out << "{\n  \"context\": {"
+            << "\"nodes\": "    << m_options.nodes
+            << ", \"devices\": " << m_options.devices
+            << ", \"min_time\": " << m_options.min_time
+            << ", \"compiler\": \"" << __VERSION__ << "\"},\n"
+            << "  \"benchmarks\": [";
+
+        for (size_t i = 0; i < m_results.size(); ++i)
+        {
+            const SResult& it = m_results[i];
+
+            out << (i ? ",\n" : "\n")
+                << "    {\"name\": \"" << it.name << "\""
+                << ", \"runs\": "   << it.runs
+                << ", \"items\": "  << it.items
+                << ", \"ns_per_item\": {\"min\": " << it.min
+                << ", \"median\": " << it.median
+                << ", \"mean\": "   << it.mean << "}}";
+        }
+
+        out << "\n  ]\n}\n";
+
+        return out.str();
+    }
+
+private:
+    SOptions                m_options;
+    std::vector<SResult>    m_results;
+};
+
+//----------------------------------------------------------------------
+static TCategoryList load_catalog(const std::string& folder_)
+{
+    TCategoryList result;
+
+    std::error_code err;
+    for (const auto& it : std::filesystem::directory_iterator(folder_, err))
+        if (it.is_regular_file())
+            result[it.path().filename().string()] = LoadDevList(it.path().string());
+
+    if (err)
+        Log("Failed to read " + folder_ + ": " + err.message());
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+// A catalog file with count_ devices of 2..8 inputs each
+static std::string write_synthetic_catalog(int count_, std::mt19937& rng_)
+{
+    static const char* types[] = { "hdmi_f", "hdmi_m", "usb_a_f", "usb_a_m", "rj45_f", "rj45_m", "c13", "c14", "dp_f", "dp_m" };
+
+    const std::string file_name = (std::filesystem::temp_directory_path() / "verifier_bench_catalog").string();
+
+    std::ofstream file(file_name);
+
+    for (int i = 0; i < count_; ++i)
+    {
+        const int inputs = 2 + rng_() % 7;
+
+        file << "id:bench-" << i << "\n";
+        file << "name:Device " << i << "\n";
+
+        std::string rule;
+        for (int j = 0; j < inputs; ++j)
+        {
+            file << "input:" << ind2let(j + 1).value() << ":" << types[rng_() % 10] << "\n";
+            rule += (j ? (rng_() % 2 ? "&" : "|") : "") + std::string(1, ind2let(j + 1).value());
+        }
+
+        file << "rule:" << rule << "\n";
+        file << "pwr:" << rng_() % 500 << "\n";
+    }
+
+    return file_name;
+}
+
+//----------------------------------------------------------------------
+// nodes_count_ catalog devices joined by random links between mating ports
+static void generate_scheme(const TCategoryList& catalog_, const PortReach& reach_, int nodes_count_,
+                            std::mt19937& rng_, TNodeList& nodes_, TLinkList& links_)
+{
+    std::vector<const SDevice*> devices;
+    for (const auto& itCategory : catalog_)
+        for (const auto& itDev : itCategory.second)
+            if (!itDev.second.inputs.empty())
+                devices.push_back(&itDev.second);
+
+    if (devices.empty())
+        return;
+
+    std::vector<TNodeId> ids;
+    for (int i = 0; i < nodes_count_; ++i)
+    {
+        TNodeId id = "node-" + std::to_string(i);
+
+        SDevice& dev = nodes_[id] = *devices[rng_() % devices.size()];
+        dev.gnode.x = rng_() % 10000;
+        dev.gnode.y = rng_() % 10000;
+
+        ids.push_back(id);
+    }
+
+    int link_count = 0;
+    for (const auto& lid : ids)
+    {
+        for (int linput = 0; linput < (int)nodes_[lid].inputs.size(); ++linput)
+        {
+            if (nodes_[lid].inputs[linput].IsOn())
+                continue;
+
+            // A few attempts to find a free mating port on a random node
+            for (int attempt = 0; attempt < 8; ++attempt)
+            {
+                const TNodeId& rid = ids[rng_() % ids.size()];
+                if (rid == lid)
+                    continue;
+
+                SDevice& rdev = nodes_[rid];
+                const int rinput = rng_() % rdev.inputs.size();
+
+                if (!rdev.inputs[rinput].IsOn() &&
+                    reach_.Mates(nodes_[lid].inputs[linput].Type(), rdev.inputs[rinput].Type()))
+                {
+                    Bind(nodes_, links_, "link-" + std::to_string(link_count++), lid, linput, rid, rinput);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+static bool parse_options(int argc, char* argv[], SOptions& options_)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool has_value = i + 1 < argc;
+
+        if      (!strcmp(argv[i], "--data")     && has_value) options_.data_folder  = argv[++i];
+        else if (!strcmp(argv[i], "--out")      && has_value) options_.out_file     = argv[++i];
+        else if (!strcmp(argv[i], "--filter")   && has_value) options_.filter       = argv[++i];
+        else if (!strcmp(argv[i], "--nodes")    && has_value) options_.nodes        = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--devices")  && has_value) options_.devices      = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--min-time") && has_value) options_.min_time     = std::atof(argv[++i]);
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    SOptions options;
+    if (!parse_options(argc, argv, options))
+        return 1;
+
+    std::mt19937 rng(42);
+
+    Harness harness(options);
+
+    const TCategoryList catalog = load_catalog(options.data_folder);
+    if (catalog.empty())
+    {
+        fprintf(stderr, "No catalog found in %s\n", options.data_folder.c_str());
+        return 1;
+    }
+
+    PortReach reach;
+    reach.Build(catalog);
+
+    //----------------------------------------------------------------------
+    // Rules of the real catalog with random input states
+    std::vector<SDevice> ruled;
+    for (const auto& itCategory : catalog)
+        for (const auto& itDev : itCategory.second)
+            if (!itDev.second.rule.empty())
+            {
+                SDevice dev = itDev.second;
+                for (auto& it : dev.inputs)
+                    it.connect.node = rng() % 2 ? "bench" : "";
+                ruled.push_back(dev);
+            }
+
+    harness.Run("libboolee_resolve", ruled.size(), [&]() {
+        size_t count = 0;
+        for (const auto& it : ruled)
+            count += ResolveRule(it);
+        sink = sink + count;
+    });
+
+    std::vector<std::pair<Rule, uint32_t>> compiled;
+    for (const auto& it : ruled)
+    {
+        auto rule = Rule::Compile(it.rule);
+        if (!rule.has_value())
+            continue;
+
+        uint32_t on = 0;
+        for (int i = 0; i < (int)it.inputs.size() && i < 32; ++i)
+            on |= it.inputs[i].IsOn() ? (1u << i) : 0;
+
+        compiled.emplace_back(std::move(rule.value()), on);
+    }
+
+    harness.Run("rule_compiled_eval", compiled.size(), [&]() {
+        size_t count = 0;
+        for (const auto& it : compiled)
+            count += it.first.Eval(it.second);
+        sink = sink + count;
+    });
+
+    // Generated tables, lookup of the device included. Devices of another
+    // catalog than the one they were generated from fall back to LibBoolEE.
+    harness.Run("catalog_table_resolve", ruled.size(), [&]() {
+        size_t count = 0;
+        for (const auto& it : ruled)
+            count += ResolveCatalogRule(it);
+        sink = sink + count;
+    });
+
+    //----------------------------------------------------------------------
+    // Catalog loading
+    const std::string catalog_file = write_synthetic_catalog(options.devices, rng);
+
+    harness.Run("load_dev_list", options.devices, [&]() {
+        sink = sink + LoadDevList(catalog_file).size();
+    });
+
+    std::filesystem::remove(catalog_file);
+
+    //----------------------------------------------------------------------
+    // Scheme I/O
+    TNodeList nodes;
+    TLinkList links;
+    generate_scheme(catalog, reach, options.nodes, rng, nodes, links);
+
+    std::string data;
+    {
+        nop::Serializer<nop::StreamWriter<std::stringstream>> serializer;
+        serializer.Write(nodes);
+        serializer.Write(links);
+        data = serializer.writer().stream().str();
+    }
+
+    harness.Run("nop_write_scheme", nodes.size(), [&]() {
+        nop::Serializer<nop::StreamWriter<std::stringstream>> serializer;
+        serializer.Write(nodes);
+        serializer.Write(links);
+        sink = sink + serializer.writer().stream().str().size();
+    });
+
+    // Exact size computed first, one allocation, no stream growth
+    harness.Run("sized_write_scheme", nodes.size(), [&]() {
+        const size_t size = nop::Encoding<TNodeList>::Size(nodes) + nop::Encoding<TLinkList>::Size(links);
+        std::unique_ptr<uint8_t[]> buffer(new uint8_t[size]);
+
+        nop::Serializer<nop::BufferWriter> serializer { buffer.get(), size };
+        serializer.Write(nodes);
+        serializer.Write(links);
+        sink = sink + serializer.writer().size();
+    });
+
+    harness.Run("nop_read_scheme", nodes.size(), [&]() {
+        TNodeList read_nodes;
+        TLinkList read_links;
+
+        nop::Deserializer<nop::StreamReader<std::stringstream>> deserializer { data };
+        deserializer.Read(&read_nodes);
+        deserializer.Read(&read_links);
+
+        sink = sink + read_nodes.size() + read_links.size();
+    });
+
+    // The same through a file with the buffered fd reader and writer
+    const std::string scheme_file = (std::filesystem::temp_directory_path() / "verifier_bench_scheme").string();
+
+    // Read cases do not depend on the write case being selected
+    std::ofstream(scheme_file, std::ios::binary) << data;
+
+    harness.Run("fd_write_scheme", nodes.size(), [&]() {
+        nop::Serializer<nop::BufferedFdWriter> serializer { ::open(scheme_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644) };
+        serializer.Write(nodes);
+        serializer.Write(links);
+        sink = sink + (bool)serializer.writer().Flush();
+    });
+
+    harness.Run("fd_read_scheme", nodes.size(), [&]() {
+        TNodeList read_nodes;
+        TLinkList read_links;
+
+        nop::Deserializer<nop::BufferedFdReader> deserializer { ::open(scheme_file.c_str(), O_RDONLY) };
+        deserializer.Read(&read_nodes);
+        deserializer.Read(&read_links);
+
+        sink = sink + read_nodes.size() + read_links.size();
+    });
+
+    // What MainWindow does with a legacy file, to compare with the compact one
+    harness.Run("load_scheme", nodes.size(), [&]() {
+        TNodeList read_nodes;
+        TLinkList read_links;
+        LoadScheme(scheme_file, read_nodes, read_links, &catalog);
+
+        sink = sink + read_nodes.size() + read_links.size();
+    });
+
+    // Into a monotonic arena, released as a whole
+    harness.Run("arena_read_scheme", nodes.size(), [&]() {
+        ArenaScheme scheme;
+        scheme.Load(scheme_file);
+
+        sink = sink + scheme.Nodes().size() + scheme.Links().size();
+    });
+
+    // Mapped, strings left in place
+    harness.Run("view_read_scheme", nodes.size(), [&]() {
+        SchemeView scheme;
+        scheme.Open(scheme_file);
+
+        sink = sink + scheme.Nodes().size() + scheme.Links().size();
+    });
+
+    // Nodes referencing catalog devices by id
+    const std::string compact_file = scheme_file + "_compact";
+
+    SaveCompactScheme(compact_file, catalog, nodes, links);
+
+    harness.Run("compact_write_scheme", nodes.size(), [&]() {
+        sink = sink + SaveCompactScheme(compact_file, catalog, nodes, links);
+    });
+
+    harness.Run("compact_read_scheme", nodes.size(), [&]() {
+        TNodeList read_nodes;
+        TLinkList read_links;
+        LoadScheme(compact_file, read_nodes, read_links, &catalog);
+
+        sink = sink + read_nodes.size() + read_links.size();
+    });
+
+    // Deflated with a dictionary trained on the same scheme, serialized
+    // while the previous block is compressed
+    const std::string compressed_file = scheme_file + "_compressed";
+
+    SCompression compression;
+    compression.dictionary = TrainSchemeDictionary( { data } );
+
+    SaveCompactScheme(compressed_file, catalog, nodes, links, &compression);
+
+    harness.Run("deflate_write_scheme", nodes.size(), [&]() {
+        sink = sink + SaveCompactScheme(compressed_file, catalog, nodes, links, &compression);
+    });
+
+    harness.Run("inflate_read_scheme", nodes.size(), [&]() {
+        TNodeList read_nodes;
+        TLinkList read_links;
+        LoadScheme(compressed_file, read_nodes, read_links, &catalog, &compression.dictionary);
+
+        sink = sink + read_nodes.size() + read_links.size();
+    });
+
+    std::filesystem::remove(compressed_file);
+    std::filesystem::remove(compact_file);
+    std::filesystem::remove(scheme_file);
+
+    //----------------------------------------------------------------------
+    // Periodic validation and scene update without the UI: items are
+    // looked up by id as MainWindow does through its item index
+    struct SItem
+    {
+        double x {};
+        double y {};
+        double x2{};
+        double y2{};
+        bool   positive {};
+    };
+
+    std::unordered_map<std::string, SItem> items;
+    for (const auto& it : nodes)
+        items[it.first] = { double(it.second.gnode.x), double(it.second.gnode.y) };
+    for (const auto& it : links)
+        items[it.first] = {};
+
+    harness.Run("check_states", nodes.size(), [&]() {
+        for (const auto& it : nodes)
+        {
+            auto itItem = items.find(it.first);
+            if (itItem != items.end())
+                itItem->second.positive = ResolveRule(it.second);
+        }
+        sink = sink + items.size();
+    });
+
+    harness.Run("scene_changed", nodes.size() + links.size(), [&]() {
+        for (const auto& it : links)
+        {
+            auto itLine  = items.find(it.first);
+            auto itLeft  = items.find(it.second.nodes[0]);
+            auto itRight = items.find(it.second.nodes[1]);
+
+            if (itLine != items.end() && itLeft != items.end() && itRight != items.end())
+            {
+                itLine->second.x  = itLeft ->second.x + blob_offset;
+                itLine->second.y  = itLeft ->second.y + blob_offset;
+                itLine->second.x2 = itRight->second.x + blob_offset;
+                itLine->second.y2 = itRight->second.y + blob_offset;
+            }
+        }
+
+        for (auto& it : nodes)
+        {
+            auto itItem = items.find(it.first);
+            if (itItem != items.end())
+            {
+                it.second.gnode.x = (int)itItem->second.x;
+                it.second.gnode.y = (int)itItem->second.y;
+            }
+        }
+        sink = sink + nodes.size();
+    });
+
+    //----------------------------------------------------------------------
+    const std::string json = harness.Json();
+
+    if (options.out_file.empty())
+        fputs(json.c_str(), stdout);
+    else
+    {
+        std::ofstream file(options.out_file);
+        file << json;
+    }
+
+    return 0;
+}
@@ -0,0 +1,294 @@
+#include "bindall.h"
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <functional>
+#include <queue>
+
+#include "rule.h"
+
+//----------------------------------------------------------------------
+std::vector<int> HopcroftKarp::Run(const TAdjacency& adj_, int right_count_, std::vector<int> match_)
+{
+    const int n = (int)adj_.size();
+    const int inf = INT_MAX;
+
+    std::vector<int> match_l = match_.empty() ? std::vector<int>(n, -1) : std::move(match_);
+    std::vector<int> match_r(right_count_, -1);
+    std::vector<int> dist(n);
+
+    for (int u = 0; u < n; ++u)
+        if (match_l[u] != -1)
+            match_r[match_l[u]] = u;
+
+    for (int u = 0; u < n; ++u)
+    {
+        if (match_l[u] != -1)
+            continue;
+
+        for (int v : adj_[u])
+            if (match_r[v] == -1)
+            {
+                match_l[u] = v;
+                match_r[v] = u;
+                break;
+            }
+    }
+
+    auto bfs = [&]() {
+        std::queue<int> queue;
+        for (int u = 0; u < n; ++u)
+        {
+            dist[u] = match_l[u] == -1 ? 0 : inf;
+            if (dist[u] == 0)
+                queue.push(u);
+        }
+
+        bool found = false;
+        while (!queue.empty())
+        {
+            const int u = queue.front();
+            queue.pop();
+
+            for (int v : adj_[u])
+            {
+                const int w = match_r[v];
+                if (w == -1)
+                    found = true;
+                else if (dist[w] == inf)
+                {
+                    dist[w] = dist[u] + 1;
+                    queue.push(w);
+                }
+            }
+        }
+        return found;
+    };
+
+    std::function<bool(int)> dfs = [&](int u) {
+        for (int v : adj_[u])
+        {
+            const int w = match_r[v];
+            if (w == -1 || (dist[w] == dist[u] + 1 && dfs(w)))
+            {
+                match_l[u] = v;
+                match_r[v] = u;
+                return true;
+            }
+        }
+        dist[u] = inf;
+        return false;
+    };
+
+    while (bfs())
+        for (int u = 0; u < n; ++u)
+            if (match_l[u] == -1)
+                dfs(u);
+
+    return match_l;
+}
+
+//----------------------------------------------------------------------
+namespace
+{
+    struct SPort
+    {
+        const TNodeId*  node;
+        int             input;
+        int             type;
+        int             priority;
+    };
+
+    // Ends of the priority classes of ports sorted by descending priority:
+    // ports [0, ends[k]) have priority k or higher
+    std::array<int, 3> class_ends(const std::vector<SPort>& ports_)
+    {
+        std::array<int, 3> ends {};
+        for (int k = 0; k < 3; ++k)
+            ends[k] = (int)(std::partition_point(ports_.begin(), ports_.end(), [k](const SPort& port_) {
+                return port_.priority >= k;
+            }) - ports_.begin());
+
+        return ends;
+    }
+
+    // Grows the matching over the left vertices one class at a time, the
+    // highest first. A vertex matched stays matched, so each class gets
+    // as many of its vertices matched as the ones above it allow.
+    std::vector<int> match_by_class(const HopcroftKarp::TAdjacency& adj_, int right_count_, const std::array<int, 3>& ends_)
+    {
+        std::vector<int> match;
+
+        for (int k = 2; k >= 0; --k)
+        {
+            HopcroftKarp::TAdjacency adj(adj_.begin(), adj_.begin() + ends_[k]);
+            adj.resize(adj_.size());
+
+            match = HopcroftKarp::Run(adj, right_count_, std::move(match));
+        }
+
+        return match;
+    }
+
+    // Maximum matching covering the best ports on both sides. The left
+    // ports matched by class are matchable together with the best right
+    // ports (Mendelsohn-Dulmage), so the right ones are matched by class
+    // among them only.
+    std::vector<int> priority_match(const HopcroftKarp::TAdjacency& adj_, const std::vector<SPort>& left_, const std::vector<SPort>& right_)
+    {
+        const std::vector<int> left_match = match_by_class(adj_, (int)right_.size(), class_ends(left_));
+
+        HopcroftKarp::TAdjacency radj(right_.size());
+        for (size_t u = 0; u < adj_.size(); ++u)
+            if (left_match[u] != -1)
+                for (int v : adj_[u])
+                    radj[v].push_back((int)u);
+
+        const std::vector<int> right_match = match_by_class(radj, (int)adj_.size(), class_ends(right_));
+
+        std::vector<int> match(adj_.size(), -1);
+        for (size_t v = 0; v < right_match.size(); ++v)
+            if (right_match[v] != -1)
+                match[right_match[v]] = (int)v;
+
+        return match;
+    }
+
+    // Two-colouring of port types by the mating relation
+    std::vector<int> port_sides(const PortReach& reach_)
+    {
+        const int n = reach_.Size();
+        std::vector<int> side(n, -1);
+
+        for (int start = 0; start < n; ++start)
+        {
+            if (side[start] != -1)
+                continue;
+
+            side[start] = 0;
+            std::queue<int> queue;
+            queue.push(start);
+
+            while (!queue.empty())
+            {
+                const int x = queue.front();
+                queue.pop();
+
+                for (int y = 0; y < n; ++y)
+                    if (reach_.Mates(x, y) && side[y] == -1)
+                    {
+                        side[y] = 1 - side[x];
+                        queue.push(y);
+                    }
+            }
+        }
+
+        return side;
+    }
+}
+
+//----------------------------------------------------------------------
+std::vector<SBinding> PlanBindAll(const TNodeList& nodes_, const std::vector<TNodeId>& group_, const PortReach& reach_)
+{
+    const std::vector<int> side = port_sides(reach_);
+
+    std::vector<SPort> ports[2];
+
+    for (const auto& id : group_)
+    {
+        auto itNode = nodes_.find(id);
+        if (itNode == nodes_.end())
+            continue;
+
+        const SDevice& dev = itNode->second;
+
+        uint32_t on = 0, free = 0;
+        for (int i = 0; i < (int)dev.inputs.size(); ++i)
+            (dev.inputs[i].IsOn() ? on : free) |= uint32_t(1) << i;
+
+        uint32_t wanted = 0;
+        bool     failing = false;
+
+        auto rule = Rule::Compile(dev.rule);
+        if (rule.has_value() && !rule->Eval(on))
+        {
+            failing = true;
+            wanted  = rule->MinExtension(on, free).value_or(0);
+        }
+
+        for (int i = 0; i < (int)dev.inputs.size(); ++i)
+        {
+            if (dev.inputs[i].IsOn())
+                continue;
+
+            auto type = reach_.Index(dev.inputs[i].Type());
+            if (!type.has_value())
+                continue;
+
+            const int priority = (wanted & (uint32_t(1) << i)) ? 2 : (failing ? 1 : 0);
+
+            ports[side[type.value()]].push_back( { &itNode->first, i, type.value(), priority } );
+        }
+    }
+
+    for (auto& it : ports)
+        std::stable_sort(it.begin(), it.end(), [](const SPort& l_, const SPort& r_) {
+            return l_.priority > r_.priority;
+        });
+
+    const std::vector<SPort>& left  = ports[0];
+    const std::vector<SPort>& right = ports[1];
+
+    HopcroftKarp::TAdjacency adj(left.size());
+    for (size_t u = 0; u < left.size(); ++u)
+        for (size_t v = 0; v < right.size(); ++v)
+            if (*left[u].node != *right[v].node && reach_.Mates(left[u].type, right[v].type))
+                adj[u].push_back((int)v);
+
+    std::vector<int> match;
+
+    // A pair of nodes gets at most one binding: the first matched edge
+    // between them is kept, the others are dropped and matching repeated
+    while (true)
+    {
+        match = priority_match(adj, left, right);
+
+        std::map<std::pair<TNodeId, TNodeId>, int> kept;
+        bool changed = false;
+
+        for (size_t u = 0; u < left.size(); ++u)
+        {
+            if (match[u] == -1)
+                continue;
+
+            auto pair = std::minmax(*left[u].node, *right[match[u]].node);
+            auto itKept = kept.insert( { { pair.first, pair.second }, (int)u } );
+            if (itKept.second)
+                continue;
+
+            // Leaving only the kept edge between the two nodes
+            const int keep_u = itKept.first->second;
+            for (size_t w = 0; w < left.size(); ++w)
+            {
+                auto& edges = adj[w];
+                auto last = std::remove_if(edges.begin(), edges.end(), [&](int v_) {
+                    auto other = std::minmax(*left[w].node, *right[v_].node);
+                    return other == pair && !((int)w == keep_u && v_ == match[keep_u]);
+                });
+                changed = changed || last != edges.end();
+                edges.erase(last, edges.end());
+            }
+        }
+
+        if (!changed)
+            break;
+    }
+
+    std::vector<SBinding> result;
+    for (size_t u = 0; u < left.size(); ++u)
+        if (match[u] != -1)
+            result.push_back( { *left[u].node, left[u].input, *right[match[u]].node, right[match[u]].input } );
+
+    return result;
+}
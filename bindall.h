@@ -0,0 +1,45 @@
+#ifndef BINDALL_H
+#define BINDALL_H
+
+#include "scheme.h"
+#include "portreach.h"
+
+//----------------------------------------------------------------------
+// Maximum cardinality matching in a bipartite graph (Hopcroft-Karp).
+//
+// Vertices are tried in the order of the adjacency lists, so callers
+// put preferred vertices first; the initial greedy pass takes the first
+// free partner of every left vertex. Augmenting paths never unmatch a
+// vertex, so a matching to start from keeps all its vertices matched.
+class HopcroftKarp
+{
+public:
+    typedef std::vector<std::vector<int>> TAdjacency;
+
+    // Partner of every left vertex in adj_, -1 if unmatched. match_ is
+    // the matching to start from, in the same form, or empty.
+    static std::vector<int> Run(const TAdjacency& adj_, int right_count_, std::vector<int> match_ = {});
+};
+
+//----------------------------------------------------------------------
+struct SBinding
+{
+    TNodeId lnode;
+    int     linput;
+    TNodeId rnode;
+    int     rinput;
+};
+
+//----------------------------------------------------------------------
+// Binds as many free ports of a group of nodes as possible.
+//
+// Port types are split into the two sides of the mating relation of the
+// "connections" catalog (e.g. _F and _M), which makes the port graph
+// bipartite. Ports of nodes whose rule does not hold yet come first,
+// ports that would satisfy such a rule ahead of all others: the matching
+// is grown one priority at a time on each side, so of all the maximum
+// matchings it covers as many ports of the highest priority as any, then
+// of the next one. Two nodes are never bound twice to each other.
+std::vector<SBinding> PlanBindAll(const TNodeList& nodes_, const std::vector<TNodeId>& group_, const PortReach& reach_);
+
+#endif // BINDALL_H
@@ -0,0 +1,562 @@
+#include "bom.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <charconv>
+#include <cmath>
+#include <tuple>
+
+#include "components.h"
+#include "arenascheme.h"
+#include "schemeview.h"
+#include "schemeio.h"
+#include "schemecompress.h"
+#include "profiler.h"
+
+//----------------------------------------------------------------------
+// All report output goes through one buffer flushed in large blocks
+class ReportWriter
+{
+public:
+    explicit ReportWriter(const std::string& file_name_) : m_pFile(std::fopen(file_name_.c_str(), "wb"))
+    {
+        m_buffer.reserve(buffer_size);
+    }
+
+    // Collects the report in text_ instead of a file
+    explicit ReportWriter(std::string& text_) : m_pFile(nullptr), m_pText(&text_)
+    {}
+
+    ~ReportWriter()
+    {
+        Close();
+    }
+
+    bool IsOpen() const { return m_pFile != nullptr || m_pText != nullptr; }
+
+    // Flushes and closes the file, false if any write to it failed
+    bool Close()
+    {
+        if (m_pFile)
+        {
+            Flush();
+            m_failed |= std::fclose(m_pFile) != 0;
+            m_pFile = nullptr;
+        }
+
+        return !m_failed;
+    }
+
+    ReportWriter& operator<<(const std::string& str_)   { return put(str_.data(), str_.size()); }
+    ReportWriter& operator<<(const char* str_)          { return put(str_, std::char_traits<char>::length(str_)); }
+    ReportWriter& operator<<(char ch_)                  { return put(&ch_, 1); }
+
+    ReportWriter& operator<<(int val_)
+    {
+        char buf[16];
+        auto result = std::to_chars(buf, buf + sizeof(buf), val_);
+        return put(buf, result.ptr - buf);
+    }
+
+    ReportWriter& operator<<(double val_)
+    {
+        char buf[32];
+        int size = std::snprintf(buf, sizeof(buf), "%.10g", val_);
+        return put(buf, size);
+    }
+
+    void Flush()
+    {
+        if (!m_buffer.empty() && std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_pFile) != m_buffer.size())
+            m_failed = true;
+        m_buffer.clear();
+    }
+
+private:
+    static const size_t buffer_size = 1 << 16;
+
+    ReportWriter& put(const char* data_, size_t size_)
+    {
+        if (m_pText)
+        {
+            m_pText->append(data_, size_);
+            return *this;
+        }
+
+        if (m_buffer.size() + size_ > buffer_size)
+            Flush();
+
+        m_buffer.append(data_, size_);
+        return *this;
+    }
+
+    std::FILE*   m_pFile;
+    std::string* m_pText    {};
+    std::string  m_buffer;
+    bool         m_failed   {};
+};
+
+//----------------------------------------------------------------------
+struct SQuoted
+{
+    const std::string& str;
+    char               format;
+};
+
+//----------------------------------------------------------------------
+ReportWriter& operator<<(ReportWriter& writer_, const SQuoted& quoted_)
+{
+    const std::string& str = quoted_.str;
+
+    if (quoted_.format == 'c')
+    {
+        if (str.find_first_of(",\"\n\r") == std::string::npos)
+            return writer_ << str;
+
+        writer_ << '"';
+        for (char ch : str)
+        {
+            if (ch == '"')
+                writer_ << '"';
+            writer_ << ch;
+        }
+        return writer_ << '"';
+    }
+
+    writer_ << '"';
+    for (char ch : str)
+    {
+        switch (ch)
+        {
+        case '"':  writer_ << "\\\""; break;
+        case '\\': writer_ << "\\\\"; break;
+        case '\n': writer_ << "\\n";  break;
+        case '\r': writer_ << "\\r";  break;
+        case '\t': writer_ << "\\t";  break;
+        default:
+            if ((unsigned char)ch < 0x20)
+            {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)ch);
+                writer_ << buf;
+            }
+            else
+                writer_ << ch;
+        }
+    }
+    return writer_ << '"';
+}
+
+//----------------------------------------------------------------------
+static SQuoted csv (const std::string& str_) { return { str_, 'c' }; }
+static SQuoted json(const std::string& str_) { return { str_, 'j' }; }
+
+//----------------------------------------------------------------------
+// JSON has no inf or nan, they are written as null
+struct SJsonNumber
+{
+    double val;
+};
+
+static SJsonNumber json(double val_) { return { val_ }; }
+
+ReportWriter& operator<<(ReportWriter& writer_, const SJsonNumber& number_)
+{
+    return std::isfinite(number_.val) ? writer_ << number_.val : writer_ << "null";
+}
+
+//----------------------------------------------------------------------
+static void write_text(ReportWriter& writer_, const SBom& bom_)
+{
+    if (!bom_.source.empty())
+        writer_ << "//============ Scheme: " << bom_.source << '\n';
+
+    int i = 0;
+    const TCategory* pCategory = nullptr;
+
+    for (const auto& it : bom_.lines)
+    {
+        if (!pCategory || *pCategory != it.category)
+        {
+            pCategory = &it.category;
+            writer_ << "//============ Category: " << (it.category.empty() ? std::string("-") : it.category) << '\n';
+        }
+
+        writer_ << "//============ Device #" << ++i << '\n';
+        writer_ << "Items: " << it.count << '\n';
+        writer_ << "Power: " << it.power * it.count << " W\n";
+        writer_ << it.description << '\n';
+    }
+
+    writer_ << "//============ Total\n";
+    writer_ << "Devices: " << bom_.devices << '\n';
+    writer_ << "Cables: "  << bom_.cables  << '\n';
+    writer_ << "Power: "   << bom_.power   << " W\n";
+
+    writer_ << "//============ Components: " << (int)bom_.components.size() << '\n';
+    for (int j = 0; j < (int)bom_.components.size(); ++j)
+        writer_ << "Component #" << j + 1 << ": " << bom_.components[j] << " items\n";
+
+    if (!bom_.islands.empty())
+    {
+        writer_ << "Islands:\n";
+        for (const auto& it : bom_.islands)
+            writer_ << it << '\n';
+    }
+}
+
+//----------------------------------------------------------------------
+static void write_csv(ReportWriter& writer_, const SBom& bom_)
+{
+    for (const auto& it : bom_.lines)
+    {
+        writer_ << csv(bom_.source) << ',' << csv(it.category) << ',' << csv(it.id) << ',' << csv(it.name) << ','
+                << (it.cable ? "1" : "0") << ',' << it.count << ',' << it.power << ',' << it.power * it.count << '\n';
+    }
+}
+
+//----------------------------------------------------------------------
+static void write_json(ReportWriter& writer_, const SBom& bom_)
+{
+    writer_ << "{\"source\":" << json(bom_.source)
+            << ",\"devices\":" << bom_.devices
+            << ",\"cables\":"  << bom_.cables
+            << ",\"power\":"   << json(bom_.power)
+            << ",\"components\":[";
+
+    for (int i = 0; i < (int)bom_.components.size(); ++i)
+        writer_ << (i ? "," : "") << bom_.components[i];
+
+    writer_ << "],\"islands\":[";
+
+    for (int i = 0; i < (int)bom_.islands.size(); ++i)
+        writer_ << (i ? "," : "") << json(bom_.islands[i]);
+
+    writer_ << "],\"items\":[";
+
+    for (int i = 0; i < (int)bom_.lines.size(); ++i)
+    {
+        const SBomLine& line = bom_.lines[i];
+
+        writer_ << (i ? ",\n" : "\n")
+                << "{\"category\":" << json(line.category)
+                << ",\"id\":"       << json(line.id)
+                << ",\"name\":"     << json(line.name)
+                << ",\"cable\":"    << (line.cable ? "true" : "false")
+                << ",\"count\":"    << line.count
+                << ",\"power\":"    << json(line.power) << '}';
+    }
+
+    writer_ << "]}";
+}
+
+//----------------------------------------------------------------------
+class BomReport
+{
+public:
+    BomReport(ReportWriter& writer_, BomEngine::EFormat format_) : m_writer(writer_), m_format(format_)
+    {
+        if (m_format == BomEngine::eCsv)
+            m_writer << "source,category,id,name,cable,count,power,total_power\n";
+        else if (m_format == BomEngine::eJson)
+            m_writer << '[';
+    }
+
+    ~BomReport()
+    {
+        if (m_format == BomEngine::eJson)
+            m_writer << "]\n";
+    }
+
+    void Add(const SBom& bom_)
+    {
+        switch (m_format)
+        {
+        case BomEngine::eText:
+            write_text(m_writer, bom_);
+            break;
+        case BomEngine::eCsv:
+            write_csv(m_writer, bom_);
+            break;
+        case BomEngine::eJson:
+            m_writer << (m_count ? ",\n" : "\n");
+            write_json(m_writer, bom_);
+            break;
+        }
+
+        ++m_count;
+    }
+
+private:
+    ReportWriter&       m_writer;
+    BomEngine::EFormat  m_format;
+    int                 m_count {};
+};
+
+//----------------------------------------------------------------------
+BomEngine::BomEngine(const TCategoryList& catalog_, const std::string* pDictionary_) : m_catalog(catalog_), m_pDictionary(pDictionary_)
+{
+    for (const auto& itCategory : catalog_)
+        for (const auto& itDev : itCategory.second)
+            m_categories[itDev.first] = itCategory.first;
+}
+
+//----------------------------------------------------------------------
+BomEngine::EFormat BomEngine::FormatOf(const std::string& file_name_)
+{
+    const std::string::size_type dot = file_name_.rfind('.');
+    const std::string ext = dot != std::string::npos ? to_lower(file_name_.substr(dot + 1)) : std::string();
+
+    if (ext == "csv")
+        return eCsv;
+
+    if (ext == "json")
+        return eJson;
+
+    return eText;
+}
+
+//----------------------------------------------------------------------
+int BomEngine::intern(const TDevId& id_)
+{
+    auto it = m_interned.find(id_);
+    if (it != m_interned.end())
+        return it->second;
+
+    const int ind = (int)m_interned.size();
+    m_interned.emplace(id_, ind);
+
+    return ind;
+}
+
+//----------------------------------------------------------------------
+// Build() works on regular, arena-backed and mapped schemes alike
+static const std::string& std_str(const std::string& str_)       { return str_; }
+static std::string        std_str(const std::pmr::string& str_)  { return std::string(str_); }
+static std::string        std_str(std::string_view str_)         { return std::string(str_); }
+
+static std::string description(const SDevice& dev_)      { return dev_.Print_description(); }
+static std::string description(const SArenaDevice& dev_) { return dev_.ToDevice().Print_description(); }
+static std::string description(const SDeviceView& dev_)  { return dev_.ToDevice().Print_description(); }
+
+static void rebuild(ComponentIndex& components_, const TNodeList& nodes_, const TLinkList& links_)
+{
+    components_.Rebuild(nodes_, links_);
+}
+
+template <class TNodes, class TLinks>
+static void rebuild(ComponentIndex& components_, const TNodes& nodes_, const TLinks& links_)
+{
+    for (const auto& it : nodes_)
+        components_.AddNode(std_str(it.first));
+
+    SLink link;
+    for (const auto& it : links_)
+    {
+        link.nodes[0] = std_str(it.second.nodes[0]);
+        link.nodes[1] = std_str(it.second.nodes[1]);
+        components_.AddLink(link);
+    }
+}
+
+//----------------------------------------------------------------------
+SBom BomEngine::Build(const TNodeList& nodes_, const TLinkList& links_)
+{
+    return build(nodes_, links_);
+}
+
+//----------------------------------------------------------------------
+SBom BomEngine::Build(const ArenaScheme& scheme_)
+{
+    return build(scheme_.Nodes(), scheme_.Links());
+}
+
+//----------------------------------------------------------------------
+SBom BomEngine::Build(const SchemeView& scheme_)
+{
+    return build(scheme_.Nodes(), scheme_.Links());
+}
+
+//----------------------------------------------------------------------
+template <class TNodes, class TLinks>
+SBom BomEngine::build(const TNodes& nodes_, const TLinks& links_)
+{
+    PROFILE_SCOPE("bom_build");
+
+    using TDevice = typename TNodes::mapped_type;
+
+    SBom bom;
+
+    std::vector<int>            counts(m_interned.size());
+    std::vector<const TDevice*> devices(m_interned.size());
+    std::vector<int>            used;
+
+    for (const auto& it : nodes_)
+    {
+        const TDevice& dev = it.second;
+
+        const int ind = intern(std_str(dev.id));
+        if (ind >= (int)counts.size())
+        {
+            counts.resize(ind + 1);
+            devices.resize(ind + 1);
+        }
+
+        if (counts[ind]++ == 0)
+        {
+            devices[ind] = &dev;
+            used.push_back(ind);
+        }
+
+        (dev.IsCable() ? bom.cables : bom.devices)++;
+        bom.power += dev.power;
+    }
+
+    bom.lines.reserve(used.size());
+
+    for (int ind : used)
+    {
+        const TDevice& dev = *devices[ind];
+
+        auto itCategory = m_categories.find(std_str(dev.id));
+
+        bom.lines.push_back( { itCategory != m_categories.end() ? itCategory->second : TCategory(),
+                               std_str(dev.id), std_str(dev.name), description(dev), dev.IsCable(), counts[ind], dev.power } );
+    }
+
+    std::sort(bom.lines.begin(), bom.lines.end(), [](const SBomLine& l_, const SBomLine& r_) {
+        return std::tie(l_.category, l_.name, l_.id) < std::tie(r_.category, r_.name, r_.id);
+    });
+
+    ComponentIndex components;
+    rebuild(components, nodes_, links_);
+    bom.components = components.Sizes();
+
+    if (components.Count() > 1)
+        for (const auto& it : components.Islands())
+            bom.islands.push_back(std_str(nodes_.at(typename TNodes::key_type(it)).name));
+
+    return bom;
+}
+
+//----------------------------------------------------------------------
+bool BomEngine::Write(const std::vector<SBom>& boms_, EFormat format_, const std::string& file_name_) const
+{
+    ReportWriter writer(file_name_);
+    if (!writer.IsOpen())
+    {
+        Log("Failed to open " + file_name_);
+        return false;
+    }
+
+    {
+        BomReport report(writer, format_);
+
+        for (const auto& it : boms_)
+            report.Add(it);
+    }
+
+    if (!writer.Close())
+    {
+        Log("Failed to write " + file_name_);
+        return false;
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+std::string BomEngine::Report(const std::vector<SBom>& boms_, EFormat format_) const
+{
+    std::string text;
+    ReportWriter writer(text);
+
+    {
+        BomReport report(writer, format_);
+
+        for (const auto& it : boms_)
+            report.Add(it);
+    }
+
+    return text;
+}
+
+//----------------------------------------------------------------------
+bool BomEngine::Batch(const std::vector<std::string>& schemes_, EFormat format_, const std::string& file_name_)
+{
+    ReportWriter writer(file_name_);
+    if (!writer.IsOpen())
+    {
+        Log("Failed to open " + file_name_);
+        return false;
+    }
+
+    // Schemes that fail to load are logged and left out, the rest still
+    // make it into the report
+    bool result = true;
+
+    {
+        BomReport report(writer, format_);
+
+        // Plain schemes are decoded in place from their mapped files,
+        // compressed ones into an arena that is given back in one go when
+        // the next one is loaded
+        SchemeView  scheme;
+        ArenaScheme arena;
+
+        for (const auto& it : schemes_)
+        {
+            SBom bom;
+
+            // Compact schemes only make sense once resolved against the
+            // catalog
+            if (IsCompactScheme(it, m_pDictionary))
+            {
+                TNodeList nodes;
+                TLinkList links;
+                if (!LoadScheme(it, nodes, links, &m_catalog, m_pDictionary))
+                {
+                    Log("Skipped " + it + ", the scheme could not be read");
+                    result = false;
+                    continue;
+                }
+
+                bom = Build(nodes, links);
+            }
+            else if (IsCompressedScheme(it))
+            {
+                if (!arena.Load(it, m_pDictionary))
+                {
+                    Log("Skipped " + it + ", the scheme could not be read");
+                    result = false;
+                    continue;
+                }
+
+                bom = Build(arena);
+            }
+            else
+            {
+                if (!scheme.Open(it))
+                {
+                    Log("Skipped " + it + ", the scheme could not be read");
+                    result = false;
+                    continue;
+                }
+
+                bom = Build(scheme);
+            }
+
+            bom.source = it;
+
+            report.Add(bom);
+        }
+    }
+
+    if (!writer.Close())
+    {
+        Log("Failed to write " + file_name_);
+        return false;
+    }
+
+    return result;
+}
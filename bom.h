@@ -0,0 +1,81 @@
+#ifndef BOM_H
+#define BOM_H
+
+#include <unordered_map>
+
+#include "scheme.h"
+
+class ArenaScheme;
+class SchemeView;
+
+//----------------------------------------------------------------------
+// Bill of materials of a scheme
+struct SBomLine
+{
+    TCategory   category;
+    TDevId      id;
+    std::string name;
+    std::string description;
+    bool        cable {};
+    int         count {};
+    double      power {};   // Per item
+};
+
+struct SBom
+{
+    std::string             source;
+    std::vector<SBomLine>   lines;          // Ordered by category and name
+    std::vector<int>        components;     // Component sizes, largest first
+    std::vector<std::string> islands;       // Names of nodes outside the largest component
+
+    int     devices {};
+    int     cables  {};
+    double  power   {};
+};
+
+//----------------------------------------------------------------------
+// Aggregates schemes into bills of materials and writes them as text,
+// CSV or JSON.
+//
+// Device ids are interned once per engine, so a batch over many schemes
+// counts items in a flat vector indexed by the interned id instead of
+// looking them up by string per node.
+class BomEngine
+{
+public:
+    enum EFormat { eText, eCsv, eJson };
+
+    // pDictionary_ inflates compressed schemes in Batch()
+    explicit BomEngine(const TCategoryList& catalog_, const std::string* pDictionary_ = nullptr);
+
+    SBom Build(const TNodeList& nodes_, const TLinkList& links_);
+    SBom Build(const ArenaScheme& scheme_);
+    SBom Build(const SchemeView& scheme_);
+
+    // Writes the reports of all schemes into a single file, false if it
+    // could not be written
+    bool Write(const std::vector<SBom>& boms_, EFormat format_, const std::string& file_name_) const;
+
+    // The same reports as text
+    std::string Report(const std::vector<SBom>& boms_, EFormat format_) const;
+
+    // Loads every scheme and writes their reports into a single file.
+    // Schemes that fail to load are logged and left out, which makes the
+    // result false as well as a failed write does
+    bool Batch(const std::vector<std::string>& schemes_, EFormat format_, const std::string& file_name_);
+
+    static EFormat FormatOf(const std::string& file_name_);
+
+private:
+    int intern(const TDevId& id_);
+
+    template <class TNodes, class TLinks>
+    SBom build(const TNodes& nodes_, const TLinks& links_);
+
+    const TCategoryList&                    m_catalog;
+    const std::string*                      m_pDictionary;
+    std::unordered_map<TDevId, TCategory>   m_categories;
+    std::unordered_map<TDevId, int>         m_interned;
+};
+
+#endif // BOM_H
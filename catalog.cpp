@@ -0,0 +1,42 @@
+#include "catalog.h"
+
+#include <fstream>
+
+//----------------------------------------------------------------------
+TDevList LoadDevList(const std::string& file_)
+{
+    TDevList result;
+
+    std::ifstream file(file_);
+
+    TDevList::iterator current_dev = result.end();
+
+    if (file.is_open())
+    {
+        std::string line;
+        while (std::getline(file, line))
+        {
+            auto dev_id = SDevice::IdParam(line);
+
+            if (dev_id.has_value())
+            {
+                auto insert_result = result.insert( { dev_id.value(), SDevice() } );
+
+                if (insert_result.second)
+                    current_dev = insert_result.first;
+                else
+                {
+                    Log("Error! Device id collision: " + dev_id.value());
+                    current_dev = result.end();
+                }
+            }
+
+            if (current_dev != result.end())
+                current_dev->second.Parse_param(line);
+        }
+
+        file.close();
+    }
+
+    return result;
+}
@@ -0,0 +1,10 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include "scheme.h"
+
+//----------------------------------------------------------------------
+// Reads a device list file of the data folder
+TDevList LoadDevList(const std::string& file_);
+
+#endif // CATALOG_H
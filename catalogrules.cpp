@@ -0,0 +1,58 @@
+#include "catalogrules.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+
+#include "rule.h"
+
+#include "catalogrules.inc"
+
+//----------------------------------------------------------------------
+static constexpr bool sorted_by_id()
+{
+    for (size_t i = 1; i < std::size(catalog_rules); ++i)
+        if (std::string_view(catalog_rules[i - 1].dev_id) >= std::string_view(catalog_rules[i].dev_id))
+            return false;
+
+    return true;
+}
+
+static_assert(sorted_by_id(), "catalogrules.inc has to be sorted by device id, regenerate it with tools/rulegen");
+
+//----------------------------------------------------------------------
+bool SCatalogRule::Eval(uint32_t on_) const
+{
+    return (catalog_rule_bits[table + (on_ >> 6)] >> (on_ & 63)) & 1;
+}
+
+//----------------------------------------------------------------------
+const SCatalogRule* FindCatalogRule(const SDevice& dev_)
+{
+    const SCatalogRule* pEnd = std::end(catalog_rules);
+
+    auto it = std::lower_bound(std::begin(catalog_rules), pEnd, dev_.id, [](const SCatalogRule& rule_, const TDevId& id_) {
+        return strcmp(rule_.dev_id, id_.c_str()) < 0;
+    });
+
+    if (it == pEnd || dev_.id != it->dev_id || dev_.inputs.size() != it->inputs || dev_.rule != it->rule)
+        return nullptr;
+
+    return it;
+}
+
+//----------------------------------------------------------------------
+bool ResolveCatalogRule(const SDevice& dev_)
+{
+    const SCatalogRule* pRule = FindCatalogRule(dev_);
+    if (!pRule)
+        return ResolveRule(dev_);
+
+    uint32_t on = 0;
+    for (uint32_t i = 0; i < pRule->inputs; ++i)
+        if (dev_.inputs[i].IsOn())
+            on |= uint32_t(1) << i;
+
+    return pRule->Eval(on);
+}
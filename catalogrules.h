@@ -0,0 +1,37 @@
+#ifndef CATALOGRULES_H
+#define CATALOGRULES_H
+
+#include <cstdint>
+
+#include "scheme.h"
+
+//----------------------------------------------------------------------
+// Rules of the stock catalog compiled into the program.
+//
+// tools/rulegen reads data/ and writes catalogrules.inc: the truth table
+// of every device rule, indexed by the mask of connected inputs, and the
+// devices sorted by id. Checking a stock device is then a binary search
+// and a bit test. A device only counts as stock while its id, rule and
+// input count match the generated ones, so devices made with "New
+// device" and catalogs edited after the build go through LibBoolEE.
+
+//----------------------------------------------------------------------
+struct SCatalogRule
+{
+    const char* dev_id;
+    const char* rule;
+    uint32_t    inputs;     // The table has a bit for every mask of them
+    uint32_t    table;      // First word of the table in the generated bits
+
+    bool Eval(uint32_t on_) const;
+};
+
+//----------------------------------------------------------------------
+// Generated rule of a stock device, null for other devices
+const SCatalogRule* FindCatalogRule(const SDevice& dev_);
+
+// Evaluates the rule with the generated table of a stock device and with
+// LibBoolEE for other devices
+bool ResolveCatalogRule(const SDevice& dev_);
+
+#endif // CATALOGRULES_H
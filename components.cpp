@@ -0,0 +1,147 @@
+#include "components.h"
+
+#include <algorithm>
+
+//----------------------------------------------------------------------
+int ComponentIndex::find(int ind_) const
+{
+    int root = ind_;
+    while (m_parent[root] != root)
+        root = m_parent[root];
+
+    // Path compression
+    while (m_parent[ind_] != root)
+    {
+        int next = m_parent[ind_];
+        m_parent[ind_] = root;
+        ind_ = next;
+    }
+
+    return root;
+}
+
+//----------------------------------------------------------------------
+int ComponentIndex::index(const TNodeId& id_) const
+{
+    auto it = m_index.find(id_);
+    return it != m_index.end() ? it->second : -1;
+}
+
+//----------------------------------------------------------------------
+void ComponentIndex::Rebuild(const TNodeList& nodes_, const TLinkList& links_)
+{
+    m_index.clear();
+    m_ids.clear();
+    m_parent.clear();
+    m_size.clear();
+    m_count = 0;
+
+    m_ids.reserve(nodes_.size());
+    m_parent.reserve(nodes_.size());
+    m_size.reserve(nodes_.size());
+
+    for (const auto& it : nodes_)
+        AddNode(it.first);
+
+    for (const auto& it : links_)
+        AddLink(it.second);
+}
+
+//----------------------------------------------------------------------
+void ComponentIndex::AddNode(const TNodeId& id_)
+{
+    if (m_index.count(id_))
+        return;
+
+    const int ind = (int)m_ids.size();
+
+    m_index[id_] = ind;
+    m_ids.push_back(id_);
+    m_parent.push_back(ind);
+    m_size.push_back(1);
+    ++m_count;
+}
+
+//----------------------------------------------------------------------
+void ComponentIndex::AddLink(const SLink& link_)
+{
+    const int l = index(link_.nodes[0]);
+    const int r = index(link_.nodes[1]);
+    if (l < 0 || r < 0)
+        return;
+
+    int lroot = find(l);
+    int rroot = find(r);
+    if (lroot == rroot)
+        return;
+
+    // Union by size
+    if (m_size[lroot] < m_size[rroot])
+        std::swap(lroot, rroot);
+
+    m_parent[rroot] = lroot;
+    m_size[lroot] += m_size[rroot];
+    --m_count;
+}
+
+//----------------------------------------------------------------------
+std::vector<int> ComponentIndex::Sizes() const
+{
+    std::vector<int> result;
+
+    for (int i = 0; i < (int)m_ids.size(); ++i)
+        if (m_parent[i] == i)
+            result.push_back(m_size[i]);
+
+    std::sort(result.rbegin(), result.rend());
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+TNodeId ComponentIndex::Component(const TNodeId& id_) const
+{
+    const int ind = index(id_);
+    return ind >= 0 ? m_ids[find(ind)] : TNodeId();
+}
+
+//----------------------------------------------------------------------
+int ComponentIndex::Size(const TNodeId& id_) const
+{
+    const int ind = index(id_);
+    return ind >= 0 ? m_size[find(ind)] : 0;
+}
+
+//----------------------------------------------------------------------
+std::vector<TNodeId> ComponentIndex::Members(const TNodeId& id_) const
+{
+    std::vector<TNodeId> result;
+
+    const int ind = index(id_);
+    if (ind < 0)
+        return result;
+
+    const int root = find(ind);
+    for (int i = 0; i < (int)m_ids.size(); ++i)
+        if (find(i) == root)
+            result.push_back(m_ids[i]);
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+std::vector<TNodeId> ComponentIndex::Islands() const
+{
+    std::vector<TNodeId> result;
+
+    int largest = -1;
+    for (int i = 0; i < (int)m_ids.size(); ++i)
+        if (m_parent[i] == i && (largest < 0 || m_size[i] > m_size[largest]))
+            largest = i;
+
+    for (int i = 0; i < (int)m_ids.size(); ++i)
+        if (find(i) != largest)
+            result.push_back(m_ids[i]);
+
+    return result;
+}
@@ -0,0 +1,47 @@
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include <unordered_map>
+
+#include "scheme.h"
+
+//----------------------------------------------------------------------
+// Connected components of the scheme graph (nodes joined by links).
+//
+// A union-find forest grows with added nodes and links; removing a node
+// or a link can split a component, which union-find cannot undo, so the
+// forest is rebuilt from the scheme in that case.
+class ComponentIndex
+{
+public:
+    void Rebuild(const TNodeList& nodes_, const TLinkList& links_);
+
+    void AddNode(const TNodeId& id_);
+    void AddLink(const SLink& link_);
+
+    int  Count() const { return m_count; }
+
+    // Component sizes, largest first
+    std::vector<int> Sizes() const;
+
+    // Representative node of the component, empty for unknown nodes
+    TNodeId Component(const TNodeId& id_) const;
+    int     Size(const TNodeId& id_) const;
+
+    std::vector<TNodeId> Members(const TNodeId& id_) const;
+
+    // Nodes outside the largest component
+    std::vector<TNodeId> Islands() const;
+
+private:
+    int find(int ind_) const;
+    int index(const TNodeId& id_) const;
+
+    std::unordered_map<TNodeId, int>    m_index;
+    std::vector<TNodeId>                m_ids;
+    mutable std::vector<int>            m_parent;
+    std::vector<int>                    m_size;
+    int                                 m_count {};
+};
+
+#endif // COMPONENTS_H
@@ -0,0 +1,256 @@
+#include "explorer.h"
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <thread>
+
+//----------------------------------------------------------------------
+// Owner works on the back of its deque (depth first), thieves take from
+// the front where the largest untouched subtrees are
+class DesignExplorer::TaskQueue
+{
+public:
+    void Push(STask&& task_)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_tasks.push_back(std::move(task_));
+    }
+
+    bool Pop(STask& task_)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_tasks.empty())
+            return false;
+
+        task_ = std::move(m_tasks.back());
+        m_tasks.pop_back();
+        return true;
+    }
+
+    bool Steal(STask& task_)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_tasks.empty())
+            return false;
+
+        task_ = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex          m_lock;
+    std::deque<STask>   m_tasks;
+};
+
+//----------------------------------------------------------------------
+DesignExplorer::DesignExplorer(const TCategoryList& catalog_) :
+    m_catalog(catalog_)
+{
+    for (const auto& it_cat : m_catalog)
+        for (const auto& it_dev : it_cat.second)
+            m_category_of[it_dev.first] = it_cat.first;
+}
+
+//----------------------------------------------------------------------
+DesignExplorer::~DesignExplorer()
+{}
+
+//----------------------------------------------------------------------
+bool DesignExplorer::fits(const SDevice& dev_, const SDevice& candidate_)
+{
+    // Every bound input moves to the first unused input of the same type
+    uint32_t on = 0;
+    for (const auto& it : dev_.inputs)
+    {
+        if (!it.IsOn())
+            continue;
+
+        const std::string type = it.Type();
+
+        bool placed = false;
+        for (int i = 0; i < (int)candidate_.inputs.size() && !placed; ++i)
+        {
+            const uint32_t bit = uint32_t(1) << i;
+            if (!(on & bit) && candidate_.inputs[i].Type() == type)
+            {
+                on |= bit;
+                placed = true;
+            }
+        }
+
+        if (!placed)
+            return false;
+    }
+
+    auto it_rule = m_rules.find(candidate_.rule);
+    if (it_rule == m_rules.end())
+        it_rule = m_rules.insert( { candidate_.rule, Rule::Compile(candidate_.rule) } ).first;
+
+    return it_rule->second.has_value() && it_rule->second->Eval(on);
+}
+
+//----------------------------------------------------------------------
+std::vector<DesignExplorer::SAlternative> DesignExplorer::alternatives(const SDevice& dev_)
+{
+    std::vector<SAlternative> result;
+
+    auto it_cat = m_category_of.find(dev_.id);
+    if (it_cat != m_category_of.end())
+    {
+        for (const auto& it_dev : m_catalog.at(it_cat->second))
+        {
+            const SDevice& candidate = it_dev.second;
+
+            if (candidate.id == dev_.id || fits(dev_, candidate))
+                result.push_back( { &it_dev.first, candidate.power } );
+        }
+    }
+
+    std::stable_sort(result.begin(), result.end(), [](const SAlternative& l_, const SAlternative& r_) {
+        return l_.power < r_.power;
+    });
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+void DesignExplorer::record(const STask& task_)
+{
+    SDesign design;
+    design.power = task_.power;
+
+    for (size_t i = 0; i < m_choices.size(); ++i)
+    {
+        const SChoice& choice = m_choices[i];
+        const TDevId& id = *choice.alternatives[task_.picks[i]].id;
+
+        if (id != *choice.current)
+            design.devices[*choice.node] = id;
+    }
+
+    std::lock_guard<std::mutex> lock(m_result_lock);
+
+    m_result.insert(std::upper_bound(m_result.begin(), m_result.end(), design), std::move(design));
+
+    if ((int)m_result.size() > m_max_designs)
+        m_result.pop_back();
+
+    if ((int)m_result.size() == m_max_designs)
+        m_bound = m_result.back().power;
+}
+
+//----------------------------------------------------------------------
+void DesignExplorer::process(STask& task_, TaskQueue& queue_)
+{
+    if (task_.depth == (int)m_choices.size())
+    {
+        record(task_);
+        return;
+    }
+
+    const SChoice& choice = m_choices[task_.depth];
+
+    // Children are pushed in descending cost so the cheapest one is popped first
+    int last = -1;
+    for (int i = 0; i < (int)choice.alternatives.size(); ++i)
+    {
+        const double bound = task_.power + choice.alternatives[i].power + m_suffix_min[task_.depth + 1];
+        if (bound >= m_bound)
+            break;
+        last = i;
+    }
+
+    for (int i = last; i >= 0; --i)
+    {
+        STask child;
+        child.depth = task_.depth + 1;
+        child.power = task_.power + choice.alternatives[i].power;
+        child.picks = task_.picks;
+        child.picks.push_back((uint16_t)i);
+
+        ++m_pending;
+        queue_.Push(std::move(child));
+    }
+}
+
+//----------------------------------------------------------------------
+void DesignExplorer::worker(int index_)
+{
+    TaskQueue& own = *m_queues[index_];
+    const int count = (int)m_queues.size();
+
+    STask task;
+    while (m_pending > 0)
+    {
+        bool found = own.Pop(task);
+
+        for (int i = 1; i < count && !found; ++i)
+            found = m_queues[(index_ + i) % count]->Steal(task);
+
+        if (!found)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Bound may have tightened since the task was queued
+        if (task.power + m_suffix_min[task.depth] < m_bound)
+            process(task, own);
+
+        --m_pending;
+    }
+}
+
+//----------------------------------------------------------------------
+std::vector<SDesign> DesignExplorer::Run(const TNodeList& nodes_, int max_designs_, int threads_)
+{
+    m_choices.clear();
+    m_result.clear();
+    m_base_power    = 0.0;
+    m_max_designs   = std::max(1, max_designs_);
+    m_bound         = std::numeric_limits<double>::infinity();
+
+    for (const auto& it : nodes_)
+    {
+        const SDevice& dev = it.second;
+
+        if (dev.IsCable())
+            continue;
+
+        std::vector<SAlternative> alts = alternatives(dev);
+        if (alts.size() < 2)
+        {
+            m_base_power += dev.power;
+            continue;
+        }
+
+        m_choices.push_back( { &it.first, &dev.id, std::move(alts) } );
+    }
+
+    m_suffix_min.assign(m_choices.size() + 1, 0.0);
+    for (int i = (int)m_choices.size() - 1; i >= 0; --i)
+        m_suffix_min[i] = m_suffix_min[i + 1] + m_choices[i].alternatives.front().power;
+
+    if (threads_ <= 0)
+        threads_ = std::max(1u, std::thread::hardware_concurrency());
+
+    m_queues.clear();
+    for (int i = 0; i < threads_; ++i)
+        m_queues.push_back(std::make_unique<TaskQueue>());
+
+    m_pending = 1;
+    m_queues[0]->Push( { 0, m_base_power, {} } );
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads_; ++i)
+        workers.emplace_back(&DesignExplorer::worker, this, i);
+
+    for (auto& it : workers)
+        it.join();
+
+    m_queues.clear();
+
+    return std::move(m_result);
+}
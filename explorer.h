@@ -0,0 +1,87 @@
+#ifndef EXPLORER_H
+#define EXPLORER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "scheme.h"
+#include "rule.h"
+
+//----------------------------------------------------------------------
+struct SDesign
+{
+    std::map<TNodeId, TDevId>   devices;    // Substituted nodes only
+    double                      power   {};
+
+    bool operator<(const SDesign& other_) const { return power < other_.power; }
+};
+
+//----------------------------------------------------------------------
+// Enumerates alternative designs of a scheme.
+//
+// A node may be replaced by any catalog device of the same category that
+// offers a port of the right type for each of its bindings and whose rule
+// still holds with those bindings. Cables are kept as they are: they
+// draw no power and stay one per link, so every design has the same cable
+// count and designs are ranked by power alone. The cheapest are found by
+// branch and bound over the substitutions, run on a pool of threads with
+// work-stealing deques; the best known bound is shared between threads.
+class DesignExplorer
+{
+public:
+    explicit DesignExplorer(const TCategoryList& catalog_);
+    ~DesignExplorer();
+
+    std::vector<SDesign> Run(const TNodeList& nodes_, int max_designs_, int threads_ = 0);
+
+private:
+    struct SAlternative
+    {
+        const TDevId*   id;
+        double          power;
+    };
+
+    struct SChoice
+    {
+        const TNodeId*              node;
+        const TDevId*               current;
+        std::vector<SAlternative>   alternatives;   // Ascending power
+    };
+
+    struct STask
+    {
+        int                     depth;
+        double                  power;
+        std::vector<uint16_t>   picks;
+    };
+
+    class TaskQueue;
+
+    std::vector<SAlternative> alternatives(const SDevice& dev_);
+    bool fits(const SDevice& dev_, const SDevice& candidate_);
+
+    void process(STask& task_, TaskQueue& queue_);
+    void record(const STask& task_);
+    void worker(int index_);
+
+    const TCategoryList&                                    m_catalog;
+    std::unordered_map<TDevId, TCategory>                   m_category_of;
+    std::unordered_map<std::string, std::optional<Rule>>    m_rules;
+
+    // Per exploration run
+    std::vector<SChoice>                                    m_choices;
+    std::vector<double>                                     m_suffix_min;
+    double                                                  m_base_power {};
+    int                                                     m_max_designs {};
+
+    std::vector<std::unique_ptr<TaskQueue>>                 m_queues;
+    std::atomic<long long>                                  m_pending {};
+    std::atomic<double>                                     m_bound {};
+
+    std::mutex                                              m_result_lock;
+    std::vector<SDesign>                                    m_result;
+};
+
+#endif // EXPLORER_H
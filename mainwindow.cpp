@@ -5,6 +5,8 @@
 #include <fstream>
 #include <sstream>
 #include <optional>
+#include <algorithm>
+#include <cmath>
 
 #include <QDir>
 #include <QUuid>
@@ -12,8 +14,23 @@
 #include <QTimer>
 #include <QKeyEvent>
 #include <QFileDialog>
-
-#include "LibBoolEE/LibBoolEE.h"
+#include <QProgressBar>
+#include <QElapsedTimer>
+
+#include "rule.h"
+#include "catalogrules.h"
+#include "autocomplete.h"
+#include "explorer.h"
+#include "bindall.h"
+#include "undo.h"
+#include "schemeio.h"
+#include "schemecompress.h"
+#include "schemediff.h"
+#include "catalog.h"
+#include "bom.h"
+#include "profiler.h"
+
+#include <unistd.h>
 
 //----------------------------------------------------------------------
 static const double blob_radius = 20.0;
@@ -24,177 +41,508 @@ static const QColor negative_clr(200, 50, 50, 125);
 constexpr int eUUID = Qt::UserRole + 0;
 
 //----------------------------------------------------------------------
-TDevList LoadDevList(const std::string& file_)
-{
-    TDevList result;
+static const int max_designs = 10;
+
+//----------------------------------------------------------------------
+// Scene population while loading: time budget per event loop pass and
+// number of items created between clock checks
+static const int load_slice_ms = 15;
+static const int load_chunk    = 64;
 
-    std::ifstream file(file_);
+//----------------------------------------------------------------------
+// Lazy items: schemes above the threshold open with only the visible
+// part (plus a margin in viewport sizes) materialized
+static const size_t lazy_threshold  = 20000;
+static const double view_margin     = 0.5;
+static const double scene_padding   = 200.0;
+static const size_t max_pool        = 4096;
+static const size_t bulk_items      = 1000;
 
-    TDevList::iterator current_dev = result.end();
+//----------------------------------------------------------------------
+// Colors the items by their rules, returns the number of rules evaluated
+size_t check_states(const TItemIndex& items_, const TNodeList& nodes_)
+{
+    size_t evaluated = 0;
 
-    if (file.is_open())
+    for (const auto& itNode : nodes_)
     {
-        std::string line;
-        while (std::getline(file, line))
-        {
-            auto dev_id = SDevice::IdParam(line);
+        const TNodeId& node_id  = itNode.first;
+        const SDevice& dev      = itNode.second;
 
-            if (dev_id.has_value())
-            {
-                auto insert_result = result.insert( { dev_id.value(), SDevice() } );
+        auto itItem = items_.find(node_id);
+        if (itItem != items_.end())
+        {
+            QAbstractGraphicsShapeItem* pItem = static_cast<QAbstractGraphicsShapeItem*>(itItem->second);
 
-                if (insert_result.second)
-                    current_dev = insert_result.first;
-                else
-                {
-                    Log("Error! Device id collision: " + dev_id.value());
-                    current_dev = result.end();
-                }
-            }
+            if (!ResolveCatalogRule(dev))
+                pItem->setBrush(QBrush(negative_clr));
+            else
+                pItem->setBrush(QBrush(positive_clr));
 
-            if (current_dev != result.end())
-                current_dev->second.Parse_param(line);
+            ++evaluated;
         }
+    }
 
-        file.close();
+    return evaluated;
+}
+
+//----------------------------------------------------------------------
+MainWindow::MainWindow(QWidget* pParent_) :
+    QMainWindow (pParent_           )
+  , ui          (new Ui::MainWindow )
+{
+    ui->setupUi(this);
+
+    m_root_folder = "../";
+    m_data_folder = m_root_folder + "data/";
+
+    read_categories();
+
+    // Shipped next to the catalog, compressed schemes need the same one
+    m_scheme_dictionary = LoadSchemeDictionary(m_root_folder + "scheme.dict");
+
+    QGraphicsScene* pScene = new QGraphicsScene;
+
+    ui->View->setScene(pScene);
+    ui->View->show();
+
+    // Nodes in the grid cells of the view, whether materialized or not
+    ui->View->SetItemEstimate([this](const QRectF& rect_) {
+        return m_grid.Count(rect_.left(), rect_.top(), rect_.right(), rect_.bottom());
+    });
+
+    ui->lbPerf->hide();
+
+    connect(pScene, SIGNAL(selectionChanged()), this, SLOT(selectionChanged()));
+    connect(pScene, SIGNAL(changed(QList<QRectF>)), this, SLOT(on_scene_changed(QList<QRectF>)));
+
+    QTimer* pTimer = new QTimer(this);
+    connect(pTimer, SIGNAL(timeout()), this, SLOT(checkStates()));
+    pTimer->start(1000);
+
+    m_pLoadTimer = new QTimer(this);
+    connect(m_pLoadTimer, SIGNAL(timeout()), this, SLOT(loadStep()));
+
+    m_pViewTimer = new QTimer(this);
+    m_pViewTimer->setSingleShot(true);
+    m_pViewTimer->setInterval(0);
+    connect(ui->View, SIGNAL(viewportChanged()), m_pViewTimer, SLOT(start()));
+    connect(m_pViewTimer, SIGNAL(timeout()), this, SLOT(viewChanged()));
+    connect(ui->View, SIGNAL(lodChanged(int)), this, SLOT(lodChanged(int)));
+
+    // Edits come in bursts, a drag moves a node many times a second
+    m_pPublishTimer = new QTimer(this);
+    m_pPublishTimer->setSingleShot(true);
+    m_pPublishTimer->setInterval(200);
+    connect(m_pPublishTimer, SIGNAL(timeout()), this, SLOT(publish()));
+
+    m_pProgress = new QProgressBar(this);
+    m_pProgress->hide();
+    statusBar()->addPermanentWidget(m_pProgress);
+}
+
+//----------------------------------------------------------------------
+MainWindow::~MainWindow()
+{
+    delete ui;
+}
+
+//----------------------------------------------------------------------
+QGraphicsEllipseItem* MainWindow::create_vis_node(const TNodeId& uuid_, const std::string& dev_name_)
+{
+    static const QBrush brush(QColor(Qt::lightGray), Qt::SolidPattern);
+
+    QGraphicsEllipseItem* pItem = nullptr;
+
+    if (!m_node_pool.empty())
+    {
+        pItem = m_node_pool.back();
+        m_node_pool.pop_back();
+
+        pItem->setBrush(brush);
+        static_cast<QGraphicsTextItem*>(pItem->childItems().first())->setPlainText(dev_name_.c_str());
+
+        ui->View->scene()->addItem(pItem);
+    }
+    else
+    {
+        pItem = ui->View->scene()->addEllipse(0, 0, blob_radius, blob_radius, QPen(), brush);
+
+        pItem->setFlag(QGraphicsItem::ItemIsSelectable);
+        pItem->setFlag(QGraphicsItem::ItemIsMovable);
+        pItem->setFlag(QGraphicsItem::ItemSendsGeometryChanges);
+        pItem->setZValue(1);
+
+        QGraphicsTextItem* pText = ui->View->scene()->addText(dev_name_.c_str());
+        pText->setParentItem(pItem);
     }
 
-    return result;
+    pItem->setPen(node_pen(uuid_));
+    pItem->setData(eUUID, QVariant(uuid_.c_str()));
+    apply_lod(pItem);
+
+    m_items[uuid_] = pItem;
+
+    return pItem;
 }
 
 //----------------------------------------------------------------------
-QGraphicsItem* GetItem(TNodeId node_id_, const QList<QGraphicsItem*>& items_list_)
+QGraphicsLineItem* MainWindow::create_vis_link(const TLinkId& uuid_)
 {
-    for (const auto& it : items_list_)
+    QPen pen(QColor(Qt::lightGray), Qt::SolidLine);
+
+    QGraphicsLineItem* pItem = nullptr;
+
+    if (!m_link_pool.empty())
     {
-        if (it->data(eUUID).toString().toStdString() == node_id_)
-        {
-            return it;
-        }
+        pItem = m_link_pool.back();
+        m_link_pool.pop_back();
+
+        pItem->setLine(0, 0, 0, 0);
+
+        ui->View->scene()->addItem(pItem);
     }
-    return NULL;
+    else
+        pItem = ui->View->scene()->addLine(0, 0, 0, 0, pen);
+
+    pItem->setData(eUUID, QVariant(uuid_.c_str()));
+    apply_lod(pItem);
+
+    m_items[uuid_] = pItem;
+
+    return pItem;
+}
+
+//----------------------------------------------------------------------
+QGraphicsItem* MainWindow::vis_item(const std::string& uuid_) const
+{
+    auto it = m_items.find(uuid_);
+    return it != m_items.end() ? it->second : nullptr;
+}
+
+//----------------------------------------------------------------------
+void MainWindow::remove_vis_item(const std::string& uuid_)
+{
+    auto it = m_items.find(uuid_);
+    if (it == m_items.end())
+        return;
+
+    QGraphicsItem* pItem = it->second;
+
+    pItem->setSelected(false);
+    ui->View->scene()->removeItem(pItem);
+
+    // Removed items are kept for reuse up to a limit
+    if (auto pNode = qgraphicsitem_cast<QGraphicsEllipseItem*>(pItem); pNode && m_node_pool.size() < max_pool)
+        m_node_pool.push_back(pNode);
+    else if (auto pLink = qgraphicsitem_cast<QGraphicsLineItem*>(pItem); pLink && m_link_pool.size() < max_pool)
+        m_link_pool.push_back(pLink);
+    else
+        delete pItem;
+
+    m_items.erase(it);
 }
 
 //----------------------------------------------------------------------
-void print(const QString& file_name_, const TNodeList& nodes_)
+QPointF MainWindow::node_center(const TNodeId& id_) const
 {
-    std::ofstream file(file_name_.toStdString());
+    if (auto pItem = vis_item(id_))
+        return pItem->boundingRect().center() + pItem->pos();
+
+    // Not materialized
+    auto it = m_nodes.find(id_);
+    if (it == m_nodes.end())
+        return QPointF();
+
+    return QPointF(it->second.gnode.x + blob_radius / 2, it->second.gnode.y + blob_radius / 2);
+}
 
-    // Counting occurencies
-    std::map<TDevId, int> occurencies;
-    for (const auto& it : nodes_)
+//----------------------------------------------------------------------
+void MainWindow::viewChanged()
+{
+    // Points stand in for the items, their links are merged by zoom
+    if (ui->View->Lod() == SGraphicsView::eLodPoints)
     {
-        const SDevice& dev = it.second;
-        auto itDev = occurencies.find(dev.id);
-        if (itDev != occurencies.end())
-            itDev->second++;
-        else
-            occurencies[dev.id] = 1;
+        if (!loading() && ui->View->AggregationCell() != m_cloud_cell)
+            update_point_cloud();
+
+        return;
     }
 
-    // Printing devices
-    int i = 0;
-    for (const auto& it : nodes_)
+    materialize();
+}
+
+//----------------------------------------------------------------------
+void MainWindow::materialize()
+{
+    // Nothing to materialize while points stand in for the items
+    if (!m_lazy || loading() || ui->View->Lod() == SGraphicsView::eLodPoints)
+        return;
+
+    PROFILE_SCOPE("materialize");
+
+    const QRectF view = ui->View->VisibleRect();
+    const double dx = view.width()  * view_margin;
+    const double dy = view.height() * view_margin;
+
+    std::unordered_set<TNodeId> wanted;
+
+    for (auto& it : m_grid.Query(view.left() - dx, view.top() - dy, view.right() + dx, view.bottom() + dy))
+        wanted.insert(std::move(it));
+
+    for (const auto& it : ui->View->scene()->selectedItems())
+        wanted.insert(it->data(eUUID).toString().toStdString());
+
+    // Links crossing the view, also those with both ends outside of it
+    std::unordered_set<TLinkId> wanted_links;
+
+    for (auto& it : m_link_grid.Query(view.left() - dx, view.top() - dy, view.right() + dx, view.bottom() + dy))
+        wanted_links.insert(std::move(it));
+
+    // Links stay while they cross the view or one of their ends is on screen
+    std::vector<std::string> unwanted;
+
+    for (const auto& it : m_items)
     {
-        const SDevice& dev = it.second;
+        auto itLink = m_links.find(it.first);
 
-        auto itDev = occurencies.find(dev.id);
-        if (itDev != occurencies.end())
-        {
-            const int item_count = itDev->second;
+        const bool keep = itLink != m_links.end() ? wanted_links.count(it.first) || wanted.count(itLink->second.nodes[0]) || wanted.count(itLink->second.nodes[1])
+                                                  : wanted.count(it.first) != 0;
+        if (!keep)
+            unwanted.push_back(it.first);
+    }
 
-            file << "//============ Device #" + std::to_string(++i) << std::endl;
-            file << "Items: " + std::to_string(item_count) << std::endl;
-            file << dev.Print_description() << std::endl;
-            occurencies.erase(itDev);
-        }
+    size_t created = 0;
+    for (const auto& it : wanted)
+        created += m_items.count(it) ? 0 : 1;
+
+    for (const auto& it : wanted_links)
+        created += m_items.count(it) ? 0 : 1;
+
+    SBatch batch(this, unwanted.size() + created);
+
+    for (const auto& it : unwanted)
+        remove_vis_item(it);
+
+    for (const auto& it : wanted)
+    {
+        auto itNode = m_nodes.find(it);
+        if (itNode == m_nodes.end())
+            continue;
+
+        const SDevice& dev = itNode->second;
+
+        if (!vis_item(it))
+            create_vis_node(it, dev.name)->setPos(dev.gnode.x, dev.gnode.y);
+
+        for (const auto& itInput : dev.inputs)
+            if (!itInput.connect.link.empty() && !vis_item(itInput.connect.link))
+                create_vis_link(itInput.connect.link);
     }
 
-    file.close();
+    for (const auto& it : wanted_links)
+        if (!vis_item(it))
+            create_vis_link(it);
+
+    // Scroll bars span the whole scheme, not only the materialized part
+    if (!m_grid.Empty())
+        ui->View->scene()->setSceneRect(QRectF(QPointF(m_grid.Left()  - scene_padding, m_grid.Top()    - scene_padding),
+                                               QPointF(m_grid.Right() + scene_padding, m_grid.Bottom() + scene_padding)));
 }
 
 //----------------------------------------------------------------------
-void check_states(const QList<class QGraphicsItem*>& qitems_, const TNodeList& nodes_)
+// Box of the link between the positions of its ends, gone links are removed
+void MainWindow::index_link(const TLinkId& id_)
 {
-    for (const auto& itNode : nodes_)
+    auto itLink = m_links.find(id_);
+    if (itLink == m_links.end())
     {
-        const TNodeId& node_id  = itNode.first;
-        const SDevice& dev      = itNode.second;
+        m_link_grid.Remove(id_);
+        return;
+    }
+
+    auto itLeft  = m_nodes.find(itLink->second.nodes[0]);
+    auto itRight = m_nodes.find(itLink->second.nodes[1]);
+    if (itLeft == m_nodes.end() || itRight == m_nodes.end())
+    {
+        m_link_grid.Remove(id_);
+        return;
+    }
 
-        LibBoolEE::Vals vals;
+    const SGraphNode& left  = itLeft->second.gnode;
+    const SGraphNode& right = itRight->second.gnode;
 
-        for (int i = 0; i < (int)dev.inputs.size(); ++i)
-        {
-            bool state  = dev.inputs[i].IsOn();
+    m_link_grid.Insert(id_, std::min(left.x, right.x), std::min(left.y, right.y),
+                            std::max(left.x, right.x) + blob_radius, std::max(left.y, right.y) + blob_radius);
+}
 
-            auto symbol = ind2let(i + 1);
+//----------------------------------------------------------------------
+void MainWindow::index_node_links(const TNodeId& id_)
+{
+    auto itNode = m_nodes.find(id_);
+    if (itNode == m_nodes.end())
+        return;
 
-            CheckLog(symbol, "void check_states(...)");
+    for (const auto& it : itNode->second.inputs)
+        if (!it.connect.link.empty())
+            index_link(it.connect.link);
+}
 
-            vals.insert(std::pair<std::string, bool>(std::string(1, symbol.value()), state));
-        }
+//----------------------------------------------------------------------
+void MainWindow::apply_lod(QGraphicsItem* pItem_) const
+{
+    const SGraphicsView::ELod lod = ui->View->Lod();
 
-        QAbstractGraphicsShapeItem* pItem =
-                static_cast<QAbstractGraphicsShapeItem*>(GetItem(node_id, qitems_));
-        if (pItem)
-        {
-            if (!LibBoolEE::resolve(dev.rule, vals))
-                pItem->setBrush(QBrush(negative_clr));
-            else
-                pItem->setBrush(QBrush(positive_clr));
-        }
+    pItem_->setVisible(lod != SGraphicsView::eLodPoints);
+
+    if (auto pNode = qgraphicsitem_cast<QGraphicsEllipseItem*>(pItem_))
+        pNode->childItems().first()->setVisible(lod == SGraphicsView::eLodFull);
+}
+
+//----------------------------------------------------------------------
+void MainWindow::lodChanged(int lod_)
+{
+    PROFILE_SCOPE("lod_changed");
+
+    {
+        SBatch batch(this);
+
+        for (const auto& it : m_items)
+            apply_lod(it.second);
     }
+
+    if (lod_ == SGraphicsView::eLodPoints)
+        update_point_cloud();
+    else
+        materialize();
 }
 
 //----------------------------------------------------------------------
-MainWindow::MainWindow(QWidget* pParent_) :
-    QMainWindow (pParent_           )
-  , ui          (new Ui::MainWindow )
+size_t MainWindow::update_point_cloud()
 {
-    ui->setupUi(this);
+    // Switching to points rebuilds it anyway
+    m_cloud_dirty = false;
 
-    m_root_folder = "../";
-    m_data_folder = m_root_folder + "data/";
+    if (ui->View->Lod() != SGraphicsView::eLodPoints)
+        return 0;
 
-    read_categories();
+    PROFILE_SCOPE("point_cloud");
 
-    QGraphicsScene* pScene = new QGraphicsScene;
+    SGraphicsView::SPointGroup positive { positive_clr, QPolygonF() };
+    SGraphicsView::SPointGroup negative { negative_clr, QPolygonF() };
 
-    ui->View->setScene(pScene);
-    ui->View->show();
+    for (const auto& it : m_nodes)
+        (ResolveCatalogRule(it.second) ? positive : negative).points.append(node_center(it.first));
 
-    connect(pScene, SIGNAL(selectionChanged()), this, SLOT(selectionChanged()));
-    connect(pScene, SIGNAL(changed(QList<QRectF>)), this, SLOT(on_scene_changed(QList<QRectF>)));
+    // Links are merged by the grid cells of their ends, one line per
+    // pair of cells
+    const double cell = ui->View->AggregationCell();
+    m_cloud_cell = cell;
 
-    QTimer* pTimer = new QTimer(this);
-    connect(pTimer, SIGNAL(timeout()), this, SLOT(checkStates()));
-    pTimer->start(1000);
+    auto cell_key = [cell](const QPointF& pt_) {
+        return (uint64_t)(uint32_t)std::floor(pt_.x() / cell) << 32 | (uint32_t)std::floor(pt_.y() / cell);
+    };
+
+    std::vector<std::pair<uint64_t, uint64_t>> pairs;
+    pairs.reserve(m_links.size());
+
+    for (const auto& it : m_links)
+    {
+        uint64_t l = cell_key(node_center(it.second.nodes[0]));
+        uint64_t r = cell_key(node_center(it.second.nodes[1]));
+        if (l == r)
+            continue;
+
+        if (r < l)
+            std::swap(l, r);
+
+        pairs.emplace_back(l, r);
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    auto cell_center = [cell](uint64_t key_) {
+        return QPointF(((int32_t)(key_ >> 32) + 0.5) * cell, ((int32_t)(uint32_t)key_ + 0.5) * cell);
+    };
+
+    std::vector<QLineF> lines;
+    lines.reserve(pairs.size());
+
+    for (const auto& it : pairs)
+        lines.emplace_back(cell_center(it.first), cell_center(it.second));
+
+    ui->View->SetPointCloud({ std::move(positive), std::move(negative) }, std::move(lines));
+
+    return m_nodes.size();
 }
 
 //----------------------------------------------------------------------
-MainWindow::~MainWindow()
+void MainWindow::on_cbLazy_toggled(bool checked_)
 {
-    delete ui;
+    m_lazy = checked_;
+
+    if (loading())
+        return;
+
+    if (m_lazy)
+    {
+        materialize();
+        return;
+    }
+
+    SBatch batch(this, m_nodes.size() + m_links.size() - m_items.size());
+
+    for (const auto& it : m_nodes)
+        if (!vis_item(it.first))
+            create_vis_node(it.first, it.second.name)->setPos(it.second.gnode.x, it.second.gnode.y);
+
+    for (const auto& it : m_links)
+        if (!vis_item(it.first))
+            create_vis_link(it.first);
+
+    // Back to the bounding rectangle of all items
+    ui->View->scene()->setSceneRect(QRectF());
 }
 
 //----------------------------------------------------------------------
-QGraphicsEllipseItem* MainWindow::create_vis_node(const TNodeId& uuid_, const std::string& dev_name_)
+void MainWindow::begin_batch(size_t items_)
 {
-    static const QPen   pen  (QColor(Qt::lightGray), Qt::SolidLine   );
-    static const QBrush brush(QColor(Qt::lightGray), Qt::SolidPattern);
+    if (m_batch_depth++ == 0)
+        ui->View->setUpdatesEnabled(false);
 
-    QGraphicsEllipseItem* pItem = ui->View->scene()->addEllipse(0, 0, blob_radius, blob_radius, pen, brush);
+    // Switching the index back rebuilds the whole BSP tree, which only
+    // pays off over updating it item by item for many items
+    if (items_ >= bulk_items && !m_unindexed)
+    {
+        ui->View->scene()->setItemIndexMethod(QGraphicsScene::NoIndex);
+        m_unindexed = true;
+    }
+}
 
-    pItem->setFlag(QGraphicsItem::ItemIsSelectable);
-    pItem->setFlag(QGraphicsItem::ItemIsMovable);
-    pItem->setFlag(QGraphicsItem::ItemSendsGeometryChanges);
-    pItem->setData(eUUID, QVariant(uuid_.c_str()));
-    pItem->setZValue(1);
+//----------------------------------------------------------------------
+void MainWindow::end_batch()
+{
+    if (--m_batch_depth > 0)
+        return;
 
-    QGraphicsTextItem* pText = ui->View->scene()->addText(dev_name_.c_str());
-    pText->setParentItem(pItem);
+    PROFILE_SCOPE("end_batch");
 
-    return pItem;
+    if (m_unindexed)
+    {
+        ui->View->scene()->setItemIndexMethod(QGraphicsScene::BspTreeIndex);
+        m_unindexed = false;
+    }
+
+    ui->View->setUpdatesEnabled(true);
+
+    // The scene reports the changes of the batch from the event loop, after
+    // it ended. Only changes reported while it was open have to be caught up.
+    if (m_scene_dirty)
+    {
+        m_scene_dirty = false;
+        on_scene_changed(QList<QRectF>());
+    }
 }
 
 //----------------------------------------------------------------------
@@ -210,9 +558,15 @@ void MainWindow::on_pbAdd_clicked()
 
     TDevId dev_id = ui->devList->currentIndex().data(eUUID).toString().toStdString();
 
-    m_nodes[uuid] = m_category_list[cat][dev_id];
+    SchemeEdit edit;
+    edit.TouchNode(uuid, m_nodes);
+
+    const SDevice& dev = m_nodes[uuid] = m_category_list[cat][dev_id];
 
-    create_vis_node(uuid, dev_name);
+    // A pooled item is still where its last node was
+    create_vis_node(uuid, dev_name)->setPos(dev.gnode.x, dev.gnode.y);
+
+    commit_edit(edit);
 }
 
 //----------------------------------------------------------------------
@@ -240,6 +594,8 @@ void MainWindow::on_cbCategories_activated(const QString& arg1)
 //----------------------------------------------------------------------
 void MainWindow::selectionChanged()
 {
+    PROFILE_SCOPE("selection_changed");
+
     QList<QGraphicsItem*> items = ui->View->scene()->selectedItems();
 
     enum {
@@ -251,6 +607,7 @@ void MainWindow::selectionChanged()
     switch (items.size()) {
 
     case nothing_selected:
+    default: // A group selected for "Bind all"
     {
         ui->linputs->clear();
         ui->l_label->setText("---");
@@ -277,7 +634,7 @@ void MainWindow::selectionChanged()
         }
 
         ui->linputs->update();
-        ui->l_label->setText(std::string(dev.name + "\n" + dev.rule).c_str());
+        ui->l_label->setText(std::string(dev.name + "\n" + dev.rule + "\nComponent: " + std::to_string(m_components.Size(m_ldev)) + " items").c_str());
     }
         break;
 
@@ -316,48 +673,184 @@ void MainWindow::selectionChanged()
             ui->rinputs->update();
             ui->r_label->setText(std::string(dev.name + "\n" + dev.rule).c_str());
         }
-    }
-        break;
 
-    default:
-        assert(false);
+        update_reach_hints();
+    }
         break;
     }
+
+    highlight_component(items.size() == one_item_selected ? m_ldev : TNodeId());
 }
 
 //----------------------------------------------------------------------
 void MainWindow::checkStates()
 {
-    check_states(ui->View->scene()->items(), m_nodes);
+    size_t evaluated = 0;
 
-    double power = std::accumulate(m_nodes.begin(), m_nodes.end(), 0.0, [](double init_, const TNodeList::value_type& it_) {
-        return init_ + it_.second.power;
-    });
+    // The rules are evaluated for the items and again for the point
+    // cloud, which is only rebuilt after the scheme changed
+    {
+        PROFILE_SCOPE("validation");
 
-    ui->lbInfo->setText("Power: " + QString::number(power) + " W");
+        evaluated += check_states(m_items, m_nodes);
+
+        if (m_cloud_dirty)
+            evaluated += update_point_cloud();
+    }
+
+    Profiler::Instance().Count("nodes_evaluated", (int64_t)evaluated);
+
+    // Components and power only change with the scheme, scheme_changed()
+    // updates the info then
+
+    if (ui->lbPerf->isVisible())
+        update_perf();
 }
 
 //----------------------------------------------------------------------
-void MainWindow::keyPressEvent(QKeyEvent* event)
+void MainWindow::update_perf()
 {
-    QMainWindow::keyPressEvent(event);
+    const Profiler& profiler = Profiler::Instance();
 
-    if (event->key() == Qt::Key_Delete)
-        on_pbDel_clicked();
+    const Profiler::SStat validation = profiler.Stat("validation");
+    const Profiler::SStat scene      = profiler.Stat("scene_changed");
 
-    if (event->key() == Qt::Key_B)
-        on_pbBind_clicked();
+    QString text;
+    text += "Validation: "   + QString::number(validation.last_ms, 'f', 2) + " ms (p95 " + QString::number(validation.Percentile(0.95), 'f', 2) + ")\n";
+    text += "Scene update: " + QString::number(scene.last_ms, 'f', 2)      + " ms (p95 " + QString::number(scene.Percentile(0.95), 'f', 2) + ")\n";
+    text += "Nodes per tick: " + QString::number((long long)profiler.Counter("nodes_evaluated"));
 
-    if (event->key() == Qt::Key_U)
-        on_pbUnbind_clicked();
+    ui->lbPerf->setText(text);
 }
 
 //----------------------------------------------------------------------
-void MainWindow::read_categories()
+QPen MainWindow::node_pen(const TNodeId& id_) const
 {
-    QDir dir(m_data_folder.c_str());
+    static const QPen pen         (QColor(Qt::lightGray), Qt::SolidLine);
+    static const QPen overload_pen(QColor(Qt::red), 3.0);
+    static const QPen island_pen  (QColor(Qt::darkYellow), 2.0, Qt::DashLine);
+    static const QPen component_pen(QColor(Qt::darkCyan), 2.0);
 
-    QList<QString> flList;
+    auto itUps = m_power.Ups().find(id_);
+    if (itUps != m_power.Ups().end() && itUps->second.Overloaded())
+        return overload_pen;
+
+    if (m_component.count(id_))
+        return component_pen;
+
+    if (m_islands.count(id_))
+        return island_pen;
+
+    return pen;
+}
+
+//----------------------------------------------------------------------
+void MainWindow::update_info()
+{
+    PROFILE_SCOPE("update_info");
+
+    // Nodes whose pen may change: former and current islands and all UPSes
+    std::unordered_set<TNodeId> repaint;
+    repaint.swap(m_islands);
+
+    if (m_components.Count() > 1)
+        for (const auto& it : m_components.Islands())
+        {
+            m_islands.insert(it);
+            repaint.insert(it);
+        }
+
+    int overloaded = 0;
+    for (const auto& it : m_power.Ups())
+    {
+        overloaded += it.second.Overloaded() ? 1 : 0;
+        repaint.insert(it.first);
+    }
+
+    for (const auto& it : repaint)
+        if (auto pItem = static_cast<QAbstractGraphicsShapeItem*>(vis_item(it)))
+            pItem->setPen(node_pen(it));
+
+    QString info = "Power: " + QString::number(m_power.Total()) + " W";
+    if (overloaded)
+        info += " | Overloaded UPS: " + QString::number(overloaded);
+
+    info += " | Components: " + QString::number(m_components.Count());
+    if (!m_islands.empty())
+        info += " | Island nodes: " + QString::number(m_islands.size());
+
+    ui->lbInfo->setText(info);
+
+    // Members of the selected node may have changed with the scheme
+    highlight_component(m_component_of);
+}
+
+//----------------------------------------------------------------------
+void MainWindow::highlight_component(const TNodeId& id_)
+{
+    PROFILE_SCOPE("highlight_component");
+
+    // Larger components cover most of the scheme, highlighting them would
+    // repaint it all and show nothing
+    static const int highlight_limit = 5000;
+
+    m_component_of = id_;
+
+    std::unordered_set<TNodeId> repaint;
+    repaint.swap(m_component);
+
+    const int size = id_.empty() ? 0 : m_components.Size(id_);
+    if (size > 1 && size <= highlight_limit)
+        for (auto& it : m_components.Members(id_))
+        {
+            repaint.insert(it);
+            m_component.insert(std::move(it));
+        }
+
+    for (const auto& it : repaint)
+        if (auto pItem = static_cast<QAbstractGraphicsShapeItem*>(vis_item(it)))
+            pItem->setPen(node_pen(it));
+}
+
+//----------------------------------------------------------------------
+void MainWindow::keyPressEvent(QKeyEvent* event)
+{
+    QMainWindow::keyPressEvent(event);
+
+    if (loading())
+        return;
+
+    if (event->key() == Qt::Key_Delete)
+        on_pbDel_clicked();
+
+    if (event->key() == Qt::Key_B)
+        on_pbBind_clicked();
+
+    if (event->key() == Qt::Key_U)
+        on_pbUnbind_clicked();
+
+    if (event->key() == Qt::Key_P)
+    {
+        ui->lbPerf->setVisible(!ui->lbPerf->isVisible());
+        update_profiling();
+        update_perf();
+    }
+
+    if (event->matches(QKeySequence::Undo))
+        on_pbUndo_clicked();
+
+    if (event->matches(QKeySequence::Redo))
+        on_pbRedo_clicked();
+}
+
+//----------------------------------------------------------------------
+void MainWindow::read_categories()
+{
+    PROFILE_SCOPE("read_categories");
+
+    QDir dir(m_data_folder.c_str());
+
+    QList<QString> flList;
     for (const auto& it : dir.entryInfoList())
         if (!it.baseName().isEmpty())
             flList.append(it.baseName());
@@ -398,6 +891,18 @@ void MainWindow::read_categories()
             }
         }
     }
+
+    m_reach.Build(m_category_list);
+
+    TCapacityList capacities;
+    for (const auto& it_cat : m_category_list)
+        for (const auto& it_dev : it_cat.second)
+            if (it_dev.second.capacity > 0.0)
+                capacities[it_dev.first] = it_dev.second.capacity;
+
+    m_power.SetCapacities(capacities);
+    m_power.Rebuild(m_nodes);
+    m_components.Rebuild(m_nodes, m_links);
 }
 
 //----------------------------------------------------------------------
@@ -420,115 +925,241 @@ void MainWindow::update_dev_list()
 }
 
 //----------------------------------------------------------------------
-void MainWindow::restore()
+void MainWindow::update_reach_hints()
 {
-    auto file_name = QFileDialog::getOpenFileName(this, tr("Open Scheme"), "", tr("Scheme Files (*.sch)"));
+    auto itLeft  = m_nodes.find(m_ldev);
+    auto itRight = m_nodes.find(m_rdev);
 
-    clear();
+    if (itLeft == m_nodes.end() || itRight == m_nodes.end())
+        return;
 
-    using reader = nop::StreamReader<std::stringstream>;
+    const SDevice& ldev = itLeft ->second;
+    const SDevice& rdev = itRight->second;
 
-    std::string data;
+    const int lind = ui->linputs->currentRow();
 
-    std::ifstream file(file_name.toStdString());
-    if (!file.is_open())
+    for (int i = 0; i < (int)rdev.inputs.size() && i < ui->rinputs->count(); ++i)
+    {
+        const std::string rtype = rdev.inputs[i].Type();
+
+        bool reachable = false;
+        if (lind >= 0 && lind < (int)ldev.inputs.size())
+        {
+            reachable = m_reach.Reachable(ldev.inputs[lind].Type(), rtype);
+        }
+        else
+        {
+            for (const auto& it : ldev.inputs)
+                if (!it.IsOn() && m_reach.Reachable(it.Type(), rtype))
+                {
+                    reachable = true;
+                    break;
+                }
+        }
+
+        ui->rinputs->item(i)->setForeground(QBrush(reachable ? QColor(Qt::black) : QColor(Qt::darkGray)));
+    }
+}
+
+//----------------------------------------------------------------------
+void MainWindow::restore()
+{
+    if (loading())
         return;
 
-    file.seekg(0, std::ios::end);
-    data.reserve(file.tellg());
-    file.seekg(0, std::ios::beg);
+    auto file_name = QFileDialog::getOpenFileName(this, tr("Open Scheme"), "", tr("Scheme Files (*.sch)"));
+    if (file_name.isEmpty())
+        return;
 
-    data.assign((std::istreambuf_iterator<char>(file)),
-                 std::istreambuf_iterator<char>());
+    // The file is read and the model built on a worker thread, the scene
+    // is populated afterwards in time slices by loadStep(). The current
+    // scheme stays until the new one is read, so a failed load keeps it.
+    // The catalog is only edited through the UI, which stays disabled
+    // until the load is over
+    m_load = std::async(std::launch::async, [this, file_name = file_name.toStdString(), power = m_power, pCatalog = &m_category_list, pDictionary = &m_scheme_dictionary]() mutable
+    {
+        PROFILE_SCOPE("restore");
 
-    nop::Deserializer<reader> deserializer { data };
+        SLoadedScheme scheme;
+        scheme.file_name = file_name;
+        scheme.loaded = LoadScheme(file_name, scheme.nodes, scheme.links, pCatalog, pDictionary);
 
-    deserializer.Read(&m_nodes);
-    deserializer.Read(&m_links);
+        if (scheme.loaded)
+        {
+            power.Rebuild(scheme.nodes);
+            scheme.power = std::move(power);
+            scheme.components.Rebuild(scheme.nodes, scheme.links);
+        }
 
-    for (const auto& it : m_links)
+        // The future gets ready as soon as the scheme is returned, get()
+        // in loadStep() waits for no more than that
+        QMetaObject::invokeMethod(this, "loadStep", Qt::QueuedConnection);
+
+        return scheme;
+    });
+
+    ui->centralWidget->setEnabled(false);
+
+    m_pProgress->setRange(0, 0);
+    m_pProgress->show();
+    statusBar()->showMessage(tr("Loading ") + file_name);
+}
+
+//----------------------------------------------------------------------
+void MainWindow::loadStep()
+{
+    if (m_load.valid())
     {
-        const TLinkId& uuid = it.first;
+        SLoadedScheme scheme = m_load.get();
+
+        if (!scheme.loaded)
+        {
+            Log("Failed to load scheme " + scheme.file_name);
+
+            m_pProgress->hide();
+            statusBar()->clearMessage();
+            ui->centralWidget->setEnabled(true);
+            return;
+        }
 
-        QPen pen(QColor(Qt::lightGray), Qt::SolidLine);
+        clear();
 
-        QGraphicsLineItem* pItem = ui->View->scene()->addLine(0, 0, 0, 0, pen);
+        m_undo.Clear();
 
-        pItem->setData(eUUID, QVariant(uuid.c_str()));
+        m_nodes         = std::move(scheme.nodes);
+        m_links         = std::move(scheme.links);
+        m_power         = std::move(scheme.power);
+        m_components    = std::move(scheme.components);
+
+        m_grid.Clear();
+        for (const auto& it : m_nodes)
+            m_grid.Insert(it.first, it.second.gnode.x, it.second.gnode.y);
+
+        m_link_grid.Clear();
+        for (const auto& it : m_links)
+            index_link(it.first);
+
+        if (m_nodes.size() > lazy_threshold)
+            ui->cbLazy->setChecked(true);
+
+        // In lazy mode the visible part is materialized at the end
+        m_load_node  = m_lazy ? m_nodes.end() : m_nodes.begin();
+        m_load_link  = m_lazy ? m_links.end() : m_links.begin();
+        m_load_done  = 0;
+        m_populating = true;
+
+        m_pProgress->setRange(0, (int)(m_nodes.size() + m_links.size()));
+        m_pProgress->setValue(0);
+
+        // Items are added in bulk, the BSP index is rebuilt once at the end
+        ui->View->scene()->setItemIndexMethod(QGraphicsScene::NoIndex);
+
+        m_pLoadTimer->start(0);
+        return;
     }
 
-    for (const auto& it : m_nodes)
-    {
-        const TNodeId& uuid = it.first;
-        const SDevice& dev = it.second;
+    PROFILE_SCOPE("load_step");
 
-        QGraphicsEllipseItem* pItem = create_vis_node(uuid, dev.name);
+    QElapsedTimer timer;
+    timer.start();
 
-        pItem->setPos(dev.gnode.x, dev.gnode.y);
+    // Nodes first so that links are laid out between existing items
+    while (timer.elapsed() < load_slice_ms && (m_load_node != m_nodes.end() || m_load_link != m_links.end()))
+    {
+        for (int i = 0; i < load_chunk; ++i, ++m_load_done)
+        {
+            if (m_load_node != m_nodes.end())
+            {
+                create_vis_node(m_load_node->first, m_load_node->second.name)->setPos(m_load_node->second.gnode.x, m_load_node->second.gnode.y);
+                ++m_load_node;
+            }
+            else if (m_load_link != m_links.end())
+            {
+                create_vis_link(m_load_link->first);
+                ++m_load_link;
+            }
+            else
+                break;
+        }
     }
 
+    m_pProgress->setValue(m_load_done);
+
+    if (m_load_node == m_nodes.end() && m_load_link == m_links.end())
+        finish_load();
+}
+
+//----------------------------------------------------------------------
+void MainWindow::finish_load()
+{
+    m_populating = false;
+
+    m_pLoadTimer->stop();
+    m_pProgress->hide();
+    statusBar()->clearMessage();
+
+    ui->View->scene()->setItemIndexMethod(QGraphicsScene::BspTreeIndex);
+    ui->centralWidget->setEnabled(true);
+
+    // One pass over the items for all the slices
+    m_scene_dirty = false;
     on_scene_changed(QList<QRectF>());
+    update_info();
+    publish_later();
+
+    materialize();
+    update_point_cloud();
 }
 
 //----------------------------------------------------------------------
 void MainWindow::store() const
 {
     QString fileName = QFileDialog::getSaveFileName(const_cast<MainWindow*>(this), tr("Save Scheme"), "", tr("Scheme Files (*.sch)"));
+    if (fileName.isEmpty())
+        return;
+
     fileName = fileName.contains(".sch") ? fileName : fileName + ".sch";
 
-    using writer = nop::StreamWriter<std::stringstream>;
-    nop::Serializer<writer> serializer;
+    SCompression compression;
+    compression.dictionary = m_scheme_dictionary;
 
-    serializer.Write(m_nodes);
-    serializer.Write(m_links);
+    const SCompression* pCompression = ui->cbCompress->isChecked() ? &compression : nullptr;
 
-    std::string out = serializer.writer().stream().str();
+    // Compact by default, it is a quarter of the size and loads as fast;
+    // legacy is left for older builds
+    const bool saved = ui->cbCompact->isChecked() ? SaveCompactScheme(fileName.toStdString(), m_category_list, m_nodes, m_links, pCompression)
+                                                  : SaveScheme(fileName.toStdString(), m_nodes, m_links, pCompression);
 
-    std::ofstream file(fileName.toStdString());
-    file << out;
-    file.close();
+    statusBar()->showMessage(saved ? tr("Saved ") + fileName : tr("Failed to save ") + fileName);
 }
 
 //----------------------------------------------------------------------
 void MainWindow::clear()
 {
-    while (!m_nodes.empty())
-    {
-        auto it = m_nodes.begin();
+    SBatch batch(this, m_items.size());
 
-        const TNodeId& id = it->first;
-        if (!id.empty())
-        {
-             if (auto item = GetItem(id, ui->View->scene()->items()))
-                 ui->View->scene()->removeItem(item);
-        }
-
-        m_nodes.erase(it);
-    }
-
-    while (!m_links.empty())
-    {
-        auto it = m_links.begin();
+    for (const auto& it : m_nodes)
+        remove_vis_item(it.first);
 
-        const TLinkId& id = it->first;
-        if (!id.empty())
-        {
-            if (auto item = GetItem(id, ui->View->scene()->items()))
-                ui->View->scene()->removeItem(item);
-        }
+    for (const auto& it : m_links)
+        remove_vis_item(it.first);
 
-        m_links.erase(it);
-    }
+    m_nodes.clear();
+    m_links.clear();
+    m_grid.Clear();
+    m_link_grid.Clear();
 
     m_rdev.clear();
     m_ldev.clear();
 
-    on_scene_changed(QList<QRectF>());
+    publish_later();
 }
 
 //----------------------------------------------------------------------
 void MainWindow::on_pbBind_clicked()
 {
+    PROFILE_SCOPE("bind");
+
     auto lind = ui->linputs->currentRow();
     auto rind = ui->rinputs->currentRow();
 
@@ -558,32 +1189,23 @@ void MainWindow::on_pbBind_clicked()
                 {
                     TLinkId uuid = QUuid::createUuid().toString().toStdString();
 
-                    ldev.inputs[lind].connect.node  = m_rdev;
-                    ldev.inputs[lind].connect.input = rind;
-                    ldev.inputs[lind].connect.link  = uuid;
+                    SchemeEdit edit;
+                    edit.TouchNode(m_ldev, m_nodes);
+                    edit.TouchNode(m_rdev, m_nodes);
+                    edit.TouchLink(uuid, m_links);
 
-                    rdev.inputs[rind].connect.node  = m_ldev;
-                    rdev.inputs[rind].connect.input = lind;
-                    rdev.inputs[rind].connect.link  = uuid;
+                    Bind(m_nodes, m_links, uuid, m_ldev, lind, m_rdev, rind);
 
-                    SLink& link = m_links[uuid];
-                    link.nodes[0] = m_ldev;
-                    link.nodes[1] = m_rdev;
+                    commit_edit(edit);
 
-                    auto litem = GetItem(m_ldev, ui->View->scene()->items());
-                    auto ritem = GetItem(m_rdev, ui->View->scene()->items());
-
-                    QPen pen(QColor(Qt::lightGray), Qt::SolidLine);
+                    auto litem = vis_item(m_ldev);
+                    auto ritem = vis_item(m_rdev);
 
                     auto lpos = litem->boundingRect().center() + litem->pos();
                     auto rpos = ritem->boundingRect().center() + ritem->pos();
 
-                    QGraphicsLineItem* pItem = ui->View->scene()->addLine(
-                                lpos.x(), lpos.y(),
-                                rpos.x(), rpos.y(),
-                                pen);
-
-                    pItem->setData(eUUID, QVariant(uuid.c_str()));
+                    create_vis_link(uuid)->setLine(lpos.x(), lpos.y(),
+                                                   rpos.x(), rpos.y());
                 }
 
                 break;
@@ -595,21 +1217,28 @@ void MainWindow::on_pbBind_clicked()
 //----------------------------------------------------------------------
 void MainWindow::on_pbDel_clicked()
 {
+    PROFILE_SCOPE("delete");
+
     QList<QGraphicsItem*> items = ui->View->scene()->selectedItems();
 
+    SBatch batch(this, items.size());
+    SchemeEdit edit;
+
     for (const auto& itItem : items)
     {
-        const TNodeId& id = itItem->data(eUUID).toString().toStdString();
+        const TNodeId id = itItem->data(eUUID).toString().toStdString();
         if (id.empty())
             continue;
 
+        edit.TouchNodeDeep(id, m_nodes, m_links);
+
         for (auto& itInput : m_nodes[id].inputs)
         {
             // Removing links
             if (!itInput.connect.link.empty())
             {
-                if (auto item = GetItem(itInput.connect.link, ui->View->scene()->items()))
-                    ui->View->scene()->removeItem(item);
+                remove_vis_item(itInput.connect.link);
+                m_links.erase(itInput.connect.link);
             }
 
             // Resetting inputs
@@ -623,13 +1252,17 @@ void MainWindow::on_pbDel_clicked()
 
         m_nodes.erase(id);
 
-        ui->View->scene()->removeItem(itItem);
+        remove_vis_item(id);
     }
+
+    commit_edit(edit);
 }
 
 //----------------------------------------------------------------------
 void MainWindow::on_pbUnbind_clicked()
 {
+    PROFILE_SCOPE("unbind");
+
     auto lind = ui->linputs->currentRow();
     auto rind = ui->rinputs->currentRow();
 
@@ -639,12 +1272,17 @@ void MainWindow::on_pbUnbind_clicked()
     SDevice& ldev = m_nodes[m_ldev];
     SDevice& rdev = m_nodes[m_rdev];
 
+    SchemeEdit edit;
+    edit.TouchNode(m_ldev, m_nodes);
+    edit.TouchNode(m_rdev, m_nodes);
+    edit.TouchNode(ldev.inputs[lind].connect.node, m_nodes);
+    edit.TouchLink(ldev.inputs[lind].connect.link, m_links);
+
     // Removing links
     auto link = ldev.inputs[lind].connect.link;
     if (!link.empty())
     {
-        if (auto item = GetItem(link, ui->View->scene()->items()))
-            ui->View->scene()->removeItem(item);
+        remove_vis_item(link);
 
         if (m_links.count(link))
             m_links.erase(link);
@@ -652,6 +1290,8 @@ void MainWindow::on_pbUnbind_clicked()
 
     ldev.inputs[lind].connect.Reset();
     rdev.inputs[rind].connect.Reset();
+
+    commit_edit(edit);
 }
 
 //----------------------------------------------------------------------
@@ -659,36 +1299,46 @@ void MainWindow::on_scene_changed(const QList<QRectF>& list_)
 {    
     Q_UNUSED(list_);
 
-    for (const auto& it : m_links)
+    // Caught up once the batch or the load is over
+    if (m_batch_depth > 0 || m_populating)
     {
-        if (QGraphicsLineItem* pLine  = static_cast<QGraphicsLineItem*>(GetItem(it.first, ui->View->scene()->items())))
-        {
-            auto litem = GetItem(it.second.nodes[0], ui->View->scene()->items());
-            auto ritem = GetItem(it.second.nodes[1], ui->View->scene()->items());
+        m_scene_dirty = true;
+        return;
+    }
 
-            if (litem && ritem)
-            {
-                auto lpos = litem->boundingRect().center() + litem->pos();
-                auto rpos = ritem->boundingRect().center() + ritem->pos();
+    PROFILE_SCOPE("scene_changed");
 
-                pLine->setLine(lpos.x(), lpos.y(),
-                               rpos.x(), rpos.y());
-            }
-        }
-    }
+    Profiler::Instance().Count("items_updated", (int64_t)m_items.size());
 
-    for (const auto& itItem : ui->View->scene()->items())
+    // Only materialized items can have changed
+    for (const auto& it : m_items)
     {
-        TNodeId id = itItem->data(eUUID).toString().toStdString();
-        if (!id.empty())
+        auto itLink = m_links.find(it.first);
+        if (itLink != m_links.end())
         {
-            auto itNode = m_nodes.find(id);
-            if (itNode != m_nodes.end())
-            {
-                SGraphNode& node = itNode->second.gnode;
-                node.x = itItem->pos().x();
-                node.y = itItem->pos().y();
-            }
+            auto lpos = node_center(itLink->second.nodes[0]);
+            auto rpos = node_center(itLink->second.nodes[1]);
+
+            static_cast<QGraphicsLineItem*>(it.second)->setLine(lpos.x(), lpos.y(),
+                                                                rpos.x(), rpos.y());
+            continue;
+        }
+
+        auto itNode = m_nodes.find(it.first);
+        if (itNode == m_nodes.end())
+            continue;
+
+        SGraphNode& node = itNode->second.gnode;
+        const int x = it.second->pos().x();
+        const int y = it.second->pos().y();
+
+        if (node.x != x || node.y != y)
+        {
+            node.x = x;
+            node.y = y;
+            m_grid.Insert(it.first, x, y);
+            index_node_links(it.first);
+            publish_later();
         }
     }
 
@@ -710,7 +1360,17 @@ void MainWindow::on_pbLoad_clicked()
 //----------------------------------------------------------------------
 void MainWindow::on_pbClear_clicked()
 {
+    SchemeEdit edit;
+
+    for (const auto& it : m_nodes)
+        edit.TouchNode(it.first, m_nodes);
+
+    for (const auto& it : m_links)
+        edit.TouchLink(it.first, m_links);
+
     clear();
+
+    commit_edit(edit);
 }
 
 //----------------------------------------------------------------------
@@ -722,8 +1382,72 @@ void MainWindow::on_devList_itemSelectionChanged()
 //----------------------------------------------------------------------
 void MainWindow::on_pbPrint_clicked()
 {
-    const QString fileName = QFileDialog::getSaveFileName(this, tr("Save configuration"), "", tr("Configuration File (*.txt)"));
-    print(fileName.contains(".txt") ? fileName : fileName + ".txt", m_nodes);
+    const QString fileName = QFileDialog::getSaveFileName(this, tr("Save bill of materials"), "", tr("Text File (*.txt);;CSV File (*.csv);;JSON File (*.json)"));
+    if (fileName.isEmpty())
+        return;
+
+    BomEngine bom(m_category_list);
+    const bool written = bom.Write( { bom.Build(m_nodes, m_links) }, BomEngine::FormatOf(fileName.toStdString()), fileName.toStdString());
+
+    statusBar()->showMessage(written ? tr("Bill of materials saved to ") + fileName : tr("Failed to write ") + fileName);
+}
+
+//----------------------------------------------------------------------
+void MainWindow::on_pbPrintBatch_clicked()
+{
+    const QStringList schemes = QFileDialog::getOpenFileNames(this, tr("Open Schemes"), "", tr("Scheme Files (*.sch)"));
+    if (schemes.isEmpty())
+        return;
+
+    const QString fileName = QFileDialog::getSaveFileName(this, tr("Save bill of materials"), "", tr("Text File (*.txt);;CSV File (*.csv);;JSON File (*.json)"));
+    if (fileName.isEmpty())
+        return;
+
+    std::vector<std::string> files;
+    for (const auto& it : schemes)
+        files.push_back(it.toStdString());
+
+    // Schemes that could not be read are logged and left out of the report
+    BomEngine bom(m_category_list, &m_scheme_dictionary);
+    const bool written = bom.Batch(files, BomEngine::FormatOf(fileName.toStdString()), fileName.toStdString());
+
+    statusBar()->showMessage(written ? tr("Bills of materials saved to ") + fileName
+                                     : tr("Failed to write %1 or to read some of the schemes, see the log").arg(fileName));
+}
+
+//----------------------------------------------------------------------
+// First click starts recording a trace, the second one saves it
+void MainWindow::on_pbSaveTrace_clicked()
+{
+    if (!m_tracing)
+    {
+        Profiler::Instance().Reset();
+
+        m_tracing = true;
+        update_profiling();
+
+        ui->pbSaveTrace->setText(tr("Save performance trace"));
+        return;
+    }
+
+    const QString fileName = QFileDialog::getSaveFileName(this, tr("Save performance trace"), "", tr("Chrome Trace (*.json)"));
+    if (fileName.isEmpty())
+        return;
+
+    if (!Profiler::Instance().SaveTrace(fileName.toStdString()))
+        Log("Failed to save trace " + fileName.toStdString());
+
+    m_tracing = false;
+    update_profiling();
+
+    ui->pbSaveTrace->setText(tr("Record performance trace"));
+}
+
+//----------------------------------------------------------------------
+// Timings are only taken while the overlay shows them or a trace records them
+void MainWindow::update_profiling()
+{
+    Profiler::Instance().SetEnabled(m_tracing || ui->lbPerf->isVisible());
 }
 
 //----------------------------------------------------------------------
@@ -784,3 +1508,393 @@ void MainWindow::on_pbAddCategory_clicked()
         read_categories();
     }
 }
+
+//----------------------------------------------------------------------
+void MainWindow::on_linputs_currentRowChanged(int row_)
+{
+    Q_UNUSED(row_);
+    update_reach_hints();
+}
+
+//----------------------------------------------------------------------
+void MainWindow::on_pbAutoComplete_clicked()
+{
+    PROFILE_SCOPE("auto_complete");
+
+    AutoCompleter completer(m_category_list, m_reach);
+
+    SchemeEdit edit;
+
+    SCompletion result = completer.Run(m_nodes, m_links, []() {
+        return QUuid::createUuid().toString().toStdString();
+    }, &edit);
+
+    commit_edit(edit);
+
+    SBatch batch(this, result.nodes.size() + result.links.size());
+
+    for (const auto& it : result.nodes)
+    {
+        const SDevice& dev = m_nodes[it];
+
+        QGraphicsEllipseItem* pItem = create_vis_node(it, dev.name);
+
+        pItem->setPos(dev.gnode.x, dev.gnode.y);
+    }
+
+    for (const auto& it : result.links)
+        create_vis_link(it);
+
+    ui->detailsList->clear();
+    ui->detailsList->addItem(("Cables added: "   + std::to_string(result.nodes.size())).c_str());
+    ui->detailsList->addItem(("Bindings made: "  + std::to_string(result.links.size())).c_str());
+
+    for (const auto& it : result.unsolved)
+        ui->detailsList->addItem(("Unsolved: " + m_nodes[it].name).c_str());
+}
+
+//----------------------------------------------------------------------
+void MainWindow::on_pbExplore_clicked()
+{
+    PROFILE_SCOPE("explore");
+
+    DesignExplorer explorer(m_category_list);
+
+    std::vector<SDesign> designs = explorer.Run(m_nodes, max_designs);
+
+    auto dev_name = [this](const TDevId& id_) {
+        for (const auto& it : m_category_list)
+        {
+            auto itDev = it.second.find(id_);
+            if (itDev != it.second.end())
+                return itDev->second.name;
+        }
+        return id_;
+    };
+
+    ui->detailsList->clear();
+
+    // Cables are not substituted, the cable count is that of the scheme
+    ui->detailsList->addItem("Designs ranked by power, cables kept as they are");
+
+    int i = 0;
+    for (const auto& it : designs)
+    {
+        ui->detailsList->addItem(("//============ Design #" + std::to_string(++i) +
+                                  ", power: " + std::to_string((int)it.power) + " W").c_str());
+
+        for (const auto& itSub : it.devices)
+            ui->detailsList->addItem((m_nodes[itSub.first].name + " -> " + dev_name(itSub.second)).c_str());
+    }
+}
+
+//----------------------------------------------------------------------
+void MainWindow::on_pbBindAll_clicked()
+{
+    PROFILE_SCOPE("bind_all");
+
+    std::vector<TNodeId> group;
+    for (const auto& it : ui->View->scene()->selectedItems())
+    {
+        TNodeId id = it->data(eUUID).toString().toStdString();
+        if (m_nodes.count(id))
+            group.push_back(id);
+    }
+
+    if (group.size() < 2)
+        return;
+
+    {
+        const auto plan = PlanBindAll(m_nodes, group, m_reach);
+
+        SBatch batch(this, plan.size());
+        SchemeEdit edit;
+
+        for (const auto& it : plan)
+        {
+            TLinkId uuid = QUuid::createUuid().toString().toStdString();
+
+            edit.TouchNode(it.lnode, m_nodes);
+            edit.TouchNode(it.rnode, m_nodes);
+            edit.TouchLink(uuid, m_links);
+
+            Bind(m_nodes, m_links, uuid, it.lnode, it.linput, it.rnode, it.rinput);
+
+            create_vis_link(uuid);
+        }
+
+        commit_edit(edit);
+    }
+
+    selectionChanged();
+}
+
+//----------------------------------------------------------------------
+void MainWindow::commit_edit(SchemeEdit& edit_)
+{
+    SDelta delta = edit_.Finish(m_nodes, m_links);
+
+    scheme_changed(delta, false);
+
+    m_undo.Push(std::move(delta));
+}
+
+//----------------------------------------------------------------------
+void MainWindow::scheme_changed(const SDelta& delta_, bool undo_)
+{
+    PROFILE_SCOPE("scheme_changed");
+
+    std::vector<TNodeId> touched;
+
+    for (const auto& it : delta_.nodes)
+    {
+        const std::optional<SDevice>& before = undo_ ? it.after  : it.before;
+        const std::optional<SDevice>& after  = undo_ ? it.before : it.after;
+
+        m_power.Adjust(before.has_value() ? before->power : 0.0,
+                       after .has_value() ? after ->power : 0.0);
+
+        auto itNode = m_nodes.find(it.id);
+        if (itNode != m_nodes.end())
+        {
+            m_grid.Insert(it.id, itNode->second.gnode.x, itNode->second.gnode.y);
+            index_node_links(it.id);
+        }
+        else
+            m_grid.Remove(it.id);
+
+        touched.push_back(it.id);
+    }
+
+    for (const auto& it : delta_.links)
+        index_link(it.id);
+
+    m_power.Update(m_nodes, touched);
+
+    // Growth is merged into the union-find forest, a removal may split
+    // a component and requires a rebuild
+    bool removed = false;
+
+    for (const auto& it : delta_.nodes)
+        if (!(undo_ ? it.before : it.after).has_value())
+            removed = true;
+
+    for (const auto& it : delta_.links)
+        if ((undo_ ? it.after : it.before).has_value())
+            removed = true;
+
+    if (removed)
+        m_components.Rebuild(m_nodes, m_links);
+    else
+    {
+        for (const auto& it : delta_.nodes)
+            m_components.AddNode(it.id);
+
+        for (const auto& it : delta_.links)
+            m_components.AddLink((undo_ ? it.before : it.after).value());
+    }
+
+    m_cloud_dirty = true;
+
+    update_info();
+    publish_later();
+}
+
+//----------------------------------------------------------------------
+void MainWindow::apply_delta(const SDelta& delta_, bool undo_)
+{
+    PROFILE_SCOPE("apply_delta");
+
+    {
+        SBatch batch(this, delta_.nodes.size() + delta_.links.size());
+
+        ApplyDelta(delta_, undo_, m_nodes, m_links);
+
+        scheme_changed(delta_, undo_);
+
+        for (const auto& it : delta_.nodes)
+        {
+            auto itNode = m_nodes.find(it.id);
+            if (itNode == m_nodes.end())
+                remove_vis_item(it.id);
+            else if (QGraphicsItem* pItem = vis_item(it.id))
+            {
+                if (delta_.positions)
+                    pItem->setPos(itNode->second.gnode.x, itNode->second.gnode.y);
+            }
+            else
+                create_vis_node(it.id, itNode->second.name)->setPos(itNode->second.gnode.x, itNode->second.gnode.y);
+        }
+
+        for (const auto& it : delta_.links)
+        {
+            if (!m_links.count(it.id))
+                remove_vis_item(it.id);
+            else if (!vis_item(it.id))
+                create_vis_link(it.id);
+        }
+    }
+
+    selectionChanged();
+}
+
+//----------------------------------------------------------------------
+void MainWindow::on_pbUndo_clicked()
+{
+    if (const SDelta* delta = m_undo.Undo())
+        apply_delta(*delta, true);
+}
+
+//----------------------------------------------------------------------
+void MainWindow::on_pbRedo_clicked()
+{
+    if (const SDelta* delta = m_undo.Redo())
+        apply_delta(*delta, false);
+}
+
+//----------------------------------------------------------------------
+bool MainWindow::open_scheme(const QString& caption_, TNodeList& nodes_, TLinkList& links_)
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, caption_, "", tr("Scheme Files (*.sch)"));
+    if (fileName.isEmpty())
+        return false;
+
+    if (!LoadScheme(fileName.toStdString(), nodes_, links_, &m_category_list, &m_scheme_dictionary))
+    {
+        Log("Failed to read " + fileName.toStdString());
+        return false;
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+void MainWindow::select_nodes(const std::vector<TNodeId>& ids_)
+{
+    ui->View->scene()->clearSelection();
+
+    // Nodes not materialized in lazy mode stay unselected
+    for (const auto& it : ids_)
+        if (QGraphicsItem* pItem = vis_item(it))
+            pItem->setSelected(true);
+}
+
+//----------------------------------------------------------------------
+void MainWindow::on_pbCompare_clicked()
+{
+    if (loading())
+        return;
+
+    TNodeList nodes;
+    TLinkList links;
+
+    if (!open_scheme(tr("Compare with Scheme"), nodes, links))
+        return;
+
+    const SDelta delta = DiffSchemes(nodes, links, m_nodes, m_links);
+
+    int added = 0, removed = 0, changed = 0;
+    std::vector<TNodeId> present;
+
+    for (const auto& it : delta.nodes)
+    {
+        const int changes = NodeChanges(it);
+
+        added   += changes & eNodeAdded   ? 1 : 0;
+        removed += changes & eNodeRemoved ? 1 : 0;
+        changed += changes & (eNodeAdded | eNodeRemoved) ? 0 : 1;
+
+        if (!(changes & eNodeRemoved))
+            present.push_back(it.id);
+    }
+
+    select_nodes(present);
+
+    statusBar()->showMessage(delta.Empty() ? tr("The schemes are the same")
+                                           : tr("Nodes added: %1, removed: %2, changed: %3, links changed: %4").arg(added).arg(removed).arg(changed).arg((int)delta.links.size()));
+}
+
+//----------------------------------------------------------------------
+void MainWindow::on_pbMerge_clicked()
+{
+    if (loading())
+        return;
+
+    TNodeList base_nodes, their_nodes;
+    TLinkList base_links, their_links;
+
+    if (!open_scheme(tr("Open Common Ancestor"), base_nodes, base_links) || !open_scheme(tr("Open Their Scheme"), their_nodes, their_links))
+        return;
+
+    const SMergeResult result = MergeSchemes(base_nodes, base_links, m_nodes, m_links, their_nodes, their_links);
+
+    // The merge goes in as one edit together with their moves, undone in
+    // one step
+    SDelta delta = DiffSchemes(m_nodes, m_links, result.nodes, result.links);
+    delta.positions = true;
+
+    if (!delta.Empty())
+    {
+        apply_delta(delta, false);
+        m_undo.Push(std::move(delta));
+    }
+
+    std::vector<TNodeId> conflicting;
+
+    for (const auto& it : result.conflicts)
+    {
+        static const char* kinds[] = { "node", "device", "position", "binding", "link", "dangling" };
+
+        Log(std::string("Merge conflict: ") + kinds[it.kind] + " " + it.id);
+
+        if (it.kind != SMergeConflict::eLink && it.kind != SMergeConflict::eDangling)
+            conflicting.push_back(it.id);
+    }
+
+    select_nodes(conflicting);
+
+    statusBar()->showMessage(result.conflicts.empty() ? tr("Merged cleanly")
+                                                      : tr("Merged with %1 conflicts resolved to this scheme, see the log").arg((int)result.conflicts.size()));
+}
+
+//----------------------------------------------------------------------
+void MainWindow::on_cbPublish_toggled(bool checked_)
+{
+    m_pPublishTimer->stop();
+
+    if (!checked_)
+    {
+        m_snapshot.Close();
+        statusBar()->clearMessage();
+        return;
+    }
+
+    if (!m_snapshot.Create("/systemverifier-" + std::to_string(::getpid())))
+    {
+        ui->cbPublish->setChecked(false);
+        return;
+    }
+
+    publish();
+
+    statusBar()->showMessage(tr("Publishing to shared memory ") + QString::fromStdString(m_snapshot.Name()));
+}
+
+//----------------------------------------------------------------------
+void MainWindow::publish_later()
+{
+    if (m_snapshot.IsOpen())
+        m_pPublishTimer->start();
+}
+
+//----------------------------------------------------------------------
+void MainWindow::publish()
+{
+    // A scheme still being read is published once it is complete
+    if (loading())
+        return;
+
+    // The segment is gone when it could not grow, the reason is logged
+    if (!m_snapshot.Publish(m_nodes, m_links))
+        ui->cbPublish->setChecked(false);
+}
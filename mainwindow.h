@@ -3,13 +3,18 @@
 
 #include <QMainWindow>
 
-#include <vector>
-#include <string>
-#include <map>
-#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <future>
+
+#include "scheme.h"
+#include "portreach.h"
+#include "undo.h"
+#include "power.h"
+#include "components.h"
+#include "spatial.h"
+#include "schemesnapshot.h"
 
-#include "nop/serializer.h"
-#include "nop/structure.h"
 #include "nop/utility/stream_writer.h"
 #include "nop/utility/stream_reader.h"
 
@@ -18,230 +23,13 @@ namespace Ui {
 }
 
 class QGraphicsEllipseItem;
+class QGraphicsLineItem;
+class QGraphicsItem;
+class QProgressBar;
+class QTimer;
 
 //----------------------------------------------------------------------
-typedef std::string TDevId;
-typedef std::string TNodeId;
-typedef std::string TLinkId;
-typedef std::string TCategory;
-
-//----------------------------------------------------------------------
-
-typedef std::pair<std::string, std::string> TPair;
-
-//----------------------------------------------------------------------
-inline void Log(const std::string& msg_)
-{
-    printf("%s \n", msg_.c_str());
-}
-
-//----------------------------------------------------------------------
-template<typename T>
-const std::optional<T>& CheckLog(const std::optional<T>& val_, const std::string& msg_)
-{
-    if (!val_.has_value())
-        printf("Error: no value. \n %s \n", msg_.c_str());
-    return val_;
-}
-
-//----------------------------------------------------------------------
-inline std::string shrink_str(std::string str_)
-{
-    if (str_.size() > 1)
-    {
-        str_.erase(0, 1);
-        str_.erase(str_.size() - 1, 1);
-    }
-
-    return str_;
-}
-
-//----------------------------------------------------------------------
-inline std::optional<char> ind2let(int n_)
-{
-    return n_ >= 1 && n_ <= 26 ? "abcdefghijklmnopqrstuvwxyz"[n_ - 1] : std::optional<char>();
-}
-
-//----------------------------------------------------------------------
-inline TPair Split(const std::string& str_, const char* symbol_)
-{
-    TPair result;
-
-    auto pos = str_.find(symbol_);
-    if (pos != std::string::npos)
-    {
-        result.first    = str_.substr(0, pos);
-        result.second   = str_.substr(pos + 1, str_.size());
-    }
-
-    return result;
-}
-
-//----------------------------------------------------------------------
-inline std::string to_lower(std::string string_)
-{
-    std::locale loc;
-    for (auto& it : string_)
-        it = std::tolower(it, loc);
-    return string_;
-}
-
-//----------------------------------------------------------------------
-struct SConnect
-{
-    TNodeId node;
-    TLinkId link;
-    int     input { -1 };
-
-    void Reset()
-    {
-        node.clear();
-        link.clear();
-        input = -1;
-    }
-
-    NOP_STRUCTURE(SConnect, node, link, input);
-};
-
-//----------------------------------------------------------------------
-struct SInput
-{
-    std::string name;
-    SConnect    connect;
-
-    bool IsOn() const { return !connect.node.empty(); }
-
-    SInput() {}
-    SInput(const std::string& name_) : name(name_)
-    {}
-
-    NOP_STRUCTURE(SInput, name, connect);
-};
-
-//----------------------------------------------------------------------
-struct SGraphNode
-{
-    int x {}, y {};
-
-    NOP_STRUCTURE(SGraphNode, x, y);
-};
-
-//----------------------------------------------------------------------
-typedef std::set<std::string> TPortList;
-
-//----------------------------------------------------------------------
-struct SDevice
-{
-    TDevId              id;
-    std::string         name;
-    std::vector<SInput> inputs;
-    std::string         rule;
-    SGraphNode          gnode;
-    double              power   {};
-
-    NOP_STRUCTURE(SDevice, id, name, inputs, rule, gnode, power);
-
-    void Reset() {
-        id      .clear();
-        name    .clear();
-        inputs  .clear();
-        rule    .clear();
-        gnode.x = 0;
-        gnode.y = 0;
-        power = 0.0;
-    }
-
-    std::string Print_description() const
-    {
-        std::string descr;
-        descr += "Device name: " + name + "\n";
-        descr += "Device I/O \n";
-        descr += "//============ \n";
-
-        for (const auto& itInput : inputs)
-            descr += itInput.name + "\n";
-
-        descr += "//============ \n";
-
-        return descr;
-    }
-
-    std::string Storage_description() const
-    {
-        std::string descr;
-
-        descr += "id:"      + id    + "\n";
-        descr += "name:"    + name  + "\n";
-
-        for (const auto& itInput : inputs)
-            descr += "input:" + itInput.name + "\n";
-
-        descr += "pwr:"     + std::to_string(power) + "\n";
-        descr += "rule:"    + rule;
-
-        return descr;
-    }
-
-    static std::optional<std::string> IdParam(const std::string& str_)
-    {
-        TPair pr = Split(str_, ":");
-
-        return pr.first == "id" ? std::optional<std::string>(pr.second) : std::optional<std::string>();
-    }
-
-    void Parse_param(const std::string& str_)
-    {
-        TPair pair = Split(str_, ":");
-
-        if      (pair.first == "id")
-        {
-            id = pair.second;
-        }
-        else if (pair.first == "name")
-        {
-            name = pair.second;
-        }
-        else if (pair.first == "input")
-        {
-            inputs.push_back(SInput(to_lower(pair.second)));
-        }
-        else if (pair.first == "rule")
-        {
-            rule = to_lower(pair.second);
-        }
-        else if (pair.first == "pwr")
-        {
-            power = std::stod(pair.second);
-        }
-    }
-
-    bool Validate(const TPortList& ports_)
-    {
-        if (inputs.size() >= 26)
-            return false;
-
-        for (const auto& it : inputs)
-        {
-            if (!ports_.count(Split(it.name, ":").second))
-            return false;
-        }
-        return true;
-    }
-};
-
-typedef std::map<TDevId     , SDevice   >  TDevList;
-typedef std::map<TNodeId    , SDevice   >  TNodeList;
-typedef std::map<TCategory  , TDevList  >  TCategoryList;
-
-//----------------------------------------------------------------------
-struct SLink
-{
-    std::array<TNodeId, 2> nodes;
-
-    NOP_STRUCTURE(SLink, nodes);
-};
-
-typedef std::map<TLinkId, SLink> TLinkList;
+typedef std::unordered_map<std::string, QGraphicsItem*> TItemIndex;
 
 //----------------------------------------------------------------------
 class MainWindow : public QMainWindow
@@ -266,35 +54,136 @@ private slots:
     void on_pbClear_clicked();
     void on_devList_itemSelectionChanged();
     void on_pbPrint_clicked();
+    void on_pbPrintBatch_clicked();
+    void on_pbSaveTrace_clicked();
     void on_pbNewDevice_clicked();
     void on_pbSaveImage_clicked();
     void on_pbAddCategory_clicked();
+    void on_linputs_currentRowChanged(int row_);
+    void on_pbAutoComplete_clicked();
+    void on_pbExplore_clicked();
+    void on_pbBindAll_clicked();
+    void on_pbUndo_clicked();
+    void on_pbRedo_clicked();
+    void on_cbLazy_toggled(bool checked_);
+    void on_pbCompare_clicked();
+    void on_pbMerge_clicked();
+    void on_cbPublish_toggled(bool checked_);
 
 public slots:
     void checkStates();
 
+private slots:
+    void loadStep();
+    void viewChanged();
+    void materialize();
+    void lodChanged(int lod_);
+    void publish();
+
 private:
 
+    // Scene mutations inside a batch are laid out and repainted once,
+    // when the outermost batch ends. items_ is the number of items the
+    // batch adds or removes, bulk batches rebuild the scene index once.
+    struct SBatch
+    {
+        explicit SBatch(MainWindow* pWindow_, size_t items_ = 0) : pWindow(pWindow_) { pWindow->begin_batch(items_); }
+        ~SBatch() { pWindow->end_batch(); }
+
+        MainWindow* pWindow;
+    };
+
+    void begin_batch(size_t items_);
+    void end_batch();
+
+    // Scheme read on a worker thread
+    struct SLoadedScheme
+    {
+        std::string     file_name;
+        bool            loaded {};
+        TNodeList       nodes;
+        TLinkList       links;
+        PowerModel      power;
+        ComponentIndex  components;
+    };
+
+    bool loading() const { return m_load.valid() || m_populating; }
+    void finish_load();
+
     void keyPressEvent(QKeyEvent* event);
     QGraphicsEllipseItem* create_vis_node(const TNodeId& uuid_, const std::string& dev_name_);
+    QGraphicsLineItem*    create_vis_link(const TLinkId& uuid_);
+    QGraphicsItem*        vis_item(const std::string& uuid_) const;
+    void                  remove_vis_item(const std::string& uuid_);
+    QPointF               node_center(const TNodeId& id_) const;
+    void                  apply_lod(QGraphicsItem* pItem_) const;
+    void                  index_link(const TLinkId& id_);
+    void                  index_node_links(const TNodeId& id_);
+    size_t                update_point_cloud();
 
     void read_categories();
     void update_dev_list();
+    void update_reach_hints();
     void restore();
     void store() const;
     void clear();
+    void apply_delta(const SDelta& delta_, bool undo_);
+    bool open_scheme(const QString& caption_, TNodeList& nodes_, TLinkList& links_);
+    void select_nodes(const std::vector<TNodeId>& ids_);
+    void commit_edit(SchemeEdit& edit_);
+    void scheme_changed(const SDelta& delta_, bool undo_);
+    void update_info();
+    void highlight_component(const TNodeId& id_);
+    void update_perf();
+    void update_profiling();
+    void publish_later();
+    QPen node_pen(const TNodeId& id_) const;
 
     Ui::MainWindow* ui;
     TNodeList       m_nodes;
     TLinkList       m_links;
     TCategoryList   m_category_list;
     TPortList       m_ports;
+    PortReach       m_reach;
 
     std::string     m_root_folder;
     std::string     m_data_folder;
+    std::string     m_scheme_dictionary;
 
     TNodeId         m_rdev;
     TNodeId         m_ldev;
+
+    TItemIndex      m_items;
+    UndoStack       m_undo;
+    PowerModel      m_power;
+    ComponentIndex  m_components;
+    std::unordered_set<TNodeId> m_islands;
+    TNodeId         m_component_of;             // Selected node whose component is highlighted
+    std::unordered_set<TNodeId> m_component;
+    int             m_batch_depth {};
+    bool            m_unindexed {};
+    bool            m_scene_dirty {};
+    bool            m_tracing {};
+
+    std::future<SLoadedScheme>  m_load;
+    TNodeList::const_iterator   m_load_node;
+    TLinkList::const_iterator   m_load_link;
+    int                         m_load_done {};
+    bool                        m_populating {};
+    QTimer*                     m_pLoadTimer {};
+    QProgressBar*               m_pProgress {};
+
+    GridIndex                           m_grid;
+    BoxGridIndex                        m_link_grid;
+    bool                                m_lazy {};
+    std::vector<QGraphicsEllipseItem*>  m_node_pool;
+    std::vector<QGraphicsLineItem*>     m_link_pool;
+    QTimer*                             m_pViewTimer {};
+    bool                                m_cloud_dirty {};
+    double                              m_cloud_cell {};    // Aggregation cell of the current cloud
+
+    SnapshotWriter                      m_snapshot;
+    QTimer*                             m_pPublishTimer {};
 };
 
 #endif // MAINWINDOW_H
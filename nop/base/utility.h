@@ -18,6 +18,7 @@
 #define LIBNOP_INCLUDE_NOP_BASE_UTILITY_H_
 
 #include <cstddef>
+#include <memory>
 #include <type_traits>
 
 #include <nop/traits/is_template_base_of.h>
@@ -77,6 +78,23 @@ template <typename T, typename U>
 using EnableIfConvertible =
     typename std::enable_if<std::is_convertible<T, U>::value>::type;
 
+// Constructs an element for a container using the container's allocator when
+// the element type is allocator-aware (e.g. std::pmr::string in a std::pmr
+// map), so that it is created in the same memory resource as the container.
+template <typename T, typename Allocator>
+T ConstructWithAllocator(const Allocator& allocator, std::true_type) {
+  return T(allocator);
+}
+template <typename T, typename Allocator>
+T ConstructWithAllocator(const Allocator& /*allocator*/, std::false_type) {
+  return T();
+}
+template <typename T, typename Allocator>
+T ConstructWithAllocator(const Allocator& allocator) {
+  return ConstructWithAllocator<T>(allocator,
+                                   std::uses_allocator<T, Allocator>{});
+}
+
 // Utility type to retrieve the first type in a parameter pack.
 template <typename...>
 struct FirstType {};
@@ -47,8 +47,9 @@ struct Encoding<std::map<Key, T, Compare, Allocator>>
     return BaseEncodingSize(Prefix(value)) +
            Encoding<SizeType>::Size(value.size()) +
            std::accumulate(
-               value.cbegin(), value.cend(), 0U,
-               [](const std::size_t& sum, const std::pair<Key, T>& element) {
+               value.cbegin(), value.cend(), std::size_t{0},
+               [](const std::size_t& sum,
+                  const typename Type::value_type& element) {
                  return sum + Encoding<Key>::Size(element.first) +
                         Encoding<T>::Size(element.second);
                });
@@ -66,7 +67,7 @@ struct Encoding<std::map<Key, T, Compare, Allocator>>
     if (!status)
       return status;
 
-    for (const std::pair<Key, T>& element : value) {
+    for (const typename Type::value_type& element : value) {
       status = Encoding<Key>::Write(element.first, writer);
       if (!status)
         return status;
@@ -89,16 +90,25 @@ struct Encoding<std::map<Key, T, Compare, Allocator>>
 
     value->clear();
     for (SizeType i = 0; i < size; i++) {
-      std::pair<Key, T> element;
-      status = Encoding<Key>::Read(&element.first, reader);
+      // The key is read with the map's allocator and the value in place.
+      // Encoded maps are ordered, so the end is the insertion hint.
+      Key key = ConstructWithAllocator<Key>(value->get_allocator());
+      status = Encoding<Key>::Read(&key, reader);
       if (!status)
         return status;
 
-      status = Encoding<T>::Read(&element.second, reader);
+      const std::size_t count = value->size();
+      auto element = value->try_emplace(value->end(), std::move(key));
+
+      // The first of duplicate keys is kept.
+      if (value->size() == count) {
+        T duplicate = ConstructWithAllocator<T>(value->get_allocator());
+        status = Encoding<T>::Read(&duplicate, reader);
+      } else {
+        status = Encoding<T>::Read(&element->second, reader);
+      }
       if (!status)
         return status;
-
-      value->emplace(std::move(element));
     }
 
     return {};
@@ -119,8 +129,9 @@ struct Encoding<std::unordered_map<Key, T, Hash, KeyEqual, Allocator>>
     return BaseEncodingSize(Prefix(value)) +
            Encoding<SizeType>::Size(value.size()) +
            std::accumulate(
-               value.cbegin(), value.cend(), 0U,
-               [](const std::size_t& sum, const std::pair<Key, T>& element) {
+               value.cbegin(), value.cend(), std::size_t{0},
+               [](const std::size_t& sum,
+                  const typename Type::value_type& element) {
                  return sum + Encoding<Key>::Size(element.first) +
                         Encoding<T>::Size(element.second);
                });
@@ -138,7 +149,7 @@ struct Encoding<std::unordered_map<Key, T, Hash, KeyEqual, Allocator>>
     if (!status)
       return status;
 
-    for (const std::pair<Key, T>& element : value) {
+    for (const typename Type::value_type& element : value) {
       status = Encoding<Key>::Write(element.first, writer);
       if (!status)
         return status;
@@ -161,16 +172,24 @@ struct Encoding<std::unordered_map<Key, T, Hash, KeyEqual, Allocator>>
 
     value->clear();
     for (SizeType i = 0; i < size; i++) {
-      std::pair<Key, T> element;
-      status = Encoding<Key>::Read(&element.first, reader);
+      // The key is read with the map's allocator and the value in place.
+      Key key = ConstructWithAllocator<Key>(value->get_allocator());
+      status = Encoding<Key>::Read(&key, reader);
       if (!status)
         return status;
 
-      status = Encoding<T>::Read(&element.second, reader);
+      const std::size_t count = value->size();
+      auto element = value->try_emplace(std::move(key)).first;
+
+      // The first of duplicate keys is kept.
+      if (value->size() == count) {
+        T duplicate = ConstructWithAllocator<T>(value->get_allocator());
+        status = Encoding<T>::Read(&duplicate, reader);
+      } else {
+        status = Encoding<T>::Read(&element->second, reader);
+      }
       if (!status)
         return status;
-
-      value->emplace(std::move(element));
     }
 
     return {};
@@ -101,12 +101,11 @@ struct Encoding<std::vector<T, Allocator>, EnableIfNotIntegral<T>>
     // of allocations.
     value->clear();
     for (SizeType i = 0; i < size; i++) {
-      T element;
-      status = Encoding<T>::Read(&element, reader);
+      // Constructed in place, with the vector's allocator if it has one.
+      value->emplace_back();
+      status = Encoding<T>::Read(&value->back(), reader);
       if (!status)
         return status;
-
-      value->push_back(std::move(element));
     }
 
     return {};
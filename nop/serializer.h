@@ -29,6 +29,9 @@
 #include <nop/base/result.h>
 #include <nop/base/serializer.h>
 #include <nop/base/string.h>
+#if __cplusplus >= 201703L
+#include <nop/base/string_view.h>
+#endif
 #include <nop/base/table.h>
 #include <nop/base/tuple.h>
 #include <nop/base/value.h>
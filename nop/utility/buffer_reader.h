@@ -77,6 +77,17 @@ class BufferReader {
     return {};
   }
 
+  // Points data at the next size bytes of the buffer and skips them, for
+  // encodings that refer to the buffer instead of copying out of it.
+  constexpr Status<void> Borrow(std::size_t size, const void** data) {
+    if (size > (size_ - index_))
+      return ErrorStatus::ReadLimitReached;
+
+    *data = &buffer_[index_];
+    index_ += size;
+    return {};
+  }
+
   constexpr bool empty() const { return index_ == size_; }
 
   constexpr std::size_t remaining() const { return size_ - index_; }
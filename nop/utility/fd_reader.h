@@ -21,6 +21,9 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
 #include <utility>
 
 #include <nop/status.h>
@@ -79,8 +82,77 @@ class FdReader {
     std::uint8_t* begin_byte = static_cast<std::uint8_t*>(begin);
     std::uint8_t* end_byte = static_cast<std::uint8_t*>(end);
 
-    for (std::uint8_t* byte = begin_byte; byte < end_byte; byte++) {
-      auto status = Read(byte);
+    while (begin_byte < end_byte) {
+      const ssize_t ret = ::read(fd_, begin_byte, end_byte - begin_byte);
+      if (ret > 0)
+        begin_byte += ret;
+      else if (ret == 0)
+        return ErrorStatus::ReadLimitReached;
+      else if (errno != EINTR)
+        return ErrorStatus::IOError;
+    }
+
+    return {};
+  }
+
+ private:
+  int fd_{-1};
+};
+
+// BufferedFdReader is a reader type that wraps around a UNIX file descriptor
+// and reads ahead into an internal buffer. Ranges are copied out of the
+// buffer in bulk; the part of a large range that is not buffered yet is read
+// directly into the destination. Like FdReader it takes ownership of the fd.
+class BufferedFdReader {
+ public:
+  static constexpr std::size_t kDefaultCapacity = 256 * 1024;
+
+  BufferedFdReader() = default;
+  BufferedFdReader(int fd, std::size_t capacity = kDefaultCapacity)
+      : fd_{fd},
+        buffer_{new std::uint8_t[capacity]},
+        capacity_{capacity} {}
+  BufferedFdReader(const BufferedFdReader&) = delete;
+  BufferedFdReader(BufferedFdReader&& other) { *this = std::move(other); }
+
+  ~BufferedFdReader() { Clear(); }
+
+  BufferedFdReader& operator=(const BufferedFdReader&) = delete;
+  BufferedFdReader& operator=(BufferedFdReader&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(fd_, other.fd_);
+      std::swap(buffer_, other.buffer_);
+      std::swap(capacity_, other.capacity_);
+      std::swap(begin_, other.begin_);
+      std::swap(end_, other.end_);
+    }
+    return *this;
+  }
+
+  void Clear() {
+    if (fd_ >= 0)
+      ::close(fd_);
+    fd_ = -1;
+    begin_ = end_ = 0;
+  }
+
+  // Read-ahead data is dropped with the reader.
+  int Release() {
+    const int released_fd = fd_;
+    fd_ = -1;
+    begin_ = end_ = 0;
+    return released_fd;
+  }
+
+  // Succeeds when size bytes can be read. Sizes above the buffer capacity
+  // are checked only as far as the buffer reaches; the reads that follow
+  // report a premature end.
+  Status<void> Ensure(std::size_t size) {
+    const std::size_t wanted = std::min(size, capacity_);
+
+    while (available() < wanted) {
+      auto status = Fill();
       if (!status)
         return status;
     }
@@ -88,8 +160,98 @@ class FdReader {
     return {};
   }
 
+  Status<void> Read(std::uint8_t* byte) {
+    if (begin_ == end_) {
+      auto status = Fill();
+      if (!status)
+        return status;
+    }
+
+    *byte = buffer_[begin_++];
+    return {};
+  }
+
+  Status<void> Read(void* begin, void* end) {
+    std::uint8_t* begin_byte = static_cast<std::uint8_t*>(begin);
+    std::uint8_t* end_byte = static_cast<std::uint8_t*>(end);
+
+    while (begin_byte < end_byte) {
+      const std::size_t length_bytes = end_byte - begin_byte;
+
+      if (begin_ != end_) {
+        const std::size_t count = std::min(length_bytes, available());
+        std::memcpy(begin_byte, &buffer_[begin_], count);
+        begin_ += count;
+        begin_byte += count;
+        continue;
+      }
+
+      // Large remainders bypass the buffer.
+      if (length_bytes >= capacity_) {
+        const ssize_t ret = ::read(fd_, begin_byte, length_bytes);
+        if (ret > 0)
+          begin_byte += ret;
+        else if (ret == 0)
+          return ErrorStatus::ReadLimitReached;
+        else if (errno != EINTR)
+          return ErrorStatus::IOError;
+        continue;
+      }
+
+      auto status = Fill();
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    while (padding_bytes) {
+      if (begin_ == end_) {
+        auto status = Fill();
+        if (!status)
+          return status;
+      }
+
+      const std::size_t count = std::min(padding_bytes, available());
+      begin_ += count;
+      padding_bytes -= count;
+    }
+
+    return {};
+  }
+
+  std::size_t available() const { return end_ - begin_; }
+  std::size_t capacity() const { return capacity_; }
+
  private:
+  // Moves unread data to the front of the buffer and reads more after it.
+  Status<void> Fill() {
+    if (begin_ > 0) {
+      std::memmove(&buffer_[0], &buffer_[begin_], available());
+      end_ -= begin_;
+      begin_ = 0;
+    }
+
+    while (true) {
+      const ssize_t ret = ::read(fd_, &buffer_[end_], capacity_ - end_);
+      if (ret > 0) {
+        end_ += ret;
+        return {};
+      } else if (ret == 0) {
+        return ErrorStatus::ReadLimitReached;
+      } else if (errno != EINTR) {
+        return ErrorStatus::IOError;
+      }
+    }
+  }
+
   int fd_{-1};
+  std::unique_ptr<std::uint8_t[]> buffer_;
+  std::size_t capacity_{0};
+  std::size_t begin_{0};
+  std::size_t end_{0};
 };
 
 }  // namespace nop
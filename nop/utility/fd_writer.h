@@ -19,8 +19,12 @@
 
 #include <errno.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
 #include <utility>
 
 #include <nop/status.h>
@@ -76,17 +80,185 @@ class FdWriter {
     const std::uint8_t* begin_byte = static_cast<const std::uint8_t*>(begin);
     const std::uint8_t* end_byte = static_cast<const std::uint8_t*>(end);
 
-    for (const std::uint8_t* byte = begin_byte; byte < end_byte; byte++) {
-      auto status = Write(*byte);
+    while (begin_byte < end_byte) {
+      const ssize_t ret = ::write(fd_, begin_byte, end_byte - begin_byte);
+      if (ret > 0)
+        begin_byte += ret;
+      else if (ret == 0)
+        return ErrorStatus::WriteLimitReached;
+      else if (errno != EINTR)
+        return ErrorStatus::IOError;
+    }
+
+    return {};
+  }
+
+ private:
+  int fd_{-1};
+};
+
+// BufferedFdWriter is a writer type that wraps around a UNIX file descriptor
+// and collects writes in an internal buffer. The buffer is written out when
+// full, on Flush() and when the writer is destroyed or released; ranges that
+// do not fit are written together with the pending buffer by one writev call
+// instead of being copied. Like FdWriter it takes ownership of the fd.
+class BufferedFdWriter {
+ public:
+  static constexpr std::size_t kDefaultCapacity = 256 * 1024;
+
+  BufferedFdWriter() = default;
+  BufferedFdWriter(int fd, std::size_t capacity = kDefaultCapacity)
+      : fd_{fd},
+        buffer_{new std::uint8_t[capacity]},
+        capacity_{capacity} {}
+  BufferedFdWriter(const BufferedFdWriter&) = delete;
+  BufferedFdWriter(BufferedFdWriter&& other) { *this = std::move(other); }
+
+  ~BufferedFdWriter() { Clear(); }
+
+  BufferedFdWriter& operator=(const BufferedFdWriter&) = delete;
+  BufferedFdWriter& operator=(BufferedFdWriter&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(fd_, other.fd_);
+      std::swap(buffer_, other.buffer_);
+      std::swap(capacity_, other.capacity_);
+      std::swap(index_, other.index_);
+    }
+    return *this;
+  }
+
+  // Flushes pending data and closes the fd. Errors of the final flush are
+  // lost; call Flush() first to observe them.
+  void Clear() {
+    if (fd_ >= 0) {
+      Flush();
+      ::close(fd_);
+    }
+    fd_ = -1;
+    index_ = 0;
+  }
+
+  int Release() {
+    Flush();
+    const int released_fd = fd_;
+    fd_ = -1;
+    return released_fd;
+  }
+
+  // Makes room for size contiguous bytes when they fit into the buffer.
+  // Larger payloads are passed through by the range Write().
+  Status<void> Prepare(std::size_t size) {
+    if (size > capacity_ - index_)
+      return Flush();
+    else
+      return {};
+  }
+
+  Status<void> Write(std::uint8_t byte) {
+    if (index_ == capacity_) {
+      auto status = Flush();
       if (!status)
         return status;
     }
 
+    buffer_[index_++] = byte;
     return {};
   }
 
+  Status<void> Write(const void* begin, const void* end) {
+    const std::uint8_t* begin_byte = static_cast<const std::uint8_t*>(begin);
+    const std::uint8_t* end_byte = static_cast<const std::uint8_t*>(end);
+    const std::size_t length_bytes = end_byte - begin_byte;
+
+    if (length_bytes <= capacity_ - index_) {
+      std::memcpy(&buffer_[index_], begin_byte, length_bytes);
+      index_ += length_bytes;
+      return {};
+    }
+
+    // Small ranges go through the buffer, large ones straight to the fd
+    // along with what is pending.
+    if (length_bytes < capacity_) {
+      auto status = Flush();
+      if (!status)
+        return status;
+
+      std::memcpy(&buffer_[0], begin_byte, length_bytes);
+      index_ = length_bytes;
+      return {};
+    }
+
+    iovec vec[2] = {{&buffer_[0], index_},
+                    {const_cast<std::uint8_t*>(begin_byte), length_bytes}};
+    index_ = 0;
+    return WriteAll(vec, 2);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    while (padding_bytes) {
+      if (index_ == capacity_) {
+        auto status = Flush();
+        if (!status)
+          return status;
+      }
+
+      const std::size_t count = std::min(padding_bytes, capacity_ - index_);
+      std::memset(&buffer_[index_], padding_value, count);
+      index_ += count;
+      padding_bytes -= count;
+    }
+
+    return {};
+  }
+
+  // Writes out the buffered data.
+  Status<void> Flush() {
+    if (index_ == 0)
+      return {};
+
+    iovec vec[1] = {{&buffer_[0], index_}};
+    index_ = 0;
+    return WriteAll(vec, 1);
+  }
+
+  std::size_t pending() const { return index_; }
+  std::size_t capacity() const { return capacity_; }
+
  private:
+  // Writes the vectors completely, resuming after short writes.
+  Status<void> WriteAll(iovec* vec, int count) {
+    while (count > 0) {
+      const ssize_t ret = ::writev(fd_, vec, count);
+      if (ret < 0) {
+        if (errno == EINTR)
+          continue;  // Interrupted by signal.
+        return ErrorStatus::IOError;
+      } else if (ret == 0) {
+        return ErrorStatus::WriteLimitReached;
+      }
+
+      std::size_t written = ret;
+      while (count > 0 && written >= vec->iov_len) {
+        written -= vec->iov_len;
+        vec++;
+        count--;
+      }
+
+      if (count > 0) {
+        vec->iov_base = static_cast<std::uint8_t*>(vec->iov_base) + written;
+        vec->iov_len -= written;
+      }
+    }
+
+    return {};
+  }
+
   int fd_{-1};
+  std::unique_ptr<std::uint8_t[]> buffer_;
+  std::size_t capacity_{0};
+  std::size_t index_{0};
 };
 
 }  // namespace nop
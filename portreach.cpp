@@ -0,0 +1,141 @@
+#include "portreach.h"
+
+//----------------------------------------------------------------------
+int PortReach::intern(const std::string& port_)
+{
+    auto it = m_index.find(port_);
+    if (it != m_index.end())
+        return it->second;
+
+    const int ind = (int)m_ports.size();
+    m_index.insert( { port_, ind } );
+    m_ports.push_back(port_);
+    return ind;
+}
+
+//----------------------------------------------------------------------
+void PortReach::Clear()
+{
+    m_index.clear();
+    m_ports.clear();
+    m_mates.clear();
+    m_reach.clear();
+    m_words = 0;
+}
+
+//----------------------------------------------------------------------
+void PortReach::Build(const TCategoryList& categories_)
+{
+    Clear();
+
+    auto it_connect = categories_.find("connections");
+    if (it_connect == categories_.end())
+        return;
+
+    typedef std::pair<int, int> TEdge;
+
+    std::vector<TEdge> mates;
+    std::vector<TEdge> cables;
+
+    for (const auto& it_dev : it_connect->second)
+    {
+        const SDevice& dev = it_dev.second;
+        if (dev.inputs.size() != 2)
+            continue;
+
+        mates.push_back( { intern(dev.inputs[0].Type()), intern(dev.inputs[1].Type()) } );
+    }
+
+    for (const auto& it_cat : categories_)
+    {
+        if (it_cat.first == "connections")
+            continue;
+
+        for (const auto& it_dev : it_cat.second)
+        {
+            const SDevice& dev = it_dev.second;
+            if (!dev.IsCable())
+                continue;
+
+            cables.push_back( { intern(dev.inputs[0].Type()), intern(dev.inputs[1].Type()) } );
+        }
+    }
+
+    const int n = Size();
+    m_words = (n + 63) / 64;
+
+    m_mates.assign(n * m_words, 0);
+    for (const auto& it : mates)
+    {
+        set(m_mates, it.first, it.second);
+        set(m_mates, it.second, it.first);
+    }
+
+    TBitMatrix cable(n * m_words, 0);
+    for (const auto& it : cables)
+    {
+        set(cable, it.first, it.second);
+        set(cable, it.second, it.first);
+    }
+
+    // One hop: port X plugs into the end P of a cable and comes out at
+    // the other end Q
+    TBitMatrix hop(n * m_words, 0);
+    for (int x = 0; x < n; ++x)
+        for (int p = 0; p < n; ++p)
+            if (test(m_mates, x, p))
+                or_row(hop, x, cable, p);
+
+    // Reflexive transitive closure of the hops (Warshall over bit rows)
+    for (int x = 0; x < n; ++x)
+        set(hop, x, x);
+
+    for (int k = 0; k < n; ++k)
+        for (int x = 0; x < n; ++x)
+            if (test(hop, x, k))
+                or_row(hop, x, hop, k);
+
+    // Whatever free end is reachable must finally mate with the target
+    m_reach.assign(n * m_words, 0);
+    for (int x = 0; x < n; ++x)
+        for (int y = 0; y < n; ++y)
+            if (test(hop, x, y))
+                or_row(m_reach, x, m_mates, y);
+}
+
+//----------------------------------------------------------------------
+std::optional<int> PortReach::Index(const std::string& port_) const
+{
+    auto it = m_index.find(port_);
+    return it != m_index.end() ? std::optional<int>(it->second) : std::optional<int>();
+}
+
+//----------------------------------------------------------------------
+bool PortReach::Reachable(int from_, int to_) const
+{
+    return test(m_reach, from_, to_);
+}
+
+//----------------------------------------------------------------------
+bool PortReach::Reachable(const std::string& from_, const std::string& to_) const
+{
+    auto from = Index(from_);
+    auto to   = Index(to_);
+
+    return from.has_value() && to.has_value() && Reachable(from.value(), to.value());
+}
+
+//----------------------------------------------------------------------
+bool PortReach::Mates(int from_, int to_) const
+{
+    return test(m_mates, from_, to_);
+}
+
+//----------------------------------------------------------------------
+bool PortReach::Mates(const std::string& from_, const std::string& to_) const
+{
+    auto from = Index(from_);
+    auto to   = Index(to_);
+
+    return from.has_value() && to.has_value() && Mates(from.value(), to.value());
+}
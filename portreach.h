@@ -0,0 +1,64 @@
+#ifndef PORTREACH_H
+#define PORTREACH_H
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "scheme.h"
+
+//----------------------------------------------------------------------
+// Transitive reachability between port types.
+//
+// Port type X reaches port type Z if a port of type X can be brought to
+// a port of type Z either directly (a pair listed in the "connections"
+// category) or through any chain of catalog cables/adapters. The closure
+// is computed once per catalog load and stored as a bit matrix, so a
+// query is a single bit test.
+class PortReach
+{
+public:
+    void Build(const TCategoryList& categories_);
+    void Clear();
+
+    std::optional<int> Index(const std::string& port_) const;
+
+    bool Reachable(int from_, int to_) const;
+    bool Reachable(const std::string& from_, const std::string& to_) const;
+
+    // Direct mating, no cables in between
+    bool Mates(int from_, int to_) const;
+    bool Mates(const std::string& from_, const std::string& to_) const;
+
+    int Size() const { return (int)m_ports.size(); }
+    const std::string& Port(int ind_) const { return m_ports[ind_]; }
+
+private:
+    typedef std::vector<uint64_t> TBitMatrix;
+
+    bool test(const TBitMatrix& m_, int row_, int col_) const
+    {
+        return (m_[row_ * m_words + (col_ >> 6)] >> (col_ & 63)) & 1;
+    }
+
+    void set(TBitMatrix& m_, int row_, int col_)
+    {
+        m_[row_ * m_words + (col_ >> 6)] |= uint64_t(1) << (col_ & 63);
+    }
+
+    void or_row(TBitMatrix& dst_, int dst_row_, const TBitMatrix& src_, int src_row_)
+    {
+        for (int w = 0; w < m_words; ++w)
+            dst_[dst_row_ * m_words + w] |= src_[src_row_ * m_words + w];
+    }
+
+    int intern(const std::string& port_);
+
+    std::unordered_map<std::string, int>    m_index;
+    std::vector<std::string>                m_ports;
+    int                                     m_words {};
+
+    TBitMatrix                              m_mates;
+    TBitMatrix                              m_reach;
+};
+
+#endif // PORTREACH_H
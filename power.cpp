@@ -0,0 +1,138 @@
+#include "power.h"
+
+#include <unordered_set>
+
+//----------------------------------------------------------------------
+static const std::set<std::string> power_ports { "c13", "c14", "c19", "c20", "cee 7/3", "cee 7/7" };
+static const std::set<std::string> outlets     { "c13", "c19", "cee 7/3" };
+
+//----------------------------------------------------------------------
+bool PowerModel::IsPowerPort(const std::string& type_)
+{
+    return power_ports.count(type_) != 0;
+}
+
+//----------------------------------------------------------------------
+bool PowerModel::IsOutlet(const std::string& type_)
+{
+    return outlets.count(type_) != 0;
+}
+
+//----------------------------------------------------------------------
+double PowerModel::capacity(const SDevice& dev_) const
+{
+    auto it = m_capacities.find(dev_.id);
+    return it != m_capacities.end() ? it->second : 0.0;
+}
+
+//----------------------------------------------------------------------
+double PowerModel::tree_load(const TNodeList& nodes_, const TNodeId& ups_) const
+{
+    double load = 0.0;
+
+    std::unordered_set<TNodeId> visited { ups_ };
+    std::vector<TNodeId>        stack;
+
+    for (const auto& it : nodes_.at(ups_).inputs)
+        if (it.IsOn() && IsOutlet(it.Type()))
+            stack.push_back(it.connect.node);
+
+    while (!stack.empty())
+    {
+        TNodeId id = stack.back();
+        stack.pop_back();
+
+        if (!visited.insert(id).second)
+            continue;
+
+        auto itNode = nodes_.find(id);
+        if (itNode == nodes_.end())
+            continue;
+
+        const SDevice& dev = itNode->second;
+
+        // Daisy-chained UPSes account for their own trees
+        if (capacity(dev) > 0.0)
+            continue;
+
+        if (dev.power > 0.0)
+        {
+            load += dev.power;
+            continue;
+        }
+
+        for (const auto& it : dev.inputs)
+            if (it.IsOn() && IsPowerPort(it.Type()))
+                stack.push_back(it.connect.node);
+    }
+
+    return load;
+}
+
+//----------------------------------------------------------------------
+void PowerModel::find_roots(const TNodeList& nodes_, const TNodeId& start_, std::set<TNodeId>& roots_) const
+{
+    std::unordered_set<TNodeId> visited;
+    std::vector<TNodeId>        stack { start_ };
+
+    while (!stack.empty())
+    {
+        TNodeId id = stack.back();
+        stack.pop_back();
+
+        if (!visited.insert(id).second)
+            continue;
+
+        auto itNode = nodes_.find(id);
+        if (itNode == nodes_.end())
+            continue;
+
+        const SDevice& dev = itNode->second;
+
+        if (capacity(dev) > 0.0)
+        {
+            roots_.insert(id);
+            continue;
+        }
+
+        if (id != start_ && dev.power > 0.0)
+            continue;
+
+        for (const auto& it : dev.inputs)
+            if (it.IsOn() && IsPowerPort(it.Type()))
+                stack.push_back(it.connect.node);
+    }
+}
+
+//----------------------------------------------------------------------
+void PowerModel::Update(const TNodeList& nodes_, const std::vector<TNodeId>& touched_)
+{
+    std::set<TNodeId> roots;
+
+    for (const auto& it : touched_)
+    {
+        auto itNode = nodes_.find(it);
+        if (itNode == nodes_.end() || capacity(itNode->second) <= 0.0)
+            m_ups.erase(it);
+
+        find_roots(nodes_, it, roots);
+    }
+
+    for (const auto& it : roots)
+        m_ups[it] = { tree_load(nodes_, it), capacity(nodes_.at(it)) };
+}
+
+//----------------------------------------------------------------------
+void PowerModel::Rebuild(const TNodeList& nodes_)
+{
+    m_total = 0.0;
+    m_ups.clear();
+
+    for (const auto& it : nodes_)
+    {
+        m_total += it.second.power;
+
+        if (capacity(it.second) > 0.0)
+            m_ups[it.first] = { tree_load(nodes_, it.first), capacity(it.second) };
+    }
+}
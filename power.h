@@ -0,0 +1,58 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <unordered_map>
+
+#include "scheme.h"
+
+//----------------------------------------------------------------------
+typedef std::unordered_map<TDevId, double> TCapacityList;
+
+//----------------------------------------------------------------------
+// Power budget of a scheme kept up to date edit by edit.
+//
+// The total is adjusted by the power difference of every changed node.
+// A UPS feeds the tree found by walking power-port links (C13/C14,
+// C19/C20, CEE) out of its outlets through passive nodes such as cables
+// down to the first powered device on each branch. An edit only
+// recomputes the trees of the UPSes upstream of the nodes it touched.
+class PowerModel
+{
+public:
+    struct SUps
+    {
+        double load     {};
+        double capacity {};
+
+        bool Overloaded() const { return load > capacity; }
+    };
+
+    typedef std::unordered_map<TNodeId, SUps> TUpsList;
+
+    void SetCapacities(const TCapacityList& capacities_) { m_capacities = capacities_; }
+
+    void Rebuild(const TNodeList& nodes_);
+
+    // Power of a node changed from before_ to after_ (0 for a missing node)
+    void Adjust(double before_, double after_) { m_total += after_ - before_; }
+
+    // Bindings of the touched nodes changed
+    void Update(const TNodeList& nodes_, const std::vector<TNodeId>& touched_);
+
+    double          Total() const   { return m_total; }
+    const TUpsList& Ups() const     { return m_ups; }
+
+    static bool IsPowerPort(const std::string& type_);
+    static bool IsOutlet(const std::string& type_);
+
+private:
+    double capacity(const SDevice& dev_) const;
+    double tree_load(const TNodeList& nodes_, const TNodeId& ups_) const;
+    void   find_roots(const TNodeList& nodes_, const TNodeId& start_, std::set<TNodeId>& roots_) const;
+
+    TCapacityList   m_capacities;
+    TUpsList        m_ups;
+    double          m_total {};
+};
+
+#endif // POWER_H
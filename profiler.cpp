@@ -0,0 +1,165 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+
+//----------------------------------------------------------------------
+double Profiler::SStat::Percentile(double fraction_) const
+{
+    const uint64_t target = (uint64_t)(fraction_ * count);
+
+    uint64_t seen = 0;
+    for (int i = 0; i < buckets; ++i)
+    {
+        seen += histogram[i];
+        if (seen > target || seen == count)
+            return double(uint64_t(1) << i) / 1000.0;
+    }
+
+    return max_ms;
+}
+
+//----------------------------------------------------------------------
+Profiler& Profiler::Instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+//----------------------------------------------------------------------
+Profiler::Profiler() : m_origin(TClock::now())
+{}
+
+//----------------------------------------------------------------------
+static uint32_t thread_index()
+{
+    static std::atomic<uint32_t> next {0};
+    thread_local uint32_t index = next++;
+    return index;
+}
+
+//----------------------------------------------------------------------
+void Profiler::push(const SEvent& event_)
+{
+    if (m_events.size() == max_events)
+        m_events.pop_front();
+
+    m_events.push_back(event_);
+}
+
+//----------------------------------------------------------------------
+void Profiler::Record(const char* name_, TClock::time_point start_, TClock::time_point end_)
+{
+    using namespace std::chrono;
+
+    const int64_t us = duration_cast<microseconds>(end_ - start_).count();
+    const double  ms = duration<double, std::milli>(end_ - start_).count();
+
+    int bucket = 0;
+    while (bucket < buckets - 1 && (int64_t(1) << bucket) <= us)
+        ++bucket;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    SStat& stat = m_stats[name_];
+    stat.count++;
+    stat.last_ms   = ms;
+    stat.total_ms += ms;
+    stat.max_ms    = std::max(stat.max_ms, ms);
+    stat.histogram[bucket]++;
+
+    push( { name_, duration_cast<microseconds>(start_ - m_origin).count(), us, 0, thread_index() } );
+}
+
+//----------------------------------------------------------------------
+void Profiler::Count(const char* name_, int64_t value_)
+{
+    if (!m_enabled)
+        return;
+
+    using namespace std::chrono;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_counters[name_] = value_;
+
+    push( { name_, duration_cast<microseconds>(TClock::now() - m_origin).count(), -1, value_, thread_index() } );
+}
+
+//----------------------------------------------------------------------
+Profiler::SStat Profiler::Stat(const std::string& name_) const
+{
+    SStat result;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (const auto& it : m_stats)
+    {
+        if (name_ != it.first)
+            continue;
+
+        const SStat& stat = it.second;
+
+        result.count    += stat.count;
+        result.last_ms   = stat.last_ms;
+        result.total_ms += stat.total_ms;
+        result.max_ms    = std::max(result.max_ms, stat.max_ms);
+
+        for (int i = 0; i < buckets; ++i)
+            result.histogram[i] += stat.histogram[i];
+    }
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+int64_t Profiler::Counter(const std::string& name_) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // A counter is set from one place
+    for (const auto& it : m_counters)
+        if (name_ == it.first)
+            return it.second;
+
+    return 0;
+}
+
+//----------------------------------------------------------------------
+bool Profiler::SaveTrace(const std::string& file_name_) const
+{
+    std::FILE* pFile = std::fopen(file_name_.c_str(), "wb");
+    if (!pFile)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::fputs("{\"traceEvents\":[", pFile);
+
+    bool first = true;
+    for (const auto& it : m_events)
+    {
+        if (it.duration >= 0)
+            std::fprintf(pFile, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lld}",
+                         first ? "" : ",", it.name, it.thread, (long long)it.start, (long long)it.duration);
+        else
+            std::fprintf(pFile, "%s\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"args\":{\"value\":%lld}}",
+                         first ? "" : ",", it.name, it.thread, (long long)it.start, (long long)it.value);
+        first = false;
+    }
+
+    std::fputs("\n],\"displayTimeUnit\":\"ms\"}\n", pFile);
+    std::fclose(pFile);
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+void Profiler::Reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_stats.clear();
+    m_counters.clear();
+    m_events.clear();
+}
@@ -0,0 +1,113 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+//----------------------------------------------------------------------
+// Timings and counters of the hot paths.
+//
+// Scoped timers aggregate their durations per name into log2 histograms
+// (microseconds) and keep the most recent events for a Chrome trace
+// (chrome://tracing, Perfetto). Names are string literals, stats and
+// counters are kept by pointer, so recording never builds a string.
+// Stat() merges the call sites that use the same name.
+class Profiler
+{
+public:
+    typedef std::chrono::steady_clock TClock;
+
+    static const int buckets = 32;
+
+    struct SStat
+    {
+        uint64_t    count   {};
+        double      last_ms {};
+        double      total_ms{};
+        double      max_ms  {};
+
+        std::array<uint64_t, buckets> histogram {};     // Bucket i: [2^(i-1), 2^i) us
+
+        double Mean() const { return count ? total_ms / count : 0.0; }
+
+        // Upper bound of the bucket holding the given fraction of samples
+        double Percentile(double fraction_) const;
+    };
+
+    static Profiler& Instance();
+
+    // Disabled, scopes are not timed and nothing is kept. Off until
+    // enabled, e.g. while someone looks at the timings or records a trace
+    void SetEnabled(bool enabled_) { m_enabled = enabled_; }
+    bool Enabled() const { return m_enabled; }
+
+    void Record(const char* name_, TClock::time_point start_, TClock::time_point end_);
+    void Count(const char* name_, int64_t value_);
+
+    SStat   Stat(const std::string& name_) const;
+    int64_t Counter(const std::string& name_) const;
+
+    bool SaveTrace(const std::string& file_name_) const;
+    void Reset();
+
+private:
+    Profiler();
+
+    struct SEvent
+    {
+        const char* name;
+        int64_t     start;      // us since the profiler start
+        int64_t     duration;   // us, -1 for counters
+        int64_t     value;
+        uint32_t    thread;
+    };
+
+    void push(const SEvent& event_);
+
+    static const size_t max_events = 1 << 20;
+
+    std::atomic<bool>               m_enabled {false};
+    TClock::time_point              m_origin;
+
+    mutable std::mutex              m_mutex;
+    std::unordered_map<const char*, SStat>      m_stats;
+    std::unordered_map<const char*, int64_t>    m_counters;
+    std::deque<SEvent>                          m_events;
+};
+
+//----------------------------------------------------------------------
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(const char* name_) :
+        m_name(Profiler::Instance().Enabled() ? name_ : nullptr)
+    {
+        if (m_name)
+            m_start = Profiler::TClock::now();
+    }
+
+    ~ScopedTimer()
+    {
+        if (m_name)
+            Profiler::Instance().Record(m_name, m_start, Profiler::TClock::now());
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    const char*                 m_name;
+    Profiler::TClock::time_point m_start;
+};
+
+#define PROFILE_CONCAT_(a_, b_) a_##b_
+#define PROFILE_CONCAT(a_, b_)  PROFILE_CONCAT_(a_, b_)
+#define PROFILE_SCOPE(name_)    ScopedTimer PROFILE_CONCAT(scoped_timer_, __LINE__)(name_)
+
+#endif // PROFILER_H
@@ -0,0 +1,249 @@
+#include "rule.h"
+
+#include <cctype>
+
+#include "scheme.h"
+#include "LibBoolEE/LibBoolEE.h"
+
+//----------------------------------------------------------------------
+bool ResolveRule(const SDevice& dev_)
+{
+    LibBoolEE::Vals vals;
+
+    for (int i = 0; i < (int)dev_.inputs.size(); ++i)
+    {
+        bool state  = dev_.inputs[i].IsOn();
+
+        auto symbol = ind2let(i + 1);
+
+        CheckLog(symbol, "bool ResolveRule(...)");
+
+        vals.insert(std::pair<std::string, bool>(std::string(1, symbol.value()), state));
+    }
+
+    return LibBoolEE::resolve(dev_.rule, vals);
+}
+
+//----------------------------------------------------------------------
+class Rule::Parser
+{
+public:
+    Parser(const std::string& text_, Rule& rule_) : m_text(text_), m_rule(rule_)
+    {}
+
+    std::optional<int> Parse()
+    {
+        auto root = expression();
+        skip();
+        return m_pos == m_text.size() ? root : std::optional<int>();
+    }
+
+private:
+    void skip()
+    {
+        while (m_pos < m_text.size() && std::isspace((unsigned char)m_text[m_pos]))
+            ++m_pos;
+    }
+
+    bool accept(char ch_)
+    {
+        skip();
+        if (m_pos < m_text.size() && m_text[m_pos] == ch_)
+        {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    int add(SNode::EOp op_, int value_, int count_ = 0)
+    {
+        m_rule.m_nodes.push_back( { op_, value_, count_ } );
+        return (int)m_rule.m_nodes.size() - 1;
+    }
+
+    int add_list(SNode::EOp op_, const std::vector<int>& args_)
+    {
+        if (args_.size() == 1)
+            return args_[0];
+
+        const int first = (int)m_rule.m_args.size();
+        m_rule.m_args.insert(m_rule.m_args.end(), args_.begin(), args_.end());
+        return add(op_, first, (int)args_.size());
+    }
+
+    std::optional<int> expression()
+    {
+        std::vector<int> args;
+        do
+        {
+            auto arg = term();
+            if (!arg.has_value())
+                return {};
+            args.push_back(arg.value());
+        }
+        while (accept('|'));
+
+        return add_list(SNode::eOr, args);
+    }
+
+    std::optional<int> term()
+    {
+        std::vector<int> args;
+        do
+        {
+            auto arg = factor();
+            if (!arg.has_value())
+                return {};
+            args.push_back(arg.value());
+        }
+        while (accept('&'));
+
+        return add_list(SNode::eAnd, args);
+    }
+
+    std::optional<int> factor()
+    {
+        if (accept('!'))
+        {
+            auto arg = factor();
+            if (!arg.has_value())
+                return {};
+            return add(SNode::eNot, arg.value());
+        }
+
+        if (accept('('))
+        {
+            auto arg = expression();
+            if (!arg.has_value() || !accept(')'))
+                return {};
+            return arg;
+        }
+
+        skip();
+
+        std::string name;
+        while (m_pos < m_text.size() &&
+               (std::isalnum((unsigned char)m_text[m_pos]) || m_text[m_pos] == '_' || m_text[m_pos] == '-'))
+            name += m_text[m_pos++];
+
+        if (name == "1" || name == "0")
+            return add(SNode::eConst, name == "1");
+
+        if (name.size() == 1 && name[0] >= 'a' && name[0] <= 'z')
+        {
+            const int ind = name[0] - 'a';
+            m_rule.m_vars |= uint32_t(1) << ind;
+            return add(SNode::eVar, ind);
+        }
+
+        return {};
+    }
+
+    const std::string&  m_text;
+    Rule&               m_rule;
+    size_t              m_pos {};
+};
+
+//----------------------------------------------------------------------
+std::optional<Rule> Rule::Compile(const std::string& rule_)
+{
+    Rule rule;
+
+    auto root = Parser(rule_, rule).Parse();
+    if (!root.has_value())
+        return {};
+
+    rule.m_root = root.value();
+    return rule;
+}
+
+//----------------------------------------------------------------------
+Rule::EValue Rule::eval(int node_, uint32_t on_, uint32_t off_) const
+{
+    const SNode& node = m_nodes[node_];
+
+    switch (node.op)
+    {
+    case SNode::eVar:
+        if (on_  & (uint32_t(1) << node.value)) return eTrue;
+        if (off_ & (uint32_t(1) << node.value)) return eFalse;
+        return eUnknown;
+
+    case SNode::eConst:
+        return node.value ? eTrue : eFalse;
+
+    case SNode::eNot:
+    {
+        EValue val = eval(node.value, on_, off_);
+        return val == eUnknown ? eUnknown : (val == eTrue ? eFalse : eTrue);
+    }
+
+    case SNode::eAnd:
+    case SNode::eOr:
+    {
+        // Dominating value short-circuits, unknown survives otherwise
+        const EValue dominant = node.op == SNode::eAnd ? eFalse : eTrue;
+
+        EValue result = node.op == SNode::eAnd ? eTrue : eFalse;
+        for (int i = 0; i < node.count; ++i)
+        {
+            EValue val = eval(m_args[node.value + i], on_, off_);
+            if (val == dominant)
+                return dominant;
+            if (val == eUnknown)
+                result = eUnknown;
+        }
+        return result;
+    }
+    }
+
+    return eUnknown;
+}
+
+//----------------------------------------------------------------------
+Rule::EValue Rule::Eval(uint32_t on_, uint32_t off_) const
+{
+    return m_root < 0 ? eUnknown : eval(m_root, on_, off_);
+}
+
+//----------------------------------------------------------------------
+void Rule::search(uint32_t on_, uint32_t off_, uint32_t undecided_, int added_,
+                  int& best_count_, uint32_t& best_set_, uint32_t set_) const
+{
+    if (added_ >= best_count_)
+        return;
+
+    EValue val = Eval(on_, off_ | ~(on_ | undecided_));
+    if (val == eFalse)
+        return;
+
+    if (val == eTrue)
+    {
+        best_count_ = added_;
+        best_set_   = set_;
+        return;
+    }
+
+    if (!undecided_)
+        return;
+
+    const uint32_t bit = undecided_ & (~undecided_ + 1);
+
+    search(on_ | bit, off_, undecided_ & ~bit, added_ + 1, best_count_, best_set_, set_ | bit);
+    search(on_, off_ | bit, undecided_ & ~bit, added_    , best_count_, best_set_, set_);
+}
+
+//----------------------------------------------------------------------
+std::optional<uint32_t> Rule::MinExtension(uint32_t on_, uint32_t free_) const
+{
+    if (m_root < 0)
+        return {};
+
+    int         best_count  = 33;
+    uint32_t    best_set    = 0;
+
+    search(on_, 0, free_ & m_vars & ~on_, 0, best_count, best_set, 0);
+
+    return best_count <= 32 ? std::optional<uint32_t>(best_set) : std::optional<uint32_t>();
+}
@@ -0,0 +1,66 @@
+#ifndef RULE_H
+#define RULE_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct SDevice;
+
+//----------------------------------------------------------------------
+// Evaluates the device rule over its current input states with LibBoolEE
+bool ResolveRule(const SDevice& dev_);
+
+//----------------------------------------------------------------------
+// Device rule compiled to an expression tree over input indices.
+//
+// The syntax is the one accepted by LibBoolEE: single letter variables
+// 'a'..'z' standing for device inputs, constants 1/0, '!', '&', '|' and
+// parentheses. Input states are passed as bit masks (bit i = input i),
+// which makes partial (three-valued) evaluation cheap enough to drive a
+// search over which inputs still have to be connected.
+class Rule
+{
+public:
+    enum EValue { eFalse = 0, eTrue = 1, eUnknown = -1 };
+
+    static std::optional<Rule> Compile(const std::string& rule_);
+
+    // Inputs in on_ are connected, inputs in off_ are known to stay free,
+    // the rest are undecided
+    EValue Eval(uint32_t on_, uint32_t off_) const;
+
+    bool Eval(uint32_t on_) const { return Eval(on_, ~on_) == eTrue; }
+
+    // Inputs referenced by the rule
+    uint32_t Vars() const { return m_vars; }
+
+    // Smallest set of inputs taken from free_ that has to be connected in
+    // addition to on_ for the rule to hold
+    std::optional<uint32_t> MinExtension(uint32_t on_, uint32_t free_) const;
+
+private:
+    struct SNode
+    {
+        enum EOp : uint8_t { eVar, eConst, eNot, eAnd, eOr };
+
+        EOp op;
+        int value;      // variable index / constant / first argument
+        int count;      // number of arguments for eAnd/eOr
+    };
+
+    class Parser;
+
+    EValue eval(int node_, uint32_t on_, uint32_t off_) const;
+
+    void search(uint32_t on_, uint32_t off_, uint32_t undecided_, int added_,
+                int& best_count_, uint32_t& best_set_, uint32_t set_) const;
+
+    std::vector<SNode>  m_nodes;
+    std::vector<int>    m_args;
+    int                 m_root {-1};
+    uint32_t            m_vars {};
+};
+
+#endif // RULE_H
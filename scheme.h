@@ -0,0 +1,310 @@
+#ifndef SCHEME_H
+#define SCHEME_H
+
+#include <vector>
+#include <string>
+#include <array>
+#include <map>
+#include <set>
+#include <locale>
+#include <optional>
+
+#include "nop/serializer.h"
+#include "nop/structure.h"
+
+//----------------------------------------------------------------------
+typedef std::string TDevId;
+typedef std::string TNodeId;
+typedef std::string TLinkId;
+typedef std::string TCategory;
+
+//----------------------------------------------------------------------
+
+typedef std::pair<std::string, std::string> TPair;
+
+//----------------------------------------------------------------------
+inline void Log(const std::string& msg_)
+{
+    printf("%s \n", msg_.c_str());
+}
+
+//----------------------------------------------------------------------
+template<typename T>
+const std::optional<T>& CheckLog(const std::optional<T>& val_, const std::string& msg_)
+{
+    if (!val_.has_value())
+        printf("Error: no value. \n %s \n", msg_.c_str());
+    return val_;
+}
+
+//----------------------------------------------------------------------
+inline std::string shrink_str(std::string str_)
+{
+    if (str_.size() > 1)
+    {
+        str_.erase(0, 1);
+        str_.erase(str_.size() - 1, 1);
+    }
+
+    return str_;
+}
+
+//----------------------------------------------------------------------
+inline std::optional<char> ind2let(int n_)
+{
+    return n_ >= 1 && n_ <= 26 ? "abcdefghijklmnopqrstuvwxyz"[n_ - 1] : std::optional<char>();
+}
+
+//----------------------------------------------------------------------
+inline TPair Split(const std::string& str_, const char* symbol_)
+{
+    TPair result;
+
+    auto pos = str_.find(symbol_);
+    if (pos != std::string::npos)
+    {
+        result.first    = str_.substr(0, pos);
+        result.second   = str_.substr(pos + 1, str_.size());
+    }
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+inline std::string to_lower(std::string string_)
+{
+    std::locale loc;
+    for (auto& it : string_)
+        it = std::tolower(it, loc);
+    return string_;
+}
+
+//----------------------------------------------------------------------
+struct SConnect
+{
+    TNodeId node;
+    TLinkId link;
+    int     input { -1 };
+
+    void Reset()
+    {
+        node.clear();
+        link.clear();
+        input = -1;
+    }
+
+    bool operator==(const SConnect& other_) const { return node == other_.node && link == other_.link && input == other_.input; }
+    bool operator!=(const SConnect& other_) const { return !(*this == other_); }
+
+    NOP_STRUCTURE(SConnect, node, link, input);
+};
+
+//----------------------------------------------------------------------
+struct SInput
+{
+    std::string name;
+    SConnect    connect;
+
+    bool IsOn() const { return !connect.node.empty(); }
+
+    // Port type without the rule letter, e.g. "a:hdmi_f" -> "hdmi_f"
+    std::string Type() const { return Split(name, ":").second; }
+
+    SInput() {}
+    SInput(const std::string& name_) : name(name_)
+    {}
+
+    NOP_STRUCTURE(SInput, name, connect);
+};
+
+//----------------------------------------------------------------------
+struct SGraphNode
+{
+    int x {}, y {};
+
+    bool operator==(const SGraphNode& other_) const { return x == other_.x && y == other_.y; }
+    bool operator!=(const SGraphNode& other_) const { return !(*this == other_); }
+
+    NOP_STRUCTURE(SGraphNode, x, y);
+};
+
+//----------------------------------------------------------------------
+typedef std::set<std::string> TPortList;
+
+//----------------------------------------------------------------------
+struct SDevice
+{
+    TDevId              id;
+    std::string         name;
+    std::vector<SInput> inputs;
+    std::string         rule;
+    SGraphNode          gnode;
+    double              power   {};
+
+    // Catalog only: output power limit of UPSes, not stored in schemes
+    double              capacity{};
+
+    NOP_STRUCTURE(SDevice, id, name, inputs, rule, gnode, power);
+
+    // Same catalog device, whatever the position and bindings
+    bool SameDefinition(const SDevice& other_) const
+    {
+        if (id != other_.id || name != other_.name || rule != other_.rule || power != other_.power || inputs.size() != other_.inputs.size())
+            return false;
+
+        for (size_t i = 0; i < inputs.size(); ++i)
+            if (inputs[i].name != other_.inputs[i].name)
+                return false;
+
+        return true;
+    }
+
+    bool SameBindings(const SDevice& other_) const
+    {
+        if (inputs.size() != other_.inputs.size())
+            return false;
+
+        for (size_t i = 0; i < inputs.size(); ++i)
+            if (inputs[i].connect != other_.inputs[i].connect)
+                return false;
+
+        return true;
+    }
+
+    void Reset() {
+        id      .clear();
+        name    .clear();
+        inputs  .clear();
+        rule    .clear();
+        gnode.x = 0;
+        gnode.y = 0;
+        power = 0.0;
+        capacity = 0.0;
+    }
+
+    std::string Print_description() const
+    {
+        std::string descr;
+        descr += "Device name: " + name + "\n";
+        descr += "Device I/O \n";
+        descr += "//============ \n";
+
+        for (const auto& itInput : inputs)
+            descr += itInput.name + "\n";
+
+        descr += "//============ \n";
+
+        return descr;
+    }
+
+    std::string Storage_description() const
+    {
+        std::string descr;
+
+        descr += "id:"      + id    + "\n";
+        descr += "name:"    + name  + "\n";
+
+        for (const auto& itInput : inputs)
+            descr += "input:" + itInput.name + "\n";
+
+        descr += "pwr:"     + std::to_string(power) + "\n";
+
+        if (capacity > 0.0)
+            descr += "cap:" + std::to_string(capacity) + "\n";
+        descr += "rule:"    + rule;
+
+        return descr;
+    }
+
+    static std::optional<std::string> IdParam(const std::string& str_)
+    {
+        TPair pr = Split(str_, ":");
+
+        return pr.first == "id" ? std::optional<std::string>(pr.second) : std::optional<std::string>();
+    }
+
+    void Parse_param(const std::string& str_)
+    {
+        TPair pair = Split(str_, ":");
+
+        if      (pair.first == "id")
+        {
+            id = pair.second;
+        }
+        else if (pair.first == "name")
+        {
+            name = pair.second;
+        }
+        else if (pair.first == "input")
+        {
+            inputs.push_back(SInput(to_lower(pair.second)));
+        }
+        else if (pair.first == "rule")
+        {
+            rule = to_lower(pair.second);
+        }
+        else if (pair.first == "pwr")
+        {
+            power = std::stod(pair.second);
+        }
+        else if (pair.first == "cap")
+        {
+            capacity = std::stod(pair.second);
+        }
+    }
+
+    // Two-port passive devices (cables, adapters) carry a port type through
+    bool IsCable() const
+    {
+        return inputs.size() == 2 && power == 0.0;
+    }
+
+    bool Validate(const TPortList& ports_)
+    {
+        if (inputs.size() >= 26)
+            return false;
+
+        for (const auto& it : inputs)
+        {
+            if (!ports_.count(Split(it.name, ":").second))
+            return false;
+        }
+        return true;
+    }
+};
+
+typedef std::map<TDevId     , SDevice   >  TDevList;
+typedef std::map<TNodeId    , SDevice   >  TNodeList;
+typedef std::map<TCategory  , TDevList  >  TCategoryList;
+
+//----------------------------------------------------------------------
+struct SLink
+{
+    std::array<TNodeId, 2> nodes;
+
+    NOP_STRUCTURE(SLink, nodes);
+};
+
+typedef std::map<TLinkId, SLink> TLinkList;
+
+//----------------------------------------------------------------------
+inline void Bind(TNodeList& nodes_, TLinkList& links_, const TLinkId& link_id_,
+                 const TNodeId& lnode_, int linput_, const TNodeId& rnode_, int rinput_)
+{
+    SInput& linput = nodes_[lnode_].inputs[linput_];
+    SInput& rinput = nodes_[rnode_].inputs[rinput_];
+
+    linput.connect.node  = rnode_;
+    linput.connect.input = rinput_;
+    linput.connect.link  = link_id_;
+
+    rinput.connect.node  = lnode_;
+    rinput.connect.input = linput_;
+    rinput.connect.link  = link_id_;
+
+    SLink& link = links_[link_id_];
+    link.nodes[0] = lnode_;
+    link.nodes[1] = rnode_;
+}
+
+#endif // SCHEME_H
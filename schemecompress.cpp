@@ -0,0 +1,453 @@
+#include "schemecompress.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <queue>
+#include <utility>
+
+#include "scheme.h"
+
+//----------------------------------------------------------------------
+static const char compressed_magic[4] = { 'S', 'V', 'S', 'Z' };
+
+//----------------------------------------------------------------------
+bool IsCompressedScheme(const std::string& file_name_)
+{
+    const int fd = ::open(file_name_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    char magic[sizeof(compressed_magic)] = {};
+    const bool compressed = ::read(fd, magic, sizeof(magic)) == (ssize_t)sizeof(magic) && !memcmp(magic, compressed_magic, sizeof(magic));
+
+    ::close(fd);
+
+    return compressed;
+}
+
+//----------------------------------------------------------------------
+std::string LoadSchemeDictionary(const std::string& file_name_)
+{
+    std::ifstream file(file_name_, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+//----------------------------------------------------------------------
+bool SaveSchemeDictionary(const std::string& file_name_, const std::string& dictionary_)
+{
+    std::ofstream file(file_name_, std::ios::binary | std::ios::trunc);
+    file.write(dictionary_.data(), dictionary_.size());
+    return (bool)file;
+}
+
+//----------------------------------------------------------------------
+// Greedy selection of fixed size segments by the summed frequency of the
+// k-mers they contain. A k-mer only counts for the first segment that
+// takes it, so the dictionary does not fill up with one repeated string.
+std::string TrainSchemeDictionary(const std::vector<std::string>& samples_, std::size_t size_)
+{
+    const std::size_t kmer      = 8;
+    const std::size_t segment   = 64;
+    const int         hash_bits = 22;
+
+    auto hash = [](const char* pData_) {
+        uint64_t value;
+        memcpy(&value, pData_, sizeof(value));
+        return (uint32_t)((value * 0x9E3779B97F4A7C15ull) >> (64 - hash_bits));
+    };
+
+    std::vector<uint32_t> counts(std::size_t(1) << hash_bits);
+
+    for (const auto& it : samples_)
+        for (std::size_t i = 0; i + kmer <= it.size(); ++i)
+            ++counts[hash(&it[i])];
+
+    auto score = [&](const char* pData_) {
+        uint64_t result = 0;
+        for (std::size_t i = 0; i + kmer <= segment; ++i)
+        {
+            const uint32_t count = counts[hash(pData_ + i)];
+            result += count > 1 ? count : 0;
+        }
+        return result;
+    };
+
+    typedef std::pair<uint64_t, const char*> TCandidate;
+    std::priority_queue<TCandidate> candidates;
+
+    for (const auto& it : samples_)
+        for (std::size_t i = 0; i + segment <= it.size(); i += segment / 2)
+            candidates.emplace(score(&it[i]), &it[i]);
+
+    std::vector<const char*> chosen;
+
+    while (chosen.size() * segment < size_ && !candidates.empty())
+    {
+        TCandidate top = candidates.top();
+        candidates.pop();
+
+        // Scores only drop as k-mers are taken, so a candidate still at
+        // least as good as the next one is the best
+        const uint64_t current = score(top.second);
+        if (current == 0)
+            continue;
+
+        if (!candidates.empty() && current < candidates.top().first)
+        {
+            candidates.emplace(current, top.second);
+            continue;
+        }
+
+        chosen.push_back(top.second);
+
+        for (std::size_t i = 0; i + kmer <= segment; ++i)
+            counts[hash(top.second + i)] = 0;
+    }
+
+    std::string result;
+    result.reserve(chosen.size() * segment);
+
+    for (auto it = chosen.rbegin(); it != chosen.rend(); ++it)
+        result.append(*it, segment);
+
+    return result.size() > size_ ? result.substr(result.size() - size_) : result;
+}
+
+//----------------------------------------------------------------------
+DeflateFdWriter::DeflateFdWriter(int fd_, int level_, const std::string& dictionary_) :
+    m_file      (fd_                ),
+    m_block     (block_size         ),
+    m_pending   (block_size         ),
+    m_output    (block_size         )
+{
+    if (deflateInit(&m_stream, level_) != Z_OK)
+    {
+        m_status = nop::ErrorStatus::SystemError;
+        m_finished = true;
+        return;
+    }
+
+    if (!dictionary_.empty() && deflateSetDictionary(&m_stream, (const Bytef*)dictionary_.data(), (uInt)dictionary_.size()) != Z_OK)
+        m_status = nop::ErrorStatus::SystemError;
+    else
+        m_status = m_file.Write(compressed_magic, compressed_magic + sizeof(compressed_magic));
+}
+
+//----------------------------------------------------------------------
+DeflateFdWriter::~DeflateFdWriter()
+{
+    Finish();
+    deflateEnd(&m_stream);
+}
+
+//----------------------------------------------------------------------
+nop::Status<void> DeflateFdWriter::Write(const void* pBegin_, const void* pEnd_)
+{
+    const uint8_t* pByte = static_cast<const uint8_t*>(pBegin_);
+    const uint8_t* pEnd  = static_cast<const uint8_t*>(pEnd_);
+
+    while (pByte < pEnd)
+    {
+        if (m_size == m_block.size())
+        {
+            auto status = submit();
+            if (!status)
+                return status;
+        }
+
+        const std::size_t count = std::min<std::size_t>(pEnd - pByte, m_block.size() - m_size);
+        memcpy(&m_block[m_size], pByte, count);
+        m_size += count;
+        pByte  += count;
+    }
+
+    return {};
+}
+
+//----------------------------------------------------------------------
+nop::Status<void> DeflateFdWriter::Skip(std::size_t padding_, std::uint8_t value_)
+{
+    while (padding_)
+    {
+        if (m_size == m_block.size())
+        {
+            auto status = submit();
+            if (!status)
+                return status;
+        }
+
+        const std::size_t count = std::min(padding_, m_block.size() - m_size);
+        memset(&m_block[m_size], value_, count);
+        m_size   += count;
+        padding_ -= count;
+    }
+
+    return {};
+}
+
+//----------------------------------------------------------------------
+nop::Status<void> DeflateFdWriter::Finish()
+{
+    if (m_finished)
+        return m_status;
+
+    m_finished = true;
+
+    auto status = wait();
+    if (status)
+    {
+        std::swap(m_block, m_pending);
+        status = deflate_block(std::exchange(m_size, 0), Z_FINISH);
+    }
+
+    if (!status)
+        m_status = status;
+
+    return m_status;
+}
+
+//----------------------------------------------------------------------
+nop::Status<void> DeflateFdWriter::submit()
+{
+    auto status = wait();
+    if (!status)
+        return status;
+
+    std::swap(m_block, m_pending);
+
+    m_worker = std::async(std::launch::async, [this, size = std::exchange(m_size, 0)]() {
+        return deflate_block(size, Z_NO_FLUSH);
+    });
+
+    return {};
+}
+
+//----------------------------------------------------------------------
+nop::Status<void> DeflateFdWriter::wait()
+{
+    if (m_worker.valid())
+    {
+        auto status = m_worker.get();
+        if (!status)
+            m_status = status;
+    }
+
+    return m_status;
+}
+
+//----------------------------------------------------------------------
+nop::Status<void> DeflateFdWriter::deflate_block(std::size_t size_, int flush_)
+{
+    m_stream.next_in    = m_pending.data();
+    m_stream.avail_in   = (uInt)size_;
+
+    int ret = Z_OK;
+
+    do
+    {
+        m_stream.next_out   = m_output.data();
+        m_stream.avail_out  = (uInt)m_output.size();
+
+        ret = deflate(&m_stream, flush_);
+        if (ret == Z_STREAM_ERROR)
+            return nop::ErrorStatus::StreamError;
+
+        auto status = m_file.Write(m_output.data(), m_stream.next_out);
+        if (!status)
+            return status;
+    }
+    while (m_stream.avail_out == 0);
+
+    if (flush_ == Z_FINISH && ret != Z_STREAM_END)
+        return nop::ErrorStatus::StreamError;
+
+    return {};
+}
+
+//----------------------------------------------------------------------
+InflateFdReader::InflateFdReader(int fd_, const std::string* pDictionary_) :
+    m_fd            (fd_                ),
+    m_pDictionary   (pDictionary_       ),
+    m_input         (block_size         ),
+    m_block         (block_size         ),
+    m_ahead         (block_size         )
+{
+    char magic[sizeof(compressed_magic)] = {};
+
+    if (::read(m_fd, magic, sizeof(magic)) != (ssize_t)sizeof(magic) || memcmp(magic, compressed_magic, sizeof(magic)))
+    {
+        m_status = nop::ErrorStatus::UnexpectedEncodingType;
+        m_end_of_stream = true;
+        return;
+    }
+
+    if (inflateInit(&m_stream) != Z_OK)
+    {
+        m_status = nop::ErrorStatus::SystemError;
+        m_end_of_stream = true;
+        return;
+    }
+
+    auto result = inflate_block(m_block);
+    if (!result)
+    {
+        m_status = result.error();
+        m_end_of_stream = true;
+        return;
+    }
+
+    m_end = result.get();
+
+    if (!m_end_of_stream)
+        m_worker = std::async(std::launch::async, [this]() { return inflate_block(m_ahead); });
+}
+
+//----------------------------------------------------------------------
+InflateFdReader::~InflateFdReader()
+{
+    if (m_worker.valid())
+        m_worker.wait();
+
+    inflateEnd(&m_stream);
+
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+//----------------------------------------------------------------------
+nop::Status<void> InflateFdReader::Read(void* pBegin_, void* pEnd_)
+{
+    uint8_t* pByte = static_cast<uint8_t*>(pBegin_);
+    uint8_t* pEnd  = static_cast<uint8_t*>(pEnd_);
+
+    while (pByte < pEnd)
+    {
+        if (m_begin == m_end)
+        {
+            auto status = next();
+            if (!status)
+                return status;
+
+            continue;
+        }
+
+        const std::size_t count = std::min<std::size_t>(pEnd - pByte, m_end - m_begin);
+        memcpy(pByte, &m_block[m_begin], count);
+        m_begin += count;
+        pByte   += count;
+    }
+
+    return {};
+}
+
+//----------------------------------------------------------------------
+nop::Status<void> InflateFdReader::Skip(std::size_t padding_)
+{
+    while (padding_)
+    {
+        if (m_begin == m_end)
+        {
+            auto status = next();
+            if (!status)
+                return status;
+
+            continue;
+        }
+
+        const std::size_t count = std::min(padding_, m_end - m_begin);
+        m_begin  += count;
+        padding_ -= count;
+    }
+
+    return {};
+}
+
+//----------------------------------------------------------------------
+bool InflateFdReader::Peek(void* pBegin_, void* pEnd_) const
+{
+    const std::size_t size = static_cast<uint8_t*>(pEnd_) - static_cast<uint8_t*>(pBegin_);
+    if (!m_status || m_end - m_begin < size)
+        return false;
+
+    memcpy(pBegin_, &m_block[m_begin], size);
+    return true;
+}
+
+//----------------------------------------------------------------------
+nop::Status<void> InflateFdReader::next()
+{
+    if (!m_status)
+        return m_status;
+
+    if (!m_worker.valid())
+        return nop::ErrorStatus::ReadLimitReached;
+
+    auto result = m_worker.get();
+    if (!result)
+    {
+        m_status = result.error();
+        return m_status;
+    }
+
+    std::swap(m_block, m_ahead);
+    m_begin = 0;
+    m_end   = result.get();
+
+    if (!m_end_of_stream)
+        m_worker = std::async(std::launch::async, [this]() { return inflate_block(m_ahead); });
+
+    return {};
+}
+
+//----------------------------------------------------------------------
+nop::Status<std::size_t> InflateFdReader::inflate_block(std::vector<std::uint8_t>& block_)
+{
+    m_stream.next_out   = block_.data();
+    m_stream.avail_out  = (uInt)block_.size();
+
+    while (m_stream.avail_out)
+    {
+        if (m_stream.avail_in == 0)
+        {
+            const ssize_t ret = ::read(m_fd, m_input.data(), m_input.size());
+            if (ret < 0 && errno == EINTR)
+                continue;
+            if (ret < 0)
+                return nop::ErrorStatus::IOError;
+            if (ret == 0)
+                return nop::ErrorStatus::ReadLimitReached;
+
+            m_stream.next_in    = m_input.data();
+            m_stream.avail_in   = (uInt)ret;
+        }
+
+        const int ret = inflate(&m_stream, Z_NO_FLUSH);
+
+        if (ret == Z_NEED_DICT)
+        {
+            if (!m_pDictionary || inflateSetDictionary(&m_stream, (const Bytef*)m_pDictionary->data(), (uInt)m_pDictionary->size()) != Z_OK)
+            {
+                Log("The scheme was compressed with a dictionary that is not available");
+                return nop::ErrorStatus::ProtocolError;
+            }
+
+            continue;
+        }
+
+        if (ret == Z_STREAM_END)
+        {
+            m_end_of_stream = true;
+            break;
+        }
+
+        if (ret != Z_OK)
+            return nop::ErrorStatus::StreamError;
+    }
+
+    return block_.size() - m_stream.avail_out;
+}
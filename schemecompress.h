@@ -0,0 +1,147 @@
+#ifndef SCHEMECOMPRESS_H
+#define SCHEMECOMPRESS_H
+
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "nop/status.h"
+#include "nop/utility/fd_writer.h"
+
+//----------------------------------------------------------------------
+// Deflate compression of scheme files.
+//
+// A compressed file is a magic followed by one zlib stream holding the
+// uncompressed file, legacy or compact. The writer and the reader are
+// libnop Writer/Reader types the serializers drive directly: a block is
+// deflated on a worker while the next one is serialized, and the next
+// block is inflated while the current one is decoded.
+//
+// Both ends may share a preset dictionary, see TrainSchemeDictionary().
+// zlib records its Adler-32 in the stream, so a file is never decoded
+// with the wrong one.
+
+bool IsCompressedScheme(const std::string& file_name_);
+
+// Dictionary file next to the catalog, empty if there is none
+std::string LoadSchemeDictionary(const std::string& file_name_);
+bool SaveSchemeDictionary(const std::string& file_name_, const std::string& dictionary_);
+
+// Picks the most repeated segments of uncompressed sample files,
+// the most valuable ones last where deflate reaches them cheapest
+std::string TrainSchemeDictionary(const std::vector<std::string>& samples_, std::size_t size_ = 32 * 1024);
+
+//----------------------------------------------------------------------
+class DeflateFdWriter
+{
+public:
+    static constexpr std::size_t block_size = 256 * 1024;
+
+    // Takes ownership of the descriptor and writes the magic
+    DeflateFdWriter(int fd_, int level_ = Z_BEST_SPEED, const std::string& dictionary_ = std::string());
+    ~DeflateFdWriter();
+
+    DeflateFdWriter(const DeflateFdWriter&) = delete;
+    DeflateFdWriter& operator=(const DeflateFdWriter&) = delete;
+
+    nop::Status<void> Prepare(std::size_t) { return m_status; }
+
+    nop::Status<void> Write(std::uint8_t byte_)
+    {
+        if (m_size == m_block.size())
+        {
+            auto status = submit();
+            if (!status)
+                return status;
+        }
+
+        m_block[m_size++] = byte_;
+        return {};
+    }
+
+    nop::Status<void> Write(const void* pBegin_, const void* pEnd_);
+    nop::Status<void> Skip(std::size_t padding_, std::uint8_t value_ = 0x00);
+
+    // Deflates the rest and ends the stream. The destructor does it too,
+    // but loses the errors.
+    nop::Status<void> Finish();
+
+private:
+    // Hands the filled block to the worker once it is done with the
+    // previous one
+    nop::Status<void> submit();
+    nop::Status<void> deflate_block(std::size_t size_, int flush_);
+    nop::Status<void> wait();
+
+    nop::FdWriter                   m_file;
+    z_stream                        m_stream    {};
+    nop::Status<void>               m_status;
+    bool                            m_finished  {};
+
+    std::vector<std::uint8_t>       m_block;        // Filled by the serializer
+    std::size_t                     m_size      {};
+    std::vector<std::uint8_t>       m_pending;      // Deflated by the worker
+    std::vector<std::uint8_t>       m_output;
+    std::future<nop::Status<void>>  m_worker;
+};
+
+//----------------------------------------------------------------------
+class InflateFdReader
+{
+public:
+    static constexpr std::size_t block_size = 256 * 1024;
+
+    // Takes ownership of the descriptor, checks the magic and inflates
+    // the first block. pDictionary_ must outlive the reader.
+    InflateFdReader(int fd_, const std::string* pDictionary_ = nullptr);
+    ~InflateFdReader();
+
+    InflateFdReader(const InflateFdReader&) = delete;
+    InflateFdReader& operator=(const InflateFdReader&) = delete;
+
+    // Truncated streams are reported by the reads
+    nop::Status<void> Ensure(std::size_t) { return m_status; }
+
+    nop::Status<void> Read(std::uint8_t* pByte_)
+    {
+        while (m_begin == m_end)
+        {
+            auto status = next();
+            if (!status)
+                return status;
+        }
+
+        *pByte_ = m_block[m_begin++];
+        return {};
+    }
+
+    nop::Status<void> Read(void* pBegin_, void* pEnd_);
+    nop::Status<void> Skip(std::size_t padding_);
+
+    // Copies the next bytes without consuming them, as far as they are
+    // inflated already. Meant for magics at the start of the stream.
+    bool Peek(void* pBegin_, void* pEnd_) const;
+
+private:
+    // Switches to the block inflated ahead and starts on the next one
+    nop::Status<void> next();
+    nop::Status<std::size_t> inflate_block(std::vector<std::uint8_t>& block_);
+
+    int                                     m_fd        { -1 };
+    const std::string*                      m_pDictionary;
+    z_stream                                m_stream    {};
+    nop::Status<void>                       m_status;
+    bool                                    m_end_of_stream {};
+
+    std::vector<std::uint8_t>               m_input;
+    std::vector<std::uint8_t>               m_block;    // Decoded by the deserializer
+    std::size_t                             m_begin     {};
+    std::size_t                             m_end       {};
+    std::vector<std::uint8_t>               m_ahead;    // Inflated by the worker
+    std::future<nop::Status<std::size_t>>   m_worker;
+};
+
+#endif // SCHEMECOMPRESS_H
@@ -0,0 +1,314 @@
+#include "schemediff.h"
+
+#include <functional>
+#include <unordered_map>
+
+#include "profiler.h"
+
+//----------------------------------------------------------------------
+// Calls visit_(id, pBefore, pAfter) for every id of either list in id
+// order, with nullptr on the side that does not have it
+template <class TList, class TVisit>
+static void walk(const TList& before_, const TList& after_, TVisit visit_)
+{
+    auto itBefore = before_.begin();
+    auto itAfter  = after_.begin();
+
+    while (itBefore != before_.end() || itAfter != after_.end())
+    {
+        if (itAfter == after_.end() || (itBefore != before_.end() && itBefore->first < itAfter->first))
+        {
+            visit_(itBefore->first, &itBefore->second, nullptr);
+            ++itBefore;
+        }
+        else if (itBefore == before_.end() || itAfter->first < itBefore->first)
+        {
+            visit_(itAfter->first, nullptr, &itAfter->second);
+            ++itAfter;
+        }
+        else
+        {
+            visit_(itBefore->first, &itBefore->second, &itAfter->second);
+            ++itBefore;
+            ++itAfter;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// The same over three lists
+template <class TList, class TVisit>
+static void walk(const TList& base_, const TList& ours_, const TList& theirs_, TVisit visit_)
+{
+    auto itBase     = base_  .begin();
+    auto itOurs     = ours_  .begin();
+    auto itTheirs   = theirs_.begin();
+
+    while (itBase != base_.end() || itOurs != ours_.end() || itTheirs != theirs_.end())
+    {
+        // Points into one of the lists, which outlive the visit
+        const typename TList::key_type* pId = nullptr;
+
+        if (itBase   != base_  .end() && (!pId || itBase  ->first < *pId)) pId = &itBase  ->first;
+        if (itOurs   != ours_  .end() && (!pId || itOurs  ->first < *pId)) pId = &itOurs  ->first;
+        if (itTheirs != theirs_.end() && (!pId || itTheirs->first < *pId)) pId = &itTheirs->first;
+
+        const auto* pBase   = itBase   != base_  .end() && itBase  ->first == *pId ? &(itBase++)  ->second : nullptr;
+        const auto* pOurs   = itOurs   != ours_  .end() && itOurs  ->first == *pId ? &(itOurs++)  ->second : nullptr;
+        const auto* pTheirs = itTheirs != theirs_.end() && itTheirs->first == *pId ? &(itTheirs++)->second : nullptr;
+
+        visit_(*pId, pBase, pOurs, pTheirs);
+    }
+}
+
+//----------------------------------------------------------------------
+template <class T>
+static std::optional<T> state(const T* pValue_)
+{
+    return pValue_ ? std::optional<T>(*pValue_) : std::optional<T>();
+}
+
+//----------------------------------------------------------------------
+static bool same_node(const SDevice& l_, const SDevice& r_)
+{
+    return l_.SameDefinition(r_) && l_.gnode == r_.gnode && l_.SameBindings(r_);
+}
+
+//----------------------------------------------------------------------
+static bool same_link(const SLink& l_, const SLink& r_)
+{
+    return l_.nodes == r_.nodes;
+}
+
+//----------------------------------------------------------------------
+SDelta DiffSchemes(const TNodeList& before_nodes_, const TLinkList& before_links_,
+                   const TNodeList& after_nodes_,  const TLinkList& after_links_)
+{
+    PROFILE_SCOPE("diff_schemes");
+
+    SDelta delta;
+
+    walk(before_nodes_, after_nodes_, [&](const TNodeId& id_, const SDevice* pBefore_, const SDevice* pAfter_) {
+        if (!pBefore_ || !pAfter_ || !same_node(*pBefore_, *pAfter_))
+            delta.nodes.push_back( { id_, state(pBefore_), state(pAfter_) } );
+    });
+
+    walk(before_links_, after_links_, [&](const TLinkId& id_, const SLink* pBefore_, const SLink* pAfter_) {
+        if (!pBefore_ || !pAfter_ || !same_link(*pBefore_, *pAfter_))
+            delta.links.push_back( { id_, state(pBefore_), state(pAfter_) } );
+    });
+
+    return delta;
+}
+
+//----------------------------------------------------------------------
+int NodeChanges(const SDelta::SNodeState& state_)
+{
+    if (!state_.before.has_value())
+        return eNodeAdded;
+
+    if (!state_.after.has_value())
+        return eNodeRemoved;
+
+    const SDevice& before = state_.before.value();
+    const SDevice& after  = state_.after .value();
+
+    int result = 0;
+
+    if (!before.SameDefinition(after))
+        result |= eNodeDevice;
+
+    if (before.gnode != after.gnode)
+        result |= eNodeMoved;
+
+    if (!before.SameBindings(after))
+        result |= eNodeBindings;
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+// Three-way choice: the side that changed the value wins, ours when both
+// changed it differently
+template <class T, class TSame>
+static const T& pick(const T& base_, const T& ours_, const T& theirs_, TSame same_, bool& conflict_)
+{
+    conflict_ = false;
+
+    if (same_(ours_, theirs_) || same_(base_, theirs_))
+        return ours_;
+
+    if (same_(base_, ours_))
+        return theirs_;
+
+    conflict_ = true;
+    return ours_;
+}
+
+//----------------------------------------------------------------------
+static SDevice merge_node(const TNodeId& id_, const SDevice& base_, const SDevice& ours_, const SDevice& theirs_, std::vector<SMergeConflict>& conflicts_)
+{
+    bool conflict = false;
+
+    // The definition brings its inputs along, bound as on its side
+    SDevice result = pick(base_, ours_, theirs_, [](const SDevice& l_, const SDevice& r_) { return l_.SameDefinition(r_); }, conflict);
+    if (conflict)
+        conflicts_.push_back( { SMergeConflict::eDevice, id_ } );
+
+    result.gnode = pick(base_.gnode, ours_.gnode, theirs_.gnode, std::equal_to<SGraphNode>(), conflict);
+    if (conflict)
+        conflicts_.push_back( { SMergeConflict::ePosition, id_ } );
+
+    // Inputs line up only while no side changed their number
+    if (base_.inputs.size() != ours_.inputs.size() || ours_.inputs.size() != theirs_.inputs.size())
+        return result;
+
+    for (size_t i = 0; i < result.inputs.size(); ++i)
+    {
+        const SConnect& ours    = ours_  .inputs[i].connect;
+        const SConnect& theirs  = theirs_.inputs[i].connect;
+
+        result.inputs[i].connect = pick(base_.inputs[i].connect, ours, theirs, std::equal_to<SConnect>(), conflict);
+        if (conflict)
+            conflicts_.push_back( { SMergeConflict::eBinding, id_, (int)i, ours, theirs } );
+    }
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+// Presence of an entity: added on one side is kept, removed on one side
+// is dropped unless the other side changed it. Ours wins conflicts.
+template <class T, class TSame>
+static const T* merge_presence(const T* pBase_, const T* pOurs_, const T* pTheirs_, TSame same_, bool& conflict_)
+{
+    conflict_ = false;
+
+    if (pOurs_ && pTheirs_)
+    {
+        conflict_ = !pBase_ && !same_(*pOurs_, *pTheirs_);
+        return pOurs_;
+    }
+
+    const T* pKept = pOurs_ ? pOurs_ : pTheirs_;
+    if (!pKept || !pBase_)
+        return pKept;
+
+    // Removed on the other side
+    conflict_ = !same_(*pBase_, *pKept);
+
+    return conflict_ && pOurs_ ? pOurs_ : nullptr;
+}
+
+//----------------------------------------------------------------------
+// Links survive only while both their ends are bound to them and to each
+// other. Conflicting resolutions may break that, e.g. a link added on
+// their side to an input that keeps our binding.
+static void drop_dangling(SMergeResult& result_)
+{
+    struct SRef
+    {
+        const TNodeId*  pNode;
+        SDevice*        pDev;
+        int             input;
+    };
+
+    std::unordered_map<TLinkId, std::vector<SRef>> refs;
+
+    for (auto& it : result_.nodes)
+        for (size_t i = 0; i < it.second.inputs.size(); ++i)
+            if (!it.second.inputs[i].connect.link.empty())
+                refs[it.second.inputs[i].connect.link].push_back( { &it.first, &it.second, (int)i } );
+
+    auto bound = [](const SRef& ref_, const SRef& other_) {
+        const SConnect& connect = ref_.pDev->inputs[ref_.input].connect;
+        return connect.node == *other_.pNode && connect.input == other_.input;
+    };
+
+    auto release = [&](const TLinkId& id_) {
+        auto itRefs = refs.find(id_);
+        if (itRefs == refs.end())
+            return;
+
+        for (const auto& it : itRefs->second)
+            it.pDev->inputs[it.input].connect.Reset();
+
+        refs.erase(itRefs);
+    };
+
+    for (auto it = result_.links.begin(); it != result_.links.end(); )
+    {
+        auto itRefs = refs.find(it->first);
+
+        bool valid = itRefs != refs.end() && itRefs->second.size() == 2;
+        if (valid)
+        {
+            const SRef& l = itRefs->second[0];
+            const SRef& r = itRefs->second[1];
+            const auto& ends = it->second.nodes;
+
+            valid = bound(l, r) && bound(r, l) && ((ends[0] == *l.pNode && ends[1] == *r.pNode) || (ends[0] == *r.pNode && ends[1] == *l.pNode));
+        }
+
+        if (valid)
+        {
+            refs.erase(itRefs);
+            ++it;
+            continue;
+        }
+
+        result_.conflicts.push_back( { SMergeConflict::eDangling, it->first } );
+        release(it->first);
+        it = result_.links.erase(it);
+    }
+
+    // What is left are bindings to links that did not survive the merge
+    while (!refs.empty())
+    {
+        result_.conflicts.push_back( { SMergeConflict::eDangling, refs.begin()->first } );
+        release(refs.begin()->first);
+    }
+}
+
+//----------------------------------------------------------------------
+SMergeResult MergeSchemes(const TNodeList& base_nodes_,   const TLinkList& base_links_,
+                          const TNodeList& our_nodes_,    const TLinkList& our_links_,
+                          const TNodeList& their_nodes_,  const TLinkList& their_links_)
+{
+    PROFILE_SCOPE("merge_schemes");
+
+    SMergeResult result;
+
+    walk(base_nodes_, our_nodes_, their_nodes_, [&](const TNodeId& id_, const SDevice* pBase_, const SDevice* pOurs_, const SDevice* pTheirs_) {
+        if (pBase_ && pOurs_ && pTheirs_)
+        {
+            result.nodes.emplace_hint(result.nodes.end(), id_, merge_node(id_, *pBase_, *pOurs_, *pTheirs_, result.conflicts));
+            return;
+        }
+
+        bool conflict = false;
+
+        const SDevice* pKept = merge_presence(pBase_, pOurs_, pTheirs_, same_node, conflict);
+        if (conflict)
+            result.conflicts.push_back( { SMergeConflict::eNode, id_ } );
+
+        if (pKept)
+            result.nodes.emplace_hint(result.nodes.end(), id_, *pKept);
+    });
+
+    walk(base_links_, our_links_, their_links_, [&](const TLinkId& id_, const SLink* pBase_, const SLink* pOurs_, const SLink* pTheirs_) {
+        bool conflict = false;
+
+        const SLink* pKept = pBase_ && pOurs_ && pTheirs_ ? &pick(*pBase_, *pOurs_, *pTheirs_, same_link, conflict)
+                                                          : merge_presence(pBase_, pOurs_, pTheirs_, same_link, conflict);
+        if (conflict)
+            result.conflicts.push_back( { SMergeConflict::eLink, id_ } );
+
+        if (pKept)
+            result.links.emplace_hint(result.links.end(), id_, *pKept);
+    });
+
+    drop_dangling(result);
+
+    return result;
+}
@@ -0,0 +1,64 @@
+#ifndef SCHEMEDIFF_H
+#define SCHEMEDIFF_H
+
+#include "undo.h"
+
+//----------------------------------------------------------------------
+// Differences between versions of a scheme and their three-way merge.
+//
+// Nodes and links are keyed by UUID in sorted maps, so versions are
+// compared by walking their lists side by side in one pass, O(n) on top
+// of the O(n log n) the maps were built with.
+
+//----------------------------------------------------------------------
+enum ENodeChange
+{
+    eNodeAdded      = 1 << 0,
+    eNodeRemoved    = 1 << 1,
+    eNodeDevice     = 1 << 2,   // Device definition
+    eNodeMoved      = 1 << 3,
+    eNodeBindings   = 1 << 4,
+};
+
+// Nodes and links that differ, with their states in both versions, in id
+// order. Applied forwards it turns the before scheme into the after one.
+SDelta DiffSchemes(const TNodeList& before_nodes_, const TLinkList& before_links_,
+                   const TNodeList& after_nodes_,  const TLinkList& after_links_);
+
+// ENodeChange flags of a node in a diff
+int NodeChanges(const SDelta::SNodeState& state_);
+
+//----------------------------------------------------------------------
+struct SMergeConflict
+{
+    enum EKind
+    {
+        eNode,      // Removed on one side, changed on the other, or added twice
+        eDevice,    // Definition changed on both sides
+        ePosition,  // Moved on both sides
+        eBinding,   // Same input bound differently on both sides
+        eLink,      // Link removed on one side, changed on the other
+        eDangling,  // Link or binding dropped because its other end was lost
+    };
+
+    EKind       kind;
+    std::string id;                 // Node, or link for eLink and eDangling
+    int         input   { -1 };     // eBinding: index in SDevice::inputs
+    SConnect    ours    {};         // eBinding: both bindings of the input
+    SConnect    theirs  {};
+};
+
+//----------------------------------------------------------------------
+// Merged scheme. Conflicts are resolved in favour of ours and listed.
+struct SMergeResult
+{
+    TNodeList                   nodes;
+    TLinkList                   links;
+    std::vector<SMergeConflict> conflicts;
+};
+
+SMergeResult MergeSchemes(const TNodeList& base_nodes_,   const TLinkList& base_links_,
+                          const TNodeList& our_nodes_,    const TLinkList& our_links_,
+                          const TNodeList& their_nodes_,  const TLinkList& their_links_);
+
+#endif // SCHEMEDIFF_H
@@ -0,0 +1,545 @@
+#include "schemeio.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+#include "nop/utility/buffer_writer.h"
+#include "nop/utility/fd_reader.h"
+#include "nop/utility/fd_writer.h"
+
+#include "schemecompress.h"
+#include "profiler.h"
+
+//----------------------------------------------------------------------
+// Compact format: magic, SCompactHeader, then one SCompactNode record
+// per node. Nodes refer to their device by its index in the header
+// device table or by dictionary index. Bindings are only stored with the
+// links, as the node index and input of both ends. The reader sorts them
+// by node first and completes every node as its record comes in, the
+// nodes of the links are then copied from the node ids just created.
+static const char       compact_magic[4]    = { 'S', 'V', 'S', 'C' };
+static const uint32_t   compact_version     = 2;
+
+// Strings packed back to back, e.g. all node ids
+struct SCompactTable
+{
+    std::string             data;
+    std::vector<uint32_t>   ends;   // End offset of every string in data
+
+    size_t size() const { return ends.size(); }
+
+    std::string_view operator[](size_t ind_) const
+    {
+        const uint32_t begin = ind_ ? ends[ind_ - 1] : 0;
+        return std::string_view(data).substr(begin, ends[ind_] - begin);
+    }
+
+    void push_back(const std::string& str_)
+    {
+        data += str_;
+        ends.push_back((uint32_t)data.size());
+    }
+
+    NOP_STRUCTURE(SCompactTable, data, ends);
+};
+
+struct SCompactEnd
+{
+    uint32_t node   {};         // Index in SCompactHeader::nodes
+    int32_t  input  { -1 };     // Bound input of the node, -1 if none is
+
+    NOP_STRUCTURE(SCompactEnd, node, input);
+};
+
+struct SCompactHeader
+{
+    uint32_t                                version     { compact_version };
+    SCompactTable                           devices;        // Device ids of the nodes, each once
+    std::vector<SDevice>                    dictionary;     // Definitions without bindings
+    SCompactTable                           nodes;          // Node ids in id order
+    SCompactTable                           links;          // Link ids in id order
+    std::vector<std::array<SCompactEnd, 2>> link_ends;      // Both ends of every link
+
+    NOP_STRUCTURE(SCompactHeader, version, devices, dictionary, nodes, links, link_ends);
+};
+
+struct SCompactNode
+{
+    uint32_t                    dev {};         // Index in SCompactHeader::devices
+    int32_t                     def { -1 };     // Index in the dictionary, -1 for the catalog device
+    SGraphNode                  gnode;
+
+    NOP_STRUCTURE(SCompactNode, dev, def, gnode);
+};
+
+typedef std::unordered_map<TDevId, const SDevice*> TCatalogIndex;
+
+//----------------------------------------------------------------------
+static TCatalogIndex index_catalog(const TCategoryList* pCatalog_)
+{
+    TCatalogIndex result;
+
+    if (pCatalog_)
+        for (const auto& itCategory : *pCatalog_)
+            for (const auto& itDev : itCategory.second)
+                result.emplace(itDev.first, &itDev.second);
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+template <class TDeserializer>
+static bool read_compact(TDeserializer& deserializer_, const TCatalogIndex& catalog_, TNodeList& nodes_, TLinkList& links_)
+{
+    SCompactHeader header;
+    if (!deserializer_.Read(&header) || header.version != compact_version)
+        return false;
+
+    const size_t node_count = header.nodes.size();
+    const size_t link_count = header.links.size();
+
+    auto packed = [](const SCompactTable& table_) {
+        return (table_.ends.empty() || table_.ends.back() == table_.data.size()) && std::is_sorted(table_.ends.begin(), table_.ends.end());
+    };
+
+    if (header.link_ends.size() != link_count || !packed(header.devices) || !packed(header.nodes) || !packed(header.links))
+        return false;
+
+    for (const auto& it : header.link_ends)
+        if (it[0].node >= node_count || it[1].node >= node_count)
+            return false;
+
+    // Every device is looked up in the catalog once, not once per node
+    std::vector<const SDevice*> defs(header.devices.size());
+    for (size_t i = 0; i < defs.size(); ++i)
+    {
+        auto itDev = catalog_.find(TDevId(header.devices[i]));
+        if (itDev != catalog_.end())
+            defs[i] = itDev->second;
+    }
+
+    // Bindings grouped by node, so every node gets them while it is in
+    // cache instead of being revisited in link order
+    struct SBinding
+    {
+        uint32_t    link;
+        int32_t     input;
+        uint32_t    other;          // Node on the other end and its input
+        int32_t     other_input;
+        int         side;
+    };
+
+    std::vector<uint32_t> firsts(node_count + 1);
+    for (const auto& it : header.link_ends)
+        for (const SCompactEnd& end : it)
+            if (end.input >= 0)
+                ++firsts[end.node + 1];
+
+    for (size_t i = 0; i < node_count; ++i)
+        firsts[i + 1] += firsts[i];
+
+    std::vector<SBinding> bindings(firsts.back());
+    {
+        std::vector<uint32_t> next(firsts.begin(), firsts.end() - 1);
+
+        for (uint32_t i = 0; i < link_count; ++i)
+        {
+            const auto& ends = header.link_ends[i];
+
+            for (int side = 0; side < 2; ++side)
+                if (ends[side].input >= 0)
+                    bindings[next[ends[side].node]++] = { i, ends[side].input, ends[1 - side].node, ends[1 - side].input, side };
+        }
+    }
+
+    // Ends of the links, copied from the node just added rather than from
+    // the scattered node table
+    std::vector<std::array<TNodeId, 2>> link_nodes(link_count);
+
+    // How far ahead the ids of the other ends are fetched
+    const uint32_t ahead = 8;
+
+    SCompactNode node;
+
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        if (!deserializer_.Read(&node) || node.dev >= defs.size())
+            return false;
+
+        const SDevice* pDef = nullptr;
+        if (node.def >= 0 && node.def < (int32_t)header.dictionary.size())
+            pDef = &header.dictionary[node.def];
+        else if (node.def < 0)
+            pDef = defs[node.dev];
+
+        if (!pDef)
+        {
+            Log("Device " + std::string(header.devices[node.dev]) + " of node " + std::string(header.nodes[i]) + " is missing from the catalog");
+            return false;
+        }
+
+        auto itNode = nodes_.emplace_hint(nodes_.end(), header.nodes[i], *pDef);
+
+        SDevice& dev = itNode->second;
+        dev.gnode    = node.gnode;
+        dev.capacity = 0.0;
+
+        if (i + ahead < node_count)
+            for (uint32_t k = firsts[i + ahead]; k < firsts[i + ahead + 1]; ++k)
+            {
+                __builtin_prefetch(header.nodes[bindings[k].other].data());
+                __builtin_prefetch(header.links[bindings[k].link].data());
+            }
+
+        for (uint32_t k = firsts[i]; k < firsts[i + 1]; ++k)
+        {
+            const SBinding& binding = bindings[k];
+
+            if (binding.input >= (int32_t)dev.inputs.size())
+            {
+                Log("Link " + std::string(header.links[binding.link]) + " is bound to a missing input of node " + itNode->first);
+                return false;
+            }
+
+            SConnect& connect = dev.inputs[binding.input].connect;
+            connect.node  = header.nodes[binding.other];
+            connect.link  = header.links[binding.link];
+            connect.input = binding.other_input;
+
+            link_nodes[binding.link][binding.side] = itNode->first;
+        }
+    }
+
+    for (size_t i = 0; i < link_count; ++i)
+    {
+        const auto& ends = header.link_ends[i];
+
+        // Ends without a bound input are the only ones left to look up
+        for (int side = 0; side < 2; ++side)
+            if (ends[side].input < 0)
+                link_nodes[i][side] = header.nodes[ends[side].node];
+
+        links_.emplace_hint(links_.end(), header.links[i], SLink { std::move(link_nodes[i]) });
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+bool IsCompactScheme(const std::string& file_name_)
+{
+    const int fd = ::open(file_name_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    char magic[sizeof(compact_magic)] = {};
+    const bool compact = ::read(fd, magic, sizeof(magic)) == (ssize_t)sizeof(magic) && !memcmp(magic, compact_magic, sizeof(magic));
+
+    ::close(fd);
+
+    return compact;
+}
+
+//----------------------------------------------------------------------
+bool IsCompactScheme(const std::string& file_name_, const std::string* pDictionary_)
+{
+    if (!IsCompressedScheme(file_name_))
+        return IsCompactScheme(file_name_);
+
+    const int fd = ::open(file_name_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    InflateFdReader reader { fd, pDictionary_ };
+
+    char magic[sizeof(compact_magic)] = {};
+    return reader.Peek(magic, magic + sizeof(magic)) && !memcmp(magic, compact_magic, sizeof(magic));
+}
+
+//----------------------------------------------------------------------
+// Version of a compact scheme from its first bytes: the magic, then the
+// header structure prefix and member count, then the version, which all
+// versions so far encode as a single positive fixint. 0 if it is not one.
+static const size_t compact_head_size = sizeof(compact_magic) + 3;
+
+static uint32_t compact_version_of(const char (&head_)[compact_head_size])
+{
+    if (memcmp(head_, compact_magic, sizeof(compact_magic)) != 0)
+        return 0;
+
+    const uint8_t* pPrefix = reinterpret_cast<const uint8_t*>(head_ + sizeof(compact_magic));
+    if (pPrefix[0] != (uint8_t)nop::EncodingByte::Structure || pPrefix[2] > (uint8_t)nop::EncodingByte::PositiveFixIntMax)
+        return 0;
+
+    return pPrefix[2];
+}
+
+//----------------------------------------------------------------------
+template <class TDeserializer>
+static bool read_scheme(TDeserializer& deserializer_, bool compact_, const TCategoryList* pCatalog_, TNodeList& nodes_, TLinkList& links_)
+{
+    if (compact_)
+        return deserializer_.reader().Skip(sizeof(compact_magic)) && read_compact(deserializer_, index_catalog(pCatalog_), nodes_, links_);
+
+    return deserializer_.Read(&nodes_) && deserializer_.Read(&links_);
+}
+
+//----------------------------------------------------------------------
+bool LoadScheme(const std::string& file_name_, TNodeList& nodes_, TLinkList& links_, const TCategoryList* pCatalog_, const std::string* pDictionary_)
+{
+    PROFILE_SCOPE("load_scheme");
+
+    const bool compressed = IsCompressedScheme(file_name_);
+
+    const int fd = ::open(file_name_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    // Compact schemes of another version are reported rather than left to
+    // fail somewhere in the header
+    auto supported = [&file_name_](uint32_t version_) {
+        if (version_ && version_ != compact_version)
+        {
+            Log("Scheme " + file_name_ + " is in compact format version " + std::to_string(version_) + ", only version " + std::to_string(compact_version) + " can be read");
+            return false;
+        }
+        return true;
+    };
+
+    char head[compact_head_size] = {};
+    bool loaded = false;
+
+    if (compressed)
+    {
+        nop::Deserializer<InflateFdReader> deserializer { fd, pDictionary_ };
+
+        // The reader owns fd from here on
+        const uint32_t version = deserializer.reader().Peek(head, head + sizeof(head)) ? compact_version_of(head) : 0;
+        if (!supported(version))
+            return false;
+
+        loaded = read_scheme(deserializer, version != 0, pCatalog_, nodes_, links_);
+    }
+    else
+    {
+        const uint32_t version = ::pread(fd, head, sizeof(head), 0) == (ssize_t)sizeof(head) ? compact_version_of(head) : 0;
+        if (!supported(version))
+        {
+            ::close(fd);
+            return false;
+        }
+
+        nop::Deserializer<nop::BufferedFdReader> deserializer { fd };
+
+        loaded = read_scheme(deserializer, version != 0, pCatalog_, nodes_, links_);
+    }
+
+    if (!loaded)
+    {
+        Log("Failed to read scheme " + file_name_);
+
+        nodes_.clear();
+        links_.clear();
+
+        return false;
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+// Writes size_ bytes produced by write_(serializer) into the file from a
+// single buffer of exactly that size, or deflates them on the way
+template <class TWrite>
+static bool write_file(const std::string& file_name_, size_t size_, const SCompression* pCompression_, TWrite write_)
+{
+    if (pCompression_)
+    {
+        const int fd = ::open(file_name_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return false;
+
+        nop::Serializer<DeflateFdWriter> serializer { fd, pCompression_->level, pCompression_->dictionary };
+
+        const bool written = write_(serializer) && serializer.writer().Finish();
+        if (!written)
+            Log("Failed to write scheme " + file_name_);
+
+        return written;
+    }
+
+    auto write_buffer = [&](void* pBuffer_) {
+        nop::Serializer<nop::BufferWriter> serializer { pBuffer_, size_ };
+        return write_(serializer) && serializer.writer().size() == size_;
+    };
+
+    const int fd = ::open(file_name_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    // Owns the descriptor
+    nop::FdWriter file { fd };
+
+    bool written = false;
+
+    // The file is serialized in place when its blocks can be reserved and
+    // mapped, otherwise from one heap buffer with a single write
+    void* pMap = ::posix_fallocate(fd, 0, size_) == 0 ? ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (pMap != MAP_FAILED)
+    {
+        written = write_buffer(pMap);
+        ::munmap(pMap, size_);
+    }
+    else
+    {
+        std::unique_ptr<uint8_t[]> buffer(new uint8_t[size_]);
+
+        written = ::ftruncate(fd, 0) == 0 && write_buffer(buffer.get()) && file.Write(buffer.get(), buffer.get() + size_);
+    }
+
+    if (!written)
+        Log("Failed to write scheme " + file_name_);
+
+    return written;
+}
+
+//----------------------------------------------------------------------
+bool SaveScheme(const std::string& file_name_, const TNodeList& nodes_, const TLinkList& links_, const SCompression* pCompression_)
+{
+    PROFILE_SCOPE("save_scheme");
+
+    const size_t size = nop::Encoding<TNodeList>::Size(nodes_) + nop::Encoding<TLinkList>::Size(links_);
+
+    return write_file(file_name_, size, pCompression_, [&](auto& serializer_) {
+        return serializer_.Write(nodes_) && serializer_.Write(links_);
+    });
+}
+
+//----------------------------------------------------------------------
+bool SaveCompactScheme(const std::string& file_name_, const TCategoryList& catalog_, const TNodeList& nodes_, const TLinkList& links_, const SCompression* pCompression_)
+{
+    PROFILE_SCOPE("save_compact_scheme");
+
+    const TCatalogIndex catalog = index_catalog(&catalog_);
+
+    SCompactHeader header;
+
+    std::unordered_map<TNodeId, uint32_t> node_index;
+    node_index.reserve(nodes_.size());
+    header.nodes.ends.reserve(nodes_.size());
+
+    for (const auto& it : nodes_)
+    {
+        node_index.emplace(it.first, (uint32_t)header.nodes.size());
+        header.nodes.push_back(it.first);
+    }
+
+    // Links to missing nodes can't be written by index and are dropped
+    header.links.ends.reserve(links_.size());
+    header.link_ends.reserve(links_.size());
+
+    std::unordered_map<TLinkId, uint32_t> link_index;
+    link_index.reserve(links_.size());
+
+    for (const auto& it : links_)
+    {
+        auto itLeft  = node_index.find(it.second.nodes[0]);
+        auto itRight = node_index.find(it.second.nodes[1]);
+        if (itLeft == node_index.end() || itRight == node_index.end())
+        {
+            Log("Link " + it.first + " refers to a missing node, skipped");
+            continue;
+        }
+
+        link_index.emplace(it.first, (uint32_t)header.links.size());
+        header.links.push_back(it.first);
+        header.link_ends.push_back( { SCompactEnd { itLeft->second, -1 }, SCompactEnd { itRight->second, -1 } } );
+    }
+
+    std::unordered_map<TDevId, uint32_t> device_index;
+
+    // Dictionary entries by device id, several if the same id was saved
+    // with different definitions
+    std::unordered_map<TDevId, std::vector<int32_t>> dictionary_index;
+
+    std::vector<SCompactNode> nodes;
+    nodes.reserve(nodes_.size());
+
+    for (const auto& it : nodes_)
+    {
+        const SDevice& dev = it.second;
+
+        SCompactNode node;
+        node.dev    = device_index.emplace(dev.id, (uint32_t)header.devices.size()).first->second;
+        node.gnode  = dev.gnode;
+
+        if (node.dev == header.devices.size())
+            header.devices.push_back(dev.id);
+
+        auto itDev = catalog.find(dev.id);
+        if (itDev == catalog.end() || !itDev->second->SameDefinition(dev))
+        {
+            auto& entries = dictionary_index[dev.id];
+
+            auto itEntry = std::find_if(entries.begin(), entries.end(), [&](int32_t ind_) { return header.dictionary[ind_].SameDefinition(dev); });
+            if (itEntry != entries.end())
+                node.def = *itEntry;
+            else
+            {
+                node.def = (int32_t)header.dictionary.size();
+                entries.push_back(node.def);
+
+                SDevice def = dev;
+                def.gnode = SGraphNode();
+                for (auto& itInput : def.inputs)
+                    itInput.connect.Reset();
+
+                header.dictionary.push_back(std::move(def));
+            }
+        }
+
+        // The input goes to the end of its link this node is on, the
+        // first free one for a link between two inputs of the same node
+        const uint32_t ind = (uint32_t)nodes.size();
+
+        for (size_t i = 0; i < dev.inputs.size(); ++i)
+        {
+            const SConnect& connect = dev.inputs[i].connect;
+
+            auto itLink = connect.link.empty() ? link_index.end() : link_index.find(connect.link);
+            if (itLink == link_index.end())
+                continue;
+
+            for (auto& itEnd : header.link_ends[itLink->second])
+                if (itEnd.node == ind && itEnd.input < 0)
+                {
+                    itEnd.input = (int32_t)i;
+                    break;
+                }
+        }
+
+        nodes.push_back(node);
+    }
+
+    size_t size = sizeof(compact_magic) + nop::Encoding<SCompactHeader>::Size(header);
+    for (const auto& it : nodes)
+        size += nop::Encoding<SCompactNode>::Size(it);
+
+    return write_file(file_name_, size, pCompression_, [&](auto& serializer_) {
+        if (!serializer_.writer().Write(compact_magic, compact_magic + sizeof(compact_magic)) || !serializer_.Write(header))
+            return false;
+
+        for (const auto& it : nodes)
+            if (!serializer_.Write(it))
+                return false;
+
+        return true;
+    });
+}
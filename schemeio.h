@@ -0,0 +1,39 @@
+#ifndef SCHEMEIO_H
+#define SCHEMEIO_H
+
+#include "scheme.h"
+
+//----------------------------------------------------------------------
+// Reading and writing .sch files outside of the UI.
+//
+// Two formats share the extension. The legacy one stores every node as
+// a full SDevice. The compact one starts with a magic and stores nodes
+// as the index of their catalog device plus their position, bindings
+// only with the links; definitions that are not in the catalog (or
+// differ from it) go to a dictionary in the file. It is about a quarter
+// of the size and loads as fast. LoadScheme() reads both, resolving
+// compact nodes against pCatalog_; compact files of another version are
+// reported and not read.
+//
+// Either format may be saved deflate compressed (schemecompress.h).
+// LoadScheme() inflates such files with pDictionary_, which has to be
+// the dictionary they were written with, if any.
+
+//----------------------------------------------------------------------
+struct SCompression
+{
+    int         level       { 1 };  // zlib level, 1 is the fastest
+    std::string dictionary;         // Preset shared with the readers, may be empty
+};
+
+bool LoadScheme(const std::string& file_name_, TNodeList& nodes_, TLinkList& links_, const TCategoryList* pCatalog_ = nullptr, const std::string* pDictionary_ = nullptr);
+bool SaveScheme(const std::string& file_name_, const TNodeList& nodes_, const TLinkList& links_, const SCompression* pCompression_ = nullptr);
+bool SaveCompactScheme(const std::string& file_name_, const TCategoryList& catalog_, const TNodeList& nodes_, const TLinkList& links_, const SCompression* pCompression_ = nullptr);
+
+// Only looks at the magic, compressed files are not compact
+bool IsCompactScheme(const std::string& file_name_);
+
+// The same for compressed files too, inflating their start with pDictionary_
+bool IsCompactScheme(const std::string& file_name_, const std::string* pDictionary_);
+
+#endif // SCHEMEIO_H
@@ -0,0 +1,431 @@
+#include "schemesnapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include "profiler.h"
+
+//----------------------------------------------------------------------
+static const char     snapshot_magic[4] = { 'S', 'V', 'S', 'M' };
+static const uint32_t snapshot_version  = 1;
+
+static const uint64_t min_slot_size     = 1 << 20;
+
+//----------------------------------------------------------------------
+static uint64_t align(uint64_t offset_)
+{
+    return (offset_ + 63) & ~uint64_t(63);
+}
+
+//----------------------------------------------------------------------
+uint32_t SnapshotView::InputsOf(const SSnapshotNode& node_) const
+{
+    if (node_.first_input > m_input_count)
+        return 0;
+
+    return std::min(node_.input_count, m_input_count - node_.first_input);
+}
+
+//----------------------------------------------------------------------
+std::string_view SnapshotView::String(const SSnapshotString& string_) const
+{
+    if (string_.offset > m_string_size)
+        return std::string_view();
+
+    return std::string_view(m_pStrings + string_.offset, std::min(string_.size, m_string_size - string_.offset));
+}
+
+//----------------------------------------------------------------------
+std::optional<uint32_t> SnapshotView::FindNode(std::string_view id_) const
+{
+    const SSnapshotNode* pEnd = m_pNodes + m_node_count;
+
+    auto it = std::lower_bound(m_pNodes, pEnd, id_, [this](const SSnapshotNode& node_, std::string_view id_) {
+        return String(node_.id) < id_;
+    });
+
+    if (it == pEnd || String(it->id) != id_)
+        return std::nullopt;
+
+    return uint32_t(it - m_pNodes);
+}
+
+//----------------------------------------------------------------------
+SDevice SnapshotView::ToDevice(uint32_t ind_) const
+{
+    const SSnapshotNode& node = m_pNodes[ind_];
+
+    SDevice dev;
+    dev.id      = String(node.id);
+    dev.name    = String(node.name);
+    dev.rule    = String(node.rule);
+    dev.gnode   = { node.x, node.y };
+    dev.power   = node.power;
+
+    const uint32_t count = InputsOf(node);
+    dev.inputs.reserve(count);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const SSnapshotInput& input = m_pInputs[node.first_input + i];
+
+        dev.inputs.push_back(SInput(std::string(String(input.name))));
+
+        if (!input.IsOn())
+            continue;
+
+        SConnect& connect = dev.inputs.back().connect;
+
+        // A binding to a node missing from the scheme still counts as on
+        connect.node  = input.node >= 0 && input.node < (int32_t)m_node_count ? String(m_pNodes[input.node].id) : std::string_view("?");
+        connect.input = input.input;
+
+        if (input.link >= 0 && input.link < (int32_t)m_link_count)
+            connect.link = String(m_pLinks[input.link].id);
+    }
+
+    return dev;
+}
+
+//----------------------------------------------------------------------
+bool SnapshotReader::Open(const std::string& name_)
+{
+    Close();
+
+    // Kept on failure, Begin() retries until the writer is there
+    m_name = name_;
+
+    return reopen(true);
+}
+
+//----------------------------------------------------------------------
+bool SnapshotReader::reopen(bool log_)
+{
+    unmap();
+
+    const int fd = ::shm_open(m_name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+
+    const bool mapped = map(fd);
+    ::close(fd);
+
+    if (!mapped && log_)
+        Log("Not a scheme snapshot: " + m_name);
+
+    return mapped;
+}
+
+//----------------------------------------------------------------------
+bool SnapshotReader::map(int fd_)
+{
+    struct stat info;
+    if (::fstat(fd_, &info) < 0 || (size_t)info.st_size < sizeof(SSnapshotHeader))
+        return false;
+
+    void* pMap = ::mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd_, 0);
+    if (pMap == MAP_FAILED)
+        return false;
+
+    const SSnapshotHeader* pHeader = static_cast<const SSnapshotHeader*>(pMap);
+
+    const bool valid = !memcmp(pHeader->magic, snapshot_magic, sizeof(snapshot_magic)) && pHeader->version == snapshot_version &&
+                       pHeader->slot_offsets[0] + pHeader->slot_size <= (uint64_t)info.st_size &&
+                       pHeader->slot_offsets[1] + pHeader->slot_size <= (uint64_t)info.st_size;
+    if (!valid)
+    {
+        ::munmap(pMap, info.st_size);
+        return false;
+    }
+
+    m_pHeader   = pHeader;
+    m_size      = info.st_size;
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+void SnapshotReader::Close()
+{
+    unmap();
+    m_name.clear();
+}
+
+//----------------------------------------------------------------------
+void SnapshotReader::unmap()
+{
+    if (m_pHeader)
+        ::munmap(const_cast<SSnapshotHeader*>(m_pHeader), m_size);
+
+    m_pHeader   = nullptr;
+    m_size      = 0;
+    m_begin     = 0;
+}
+
+//----------------------------------------------------------------------
+std::optional<SnapshotView> SnapshotReader::Begin()
+{
+    // A retired snapshot or a failed reopen is retried under the same name
+    if (m_pHeader && m_pHeader->retired.load(std::memory_order_acquire))
+        unmap();
+
+    if (!m_pHeader && (m_name.empty() || !reopen(false)))
+        return std::nullopt;
+
+    const uint64_t sequence = m_pHeader->sequence.load(std::memory_order_acquire);
+    if (sequence < 2)
+        return std::nullopt;
+
+    // While a publish is under way the previous one is still intact
+    m_begin = sequence & ~uint64_t(1);
+
+    const uint64_t slot_size = m_pHeader->slot_size;
+    const uint8_t* pSlot = reinterpret_cast<const uint8_t*>(m_pHeader) + m_pHeader->slot_offsets[(sequence >> 1) & 1];
+    const SSnapshotSlot& slot = *reinterpret_cast<const SSnapshotSlot*>(pSlot);
+
+    // Largest count of records of size_ that fit from offset_ to the slot end
+    auto fit = [slot_size](uint64_t offset_, uint32_t count_, size_t size_) {
+        return offset_ > slot_size ? 0 : (uint32_t)std::min<uint64_t>(count_, (slot_size - offset_) / size_);
+    };
+
+    SnapshotView view;
+    view.m_pNodes       = reinterpret_cast<const SSnapshotNode*>(pSlot + std::min(slot.nodes, slot_size));
+    view.m_pInputs      = reinterpret_cast<const SSnapshotInput*>(pSlot + std::min(slot.inputs, slot_size));
+    view.m_pLinks       = reinterpret_cast<const SSnapshotLink*>(pSlot + std::min(slot.links, slot_size));
+    view.m_pStrings     = reinterpret_cast<const char*>(pSlot + std::min(slot.strings, slot_size));
+    view.m_sequence     = m_begin;
+    view.m_node_count   = fit(slot.nodes,   slot.node_count,  sizeof(SSnapshotNode));
+    view.m_input_count  = fit(slot.inputs,  slot.input_count, sizeof(SSnapshotInput));
+    view.m_link_count   = fit(slot.links,   slot.link_count,  sizeof(SSnapshotLink));
+    view.m_string_size  = fit(slot.strings, slot.string_size, 1);
+
+    return view;
+}
+
+//----------------------------------------------------------------------
+bool SnapshotReader::Valid() const
+{
+    if (!m_pHeader)
+        return false;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    return m_pHeader->sequence.load(std::memory_order_relaxed) - m_begin <= 2;
+}
+
+//----------------------------------------------------------------------
+uint64_t SnapshotReader::Sequence() const
+{
+    return m_pHeader ? m_pHeader->sequence.load(std::memory_order_acquire) : 0;
+}
+
+//----------------------------------------------------------------------
+bool SnapshotWriter::Create(const std::string& name_)
+{
+    Close();
+
+    m_name = name_;
+
+    return create(min_slot_size);
+}
+
+//----------------------------------------------------------------------
+bool SnapshotWriter::create(uint64_t slot_size_)
+{
+    // A segment left by a crashed run, or the one being replaced, which
+    // stays alive for as long as readers have it mapped
+    ::shm_unlink(m_name.c_str());
+
+    const int fd = ::shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+    {
+        Log("Failed to create shared memory " + m_name + ": " + strerror(errno));
+        return false;
+    }
+
+    const uint64_t first = align(sizeof(SSnapshotHeader));
+    const size_t   size  = first + 2 * slot_size_;
+
+    void* pMap = ::ftruncate(fd, size) == 0 ? ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+
+    if (pMap == MAP_FAILED)
+    {
+        Log("Failed to map shared memory " + m_name + ": " + strerror(errno));
+        ::shm_unlink(m_name.c_str());
+        return false;
+    }
+
+    // The pages come zeroed, both slots read as empty schemes
+    SSnapshotHeader* pHeader = new (pMap) SSnapshotHeader;
+
+    pHeader->version    = snapshot_version;
+    pHeader->slot_size  = slot_size_;
+    pHeader->slot_offsets[0] = first;
+    pHeader->slot_offsets[1] = first + slot_size_;
+    pHeader->sequence.store(0, std::memory_order_relaxed);
+    pHeader->retired.store(0, std::memory_order_relaxed);
+
+    // Readers only accept the segment with the magic in place
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(pHeader->magic, snapshot_magic, sizeof(snapshot_magic));
+
+    m_pHeader   = pHeader;
+    m_size      = size;
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+void SnapshotWriter::unmap()
+{
+    if (m_pHeader)
+        ::munmap(m_pHeader, m_size);
+
+    m_pHeader   = nullptr;
+    m_size      = 0;
+}
+
+//----------------------------------------------------------------------
+void SnapshotWriter::Close()
+{
+    if (!m_pHeader)
+        return;
+
+    m_pHeader->retired.store(1, std::memory_order_release);
+
+    unmap();
+    ::shm_unlink(m_name.c_str());
+}
+
+//----------------------------------------------------------------------
+SSnapshotString SnapshotWriter::add_string(const std::string& string_)
+{
+    const SSnapshotString result = { (uint32_t)m_strings.size(), (uint32_t)string_.size() };
+    m_strings.append(string_);
+    return result;
+}
+
+//----------------------------------------------------------------------
+// Device names, rules and port names repeat across nodes, ids do not
+SSnapshotString SnapshotWriter::intern(const std::string& string_)
+{
+    auto it = m_interned.find(string_);
+    if (it != m_interned.end())
+        return it->second;
+
+    const SSnapshotString result = add_string(string_);
+    m_interned.emplace(string_, result);
+    return result;
+}
+
+//----------------------------------------------------------------------
+bool SnapshotWriter::Publish(const TNodeList& nodes_, const TLinkList& links_)
+{
+    if (!m_pHeader)
+        return false;
+
+    PROFILE_SCOPE("snapshot_publish");
+
+    m_nodes     .clear();
+    m_inputs    .clear();
+    m_links     .clear();
+    m_strings   .clear();
+    m_interned  .clear();
+    m_node_index.clear();
+    m_link_index.clear();
+
+    // Bindings name nodes and links by id, records refer to them by index
+    m_node_index.reserve(nodes_.size());
+    for (const auto& it : nodes_)
+        m_node_index.emplace(it.first, (int32_t)m_node_index.size());
+
+    m_link_index.reserve(links_.size());
+    for (const auto& it : links_)
+        m_link_index.emplace(it.first, (int32_t)m_link_index.size());
+
+    auto index = [](const auto& index_, const std::string& id_) {
+        auto it = id_.empty() ? index_.end() : index_.find(id_);
+        return it != index_.end() ? it->second : -1;
+    };
+
+    m_nodes.reserve(nodes_.size());
+
+    for (const auto& it : nodes_)
+    {
+        const SDevice& dev = it.second;
+
+        m_nodes.push_back( { add_string(it.first), intern(dev.name), intern(dev.rule), dev.gnode.x, dev.gnode.y, dev.power,
+                             (uint32_t)m_inputs.size(), (uint32_t)dev.inputs.size() } );
+
+        for (const auto& itInput : dev.inputs)
+        {
+            const int32_t input = itInput.IsOn() ? std::max(itInput.connect.input, 0) : -1;
+
+            m_inputs.push_back( { intern(itInput.name), index(m_node_index, itInput.connect.node), index(m_link_index, itInput.connect.link), input, 0 } );
+        }
+    }
+
+    m_links.reserve(links_.size());
+
+    for (const auto& it : links_)
+        m_links.push_back( { add_string(it.first), { index(m_node_index, it.second.nodes[0]), index(m_node_index, it.second.nodes[1]) } } );
+
+    SSnapshotSlot slot;
+    slot.node_count     = (uint32_t)m_nodes.size();
+    slot.input_count    = (uint32_t)m_inputs.size();
+    slot.link_count     = (uint32_t)m_links.size();
+    slot.string_size    = (uint32_t)m_strings.size();
+    slot.nodes          = align(sizeof(SSnapshotSlot));
+    slot.inputs         = align(slot.nodes  + m_nodes .size() * sizeof(SSnapshotNode));
+    slot.links          = align(slot.inputs + m_inputs.size() * sizeof(SSnapshotInput));
+    slot.strings        = align(slot.links  + m_links .size() * sizeof(SSnapshotLink));
+
+    const uint64_t needed = slot.strings + m_strings.size();
+
+    if (needed > m_pHeader->slot_size)
+    {
+        // Readers still on the old segment keep a consistent view of it
+        // and move over on their next Begin()
+        SSnapshotHeader* pOld = m_pHeader;
+        const size_t old_size = m_size;
+
+        const bool created = create(std::max(needed + needed / 2, min_slot_size));
+
+        // The name refers to the new segment now, or to none
+        pOld->retired.store(1, std::memory_order_release);
+        ::munmap(pOld, old_size);
+
+        if (!created)
+        {
+            m_pHeader   = nullptr;
+            m_size      = 0;
+            return false;
+        }
+    }
+
+    const uint64_t sequence = m_pHeader->sequence.load(std::memory_order_relaxed);
+
+    // The slot readers were not pointed at
+    uint8_t* pSlot = reinterpret_cast<uint8_t*>(m_pHeader) + m_pHeader->slot_offsets[((sequence >> 1) + 1) & 1];
+
+    m_pHeader->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    memcpy(pSlot, &slot, sizeof(slot));
+    memcpy(pSlot + slot.nodes,   m_nodes .data(), m_nodes .size() * sizeof(SSnapshotNode));
+    memcpy(pSlot + slot.inputs,  m_inputs.data(), m_inputs.size() * sizeof(SSnapshotInput));
+    memcpy(pSlot + slot.links,   m_links .data(), m_links .size() * sizeof(SSnapshotLink));
+    memcpy(pSlot + slot.strings, m_strings.data(), m_strings.size());
+
+    m_pHeader->sequence.store(sequence + 2, std::memory_order_release);
+
+    return true;
+}
@@ -0,0 +1,215 @@
+#ifndef SCHEMESNAPSHOT_H
+#define SCHEMESNAPSHOT_H
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+
+#include "scheme.h"
+
+//----------------------------------------------------------------------
+// Read-only scheme snapshots in POSIX shared memory.
+//
+// The publisher lays the scheme out as flat arrays of fixed size records.
+// Records refer to strings by offset and to other records by index, never
+// by address, so readers map the segment anywhere and use it in place.
+//
+// The segment holds two slots. A publish fills the slot readers were not
+// told to use and then switches to it, bumping a sequence counter at the
+// start and at the end (a seqlock). The slot a reader started on is only
+// overwritten by the publish after the next one, which Valid() detects.
+// When a scheme outgrows its slot the publisher replaces the segment with
+// a larger one under the same name. Readers switch to it on their next
+// Begin().
+
+//----------------------------------------------------------------------
+struct SSnapshotString
+{
+    uint32_t offset;
+    uint32_t size;
+};
+
+//----------------------------------------------------------------------
+struct SSnapshotNode
+{
+    SSnapshotString id;
+    SSnapshotString name;
+    SSnapshotString rule;
+    int32_t         x;
+    int32_t         y;
+    double          power;
+    uint32_t        first_input;    // Inputs of a node are consecutive
+    uint32_t        input_count;
+};
+
+//----------------------------------------------------------------------
+struct SSnapshotInput
+{
+    SSnapshotString name;
+    int32_t         node;           // Bound node and link, -1 when free or
+    int32_t         link;           // missing from the scheme
+    int32_t         input;          // Input of the bound node, -1 when free
+    uint32_t        reserved;
+
+    bool IsOn() const { return input >= 0; }
+};
+
+//----------------------------------------------------------------------
+struct SSnapshotLink
+{
+    SSnapshotString id;
+    int32_t         nodes[2];
+};
+
+//----------------------------------------------------------------------
+struct SSnapshotSlot
+{
+    uint32_t node_count;
+    uint32_t input_count;
+    uint32_t link_count;
+    uint32_t string_size;
+    uint64_t nodes;                 // Offsets from the start of the slot
+    uint64_t inputs;
+    uint64_t links;
+    uint64_t strings;
+};
+
+//----------------------------------------------------------------------
+struct SSnapshotHeader
+{
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Snapshots need lock-free 64-bit atomics");
+
+    char                    magic[4];
+    uint32_t                version;
+    std::atomic<uint64_t>   sequence;       // Odd while a slot is written, 0 before the first publish
+    std::atomic<uint32_t>   retired;        // Replaced by a larger segment
+    uint32_t                reserved;
+    uint64_t                slot_size;
+    uint64_t                slot_offsets[2];// From the start of the segment
+};
+
+//----------------------------------------------------------------------
+// One published scheme, in place in the segment. Nodes and links are in
+// id order. Counts and offsets are clamped to the slot, so a view the
+// publisher overwrote reads garbage but never outside the segment.
+class SnapshotView
+{
+public:
+    // Of the publish shown, even
+    uint64_t Sequence() const   { return m_sequence; }
+
+    uint32_t NodeCount() const  { return m_node_count; }
+    uint32_t InputCount() const { return m_input_count; }
+    uint32_t LinkCount() const  { return m_link_count; }
+
+    const SSnapshotNode&  Node(uint32_t ind_) const  { return m_pNodes[ind_]; }
+    const SSnapshotInput& Input(uint32_t ind_) const { return m_pInputs[ind_]; }
+    const SSnapshotLink&  Link(uint32_t ind_) const  { return m_pLinks[ind_]; }
+
+    // Number of inputs of a node that are within the slot
+    uint32_t InputsOf(const SSnapshotNode& node_) const;
+
+    std::string_view String(const SSnapshotString& string_) const;
+
+    std::optional<uint32_t> FindNode(std::string_view id_) const;
+
+    // Owning copy, e.g. to evaluate the rule with LibBoolEE
+    SDevice ToDevice(uint32_t ind_) const;
+
+private:
+    friend class SnapshotReader;
+
+    const SSnapshotNode*    m_pNodes        {};
+    const SSnapshotInput*   m_pInputs       {};
+    const SSnapshotLink*    m_pLinks        {};
+    const char*             m_pStrings      {};
+    uint64_t                m_sequence      {};
+    uint32_t                m_node_count    {};
+    uint32_t                m_input_count   {};
+    uint32_t                m_link_count    {};
+    uint32_t                m_string_size   {};
+};
+
+//----------------------------------------------------------------------
+class SnapshotReader
+{
+public:
+    SnapshotReader() = default;
+    ~SnapshotReader() { Close(); }
+
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+    // Remembers the name even when it fails, Begin() keeps retrying
+    bool Open(const std::string& name_);
+    void Close();
+
+    bool IsOpen() const { return m_pHeader != nullptr; }
+
+    // Latest published scheme, none before the first publish or while
+    // the snapshot cannot be reopened
+    std::optional<SnapshotView> Begin();
+
+    // Whether everything read from the view of the last Begin() is
+    // consistent. A reader slower than two publishes starts over.
+    bool Valid() const;
+
+    // Changes with every publish, cheap enough to poll
+    uint64_t Sequence() const;
+
+private:
+    bool reopen(bool log_);
+    bool map(int fd_);
+    void unmap();
+
+    std::string                 m_name;
+    const SSnapshotHeader*      m_pHeader   {};
+    size_t                      m_size      {};
+    uint64_t                    m_begin     {};
+};
+
+//----------------------------------------------------------------------
+class SnapshotWriter
+{
+public:
+    SnapshotWriter() = default;
+    ~SnapshotWriter() { Close(); }
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    // name_ is a shm_open() name, "/something"
+    bool Create(const std::string& name_);
+
+    // Removes the name, readers keep what they mapped
+    void Close();
+
+    bool IsOpen() const { return m_pHeader != nullptr; }
+    const std::string& Name() const { return m_name; }
+
+    bool Publish(const TNodeList& nodes_, const TLinkList& links_);
+
+private:
+    bool create(uint64_t slot_size_);
+    void unmap();
+
+    SSnapshotString add_string(const std::string& string_);
+    SSnapshotString intern(const std::string& string_);
+
+    std::string                     m_name;
+    SSnapshotHeader*                m_pHeader   {};
+    size_t                          m_size      {};
+
+    // Built outside of the seqlock, reused between publishes
+    std::vector<SSnapshotNode>      m_nodes;
+    std::vector<SSnapshotInput>     m_inputs;
+    std::vector<SSnapshotLink>      m_links;
+    std::string                     m_strings;
+    std::unordered_map<std::string_view, SSnapshotString> m_interned;
+    std::unordered_map<std::string_view, int32_t>         m_node_index;
+    std::unordered_map<std::string_view, int32_t>         m_link_index;
+};
+
+#endif // SCHEMESNAPSHOT_H
@@ -0,0 +1,117 @@
+#include "schemeview.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "nop/utility/buffer_reader.h"
+
+#include "profiler.h"
+
+//----------------------------------------------------------------------
+SDevice SDeviceView::ToDevice() const
+{
+    SDevice dev;
+
+    dev.id      = TDevId(id);
+    dev.name    = std::string(name);
+    dev.rule    = std::string(rule);
+    dev.gnode   = gnode;
+    dev.power   = power;
+
+    dev.inputs.reserve(inputs.size());
+    for (const auto& it : inputs)
+    {
+        SInput input(std::string(it.name));
+        input.connect.node  = TNodeId(it.connect.node);
+        input.connect.link  = TLinkId(it.connect.link);
+        input.connect.input = it.connect.input;
+
+        dev.inputs.push_back(std::move(input));
+    }
+
+    return dev;
+}
+
+//----------------------------------------------------------------------
+SchemeView::~SchemeView()
+{
+    Close();
+}
+
+//----------------------------------------------------------------------
+bool SchemeView::Open(const std::string& file_name_)
+{
+    PROFILE_SCOPE("open_scheme_view");
+
+    Close();
+
+    const int fd = ::open(file_name_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat info {};
+    if (::fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        m_map_size = (size_t)info.st_size;
+        m_pMap = ::mmap(nullptr, m_map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+
+    // The mapping stays valid without the descriptor
+    ::close(fd);
+
+    if (m_pMap == MAP_FAILED || !m_pMap)
+    {
+        m_pMap = nullptr;
+        m_map_size = 0;
+
+        Log("Failed to map scheme " + file_name_);
+        return false;
+    }
+
+    ::madvise(m_pMap, m_map_size, MADV_SEQUENTIAL);
+
+    if (!Parse(m_pMap, m_map_size))
+    {
+        Log("Failed to read scheme " + file_name_);
+
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+bool SchemeView::Parse(const void* data_, size_t size_)
+{
+    m_nodes.clear();
+    m_links.clear();
+
+    nop::Deserializer<nop::BufferReader> deserializer { data_, size_ };
+
+    if (!deserializer.Read(&m_nodes) || !deserializer.Read(&m_links))
+    {
+        m_nodes.clear();
+        m_links.clear();
+
+        return false;
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+void SchemeView::Close()
+{
+    // Views into the mapping go first
+    m_nodes.clear();
+    m_links.clear();
+
+    if (m_pMap)
+        ::munmap(m_pMap, m_map_size);
+
+    m_pMap = nullptr;
+    m_map_size = 0;
+}
@@ -0,0 +1,97 @@
+#ifndef SCHEMEVIEW_H
+#define SCHEMEVIEW_H
+
+#include <string_view>
+
+#include "scheme.h"
+
+//----------------------------------------------------------------------
+// Read-only scheme types whose strings point into the encoded buffer.
+//
+// Member for member the same as SConnect/SInput/SDevice/SLink, so they
+// decode the .sch encoding, but no string payload is copied: ids, names,
+// rules and port names are views of the mapped file (or of the buffer
+// the scheme was parsed from) and are valid as long as it is.
+struct SConnectView
+{
+    std::string_view    node;
+    std::string_view    link;
+    int                 input { -1 };
+
+    NOP_STRUCTURE(SConnectView, node, link, input);
+};
+
+//----------------------------------------------------------------------
+struct SInputView
+{
+    std::string_view    name;
+    SConnectView        connect;
+
+    bool IsOn() const { return !connect.node.empty(); }
+
+    NOP_STRUCTURE(SInputView, name, connect);
+};
+
+//----------------------------------------------------------------------
+struct SDeviceView
+{
+    std::string_view        id;
+    std::string_view        name;
+    std::vector<SInputView> inputs;
+    std::string_view        rule;
+    SGraphNode              gnode;
+    double                  power   {};
+
+    NOP_STRUCTURE(SDeviceView, id, name, inputs, rule, gnode, power);
+
+    bool IsCable() const
+    {
+        return inputs.size() == 2 && power == 0.0;
+    }
+
+    // Owning copy, e.g. to evaluate the rule or pull the node into a scheme
+    SDevice ToDevice() const;
+};
+
+//----------------------------------------------------------------------
+struct SLinkView
+{
+    std::array<std::string_view, 2> nodes;
+
+    NOP_STRUCTURE(SLinkView, nodes);
+};
+
+typedef std::map<std::string_view, SDeviceView> TNodeViewList;
+typedef std::map<std::string_view, SLinkView>   TLinkViewList;
+
+//----------------------------------------------------------------------
+// Scheme decoded in place from a read-only mapping of its file, or from
+// a buffer owned by the caller. Legacy .sch encoding only, compact files
+// need the catalog and go through LoadScheme().
+class SchemeView
+{
+public:
+    SchemeView() = default;
+    ~SchemeView();
+
+    SchemeView(const SchemeView&) = delete;
+    SchemeView& operator=(const SchemeView&) = delete;
+
+    bool Open(const std::string& file_name_);
+
+    // data_ has to outlive the view
+    bool Parse(const void* data_, size_t size_);
+
+    void Close();
+
+    const TNodeViewList& Nodes() const { return m_nodes; }
+    const TLinkViewList& Links() const { return m_links; }
+
+private:
+    void*           m_pMap {};
+    size_t          m_map_size {};
+    TNodeViewList   m_nodes;
+    TLinkViewList   m_links;
+};
+
+#endif // SCHEMEVIEW_H
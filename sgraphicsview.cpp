@@ -1,14 +1,46 @@
 #include "sgraphicsview.h"
 #include "ui_sgraphicsview.h"
 
+#include <QWheelEvent>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include <algorithm>
+#include <cmath>
+
+//----------------------------------------------------------------------
+// Zoom range and wheel sensitivity (scale factor per degree)
+static const double min_scale       = 0.01;
+static const double max_scale       = 8.0;
+static const double zoom_per_degree = 1.0020;
+
+//----------------------------------------------------------------------
+// Level of detail thresholds. Frames slower than the budget raise them
+// (less detail at the same zoom), frames well below it slowly lower
+// them back, within the given limits
+static const double frame_budget_ms     = 25.0;
+static const double default_label_scale = 0.6;
+static const double default_point_scale = 0.2;
+static const double min_label_scale     = 0.3;
+static const double max_label_scale     = 1.5;
+static const double min_point_scale     = 0.05;
+
+//----------------------------------------------------------------------
+// Points mode: point size and link aggregation cell, in pixels
+static const int    point_px        = 4;
+static const double aggregation_px  = 6.0;
+
 //----------------------------------------------------------------------
 SGraphicsView::SGraphicsView(QWidget *parent) :
     QGraphicsView   (parent),
-    ui              (new Ui::SGraphicsView)
+    ui              (new Ui::SGraphicsView),
+    m_label_scale   (default_label_scale),
+    m_point_scale   (default_point_scale)
 {
     ui->setupUi(this);
 
     setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform | QPainter::HighQualityAntialiasing);
+    setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
 }
 
 //----------------------------------------------------------------------
@@ -17,3 +49,179 @@ SGraphicsView::~SGraphicsView()
     delete ui;
 }
 
+
+//----------------------------------------------------------------------
+QRectF SGraphicsView::VisibleRect() const
+{
+    return mapToScene(viewport()->rect()).boundingRect();
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::SetPointCloud(std::vector<SPointGroup> groups_, std::vector<QLineF> lines_)
+{
+    m_point_groups = std::move(groups_);
+    m_point_lines  = std::move(lines_);
+
+    if (m_lod == eLodPoints)
+        viewport()->update();
+}
+
+//----------------------------------------------------------------------
+double SGraphicsView::AggregationCell() const
+{
+    // Rounded up, the cloud is only rebuilt when the zoom halves or doubles
+    return std::exp2(std::ceil(std::log2(aggregation_px / transform().m11())));
+}
+
+//----------------------------------------------------------------------
+SGraphicsView::ELod SGraphicsView::wanted_lod() const
+{
+    const double scale = transform().m11();
+
+    return scale < m_point_scale ? eLodPoints
+         : scale < m_label_scale ? eLodNoLabels
+                                 : eLodFull;
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::update_lod()
+{
+    const ELod lod = wanted_lod();
+    if (lod == m_lod)
+        return;
+
+    m_lod = lod;
+
+    if (m_lod == eLodFull)
+        setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform | QPainter::HighQualityAntialiasing);
+    else
+        setRenderHints(QPainter::RenderHints());
+
+    if (m_lod != eLodPoints)
+    {
+        m_point_groups.clear();
+        m_point_lines.clear();
+    }
+
+    viewport()->update();
+
+    emit lodChanged(m_lod);
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::adapt_thresholds(double frame_ms_, size_t items_)
+{
+    // Fast frames without items tell nothing about the cost of items
+    if (items_ == 0)
+        return;
+
+    // Smoothed, so that a single slow frame does not switch modes
+    m_frame_ms = m_frame_ms * 0.8 + frame_ms_ * 0.2;
+
+    if (m_frame_ms > frame_budget_ms)
+    {
+        if (m_lod == eLodFull)
+            m_label_scale = std::min(m_label_scale * 1.1, max_label_scale);
+        else if (m_lod == eLodNoLabels)
+            m_point_scale = std::min(m_point_scale * 1.1, m_label_scale * 0.8);
+    }
+    else if (m_frame_ms < frame_budget_ms / 4 && m_lod != eLodPoints)
+    {
+        m_label_scale = std::max(m_label_scale * 0.99, min_label_scale);
+        m_point_scale = std::max(m_point_scale * 0.99, min_point_scale);
+    }
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::scrollContentsBy(int dx_, int dy_)
+{
+    QGraphicsView::scrollContentsBy(dx_, dy_);
+
+    emit viewportChanged();
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::resizeEvent(QResizeEvent* event_)
+{
+    QGraphicsView::resizeEvent(event_);
+
+    emit viewportChanged();
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::wheelEvent(QWheelEvent* event_)
+{
+    if (!(event_->modifiers() & Qt::ControlModifier))
+    {
+        QGraphicsView::wheelEvent(event_);
+        return;
+    }
+
+    // Ctrl + wheel zooms around the cursor
+    const double scale  = transform().m11();
+    const double target = std::clamp(scale * std::pow(zoom_per_degree, event_->angleDelta().y() / 8.0), min_scale, max_scale);
+
+    QGraphicsView::scale(target / scale, target / scale);
+
+    update_lod();
+
+    event_->accept();
+
+    emit viewportChanged();
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::paintEvent(QPaintEvent* event_)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QGraphicsView::paintEvent(event_);
+
+    const double frame_ms = timer.nsecsElapsed() / 1e6;
+
+    // Items in view, or points drawn in their place
+    size_t items = 1;
+    if (m_lod == eLodPoints)
+    {
+        items = 0;
+        for (const auto& it : m_point_groups)
+            items += it.points.size();
+    }
+    else if (m_item_estimate)
+        items = m_item_estimate(VisibleRect());
+
+    adapt_thresholds(frame_ms, items);
+
+    // Items must not change while the scene is being painted
+    if (wanted_lod() != m_lod)
+        QTimer::singleShot(0, this, [this]() { update_lod(); });
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::drawForeground(QPainter* pPainter_, const QRectF& rect_)
+{
+    QGraphicsView::drawForeground(pPainter_, rect_);
+
+    if (m_lod != eLodPoints)
+        return;
+
+    pPainter_->save();
+
+    QPen pen(QColor(Qt::lightGray));
+    pen.setCosmetic(true);
+
+    pPainter_->setPen(pen);
+    pPainter_->drawLines(m_point_lines.data(), (int)m_point_lines.size());
+
+    pen.setWidth(point_px);
+
+    for (const auto& it : m_point_groups)
+    {
+        pen.setColor(it.color);
+        pPainter_->setPen(pen);
+        pPainter_->drawPoints(it.points);
+    }
+
+    pPainter_->restore();
+}
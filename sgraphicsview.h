@@ -4,6 +4,9 @@
 #include <QWidget>
 #include <QGraphicsView>
 
+#include <functional>
+#include <vector>
+
 namespace Ui {
 class SGraphicsView;
 }
@@ -13,11 +16,67 @@ class SGraphicsView : public QGraphicsView
     Q_OBJECT
 
 public:
+    // Level of detail, from the most to the least detailed
+    enum ELod { eLodFull, eLodNoLabels, eLodPoints };
+
+    // Nodes of one status colour drawn as points at eLodPoints
+    struct SPointGroup
+    {
+        QColor              color;
+        QPolygonF           points;
+    };
+
     explicit SGraphicsView(QWidget *parent = 0);
     ~SGraphicsView();
 
+    // Part of the scene currently shown
+    QRectF VisibleRect() const;
+
+    ELod Lod() const { return m_lod; }
+
+    // Replaces the items while at eLodPoints
+    void SetPointCloud(std::vector<SPointGroup> groups_, std::vector<QLineF> lines_);
+
+    // Links closer than this (in scene units) are drawn as one line at
+    // eLodPoints. Follows the zoom in powers of two.
+    double AggregationCell() const;
+
+    // Cheap estimate of the items in a scene rectangle, so that frames
+    // without any do not tune the thresholds. Every frame counts without it.
+    void SetItemEstimate(std::function<size_t(const QRectF&)> estimate_) { m_item_estimate = std::move(estimate_); }
+
+signals:
+    // The visible part of the scene moved, grew or shrank
+    void viewportChanged();
+
+    // Level of detail switched, emitted outside of painting
+    void lodChanged(int lod_);
+
+protected:
+    void scrollContentsBy(int dx_, int dy_) override;
+    void resizeEvent(QResizeEvent* event_) override;
+    void wheelEvent(QWheelEvent* event_) override;
+    void paintEvent(QPaintEvent* event_) override;
+    void drawForeground(QPainter* pPainter_, const QRectF& rect_) override;
+
 private:
+    ELod wanted_lod() const;
+    void update_lod();
+    void adapt_thresholds(double frame_ms_, size_t items_);
+
     Ui::SGraphicsView *ui;
+
+    ELod                        m_lod {eLodFull};
+
+    // Zoom below which labels, resp. items are dropped; tuned by frame time
+    double                      m_label_scale;
+    double                      m_point_scale;
+    double                      m_frame_ms {};
+
+    std::vector<SPointGroup>    m_point_groups;
+    std::vector<QLineF>         m_point_lines;
+
+    std::function<size_t(const QRectF&)>    m_item_estimate;
 };
 
 #endif // SGRAPHICSVIEW_H
@@ -0,0 +1,256 @@
+#include "spatial.h"
+
+#include <algorithm>
+#include <cmath>
+
+//----------------------------------------------------------------------
+GridIndex::TCell GridIndex::cell(double x_, double y_) const
+{
+    return key((int64_t)std::floor(x_ / m_cell), (int64_t)std::floor(y_ / m_cell));
+}
+
+//----------------------------------------------------------------------
+void GridIndex::Clear()
+{
+    m_cells.clear();
+    m_where.clear();
+
+    m_left = m_top = m_right = m_bottom = 0.0;
+}
+
+//----------------------------------------------------------------------
+void GridIndex::Insert(const TNodeId& id_, double x_, double y_)
+{
+    const TCell target = cell(x_, y_);
+
+    if (m_where.empty())
+    {
+        m_left  = m_right  = x_;
+        m_top   = m_bottom = y_;
+    }
+    else
+    {
+        m_left   = std::min(m_left,   x_);
+        m_right  = std::max(m_right,  x_);
+        m_top    = std::min(m_top,    y_);
+        m_bottom = std::max(m_bottom, y_);
+    }
+
+    auto it = m_where.find(id_);
+    if (it != m_where.end())
+    {
+        if (it->second == target)
+            return;
+
+        Remove(id_);
+    }
+
+    m_where[id_] = target;
+    m_cells[target].push_back(id_);
+}
+
+//----------------------------------------------------------------------
+void GridIndex::Remove(const TNodeId& id_)
+{
+    auto it = m_where.find(id_);
+    if (it == m_where.end())
+        return;
+
+    auto itCell = m_cells.find(it->second);
+    if (itCell != m_cells.end())
+    {
+        std::vector<TNodeId>& ids = itCell->second;
+
+        auto itId = std::find(ids.begin(), ids.end(), id_);
+        if (itId != ids.end())
+        {
+            *itId = std::move(ids.back());
+            ids.pop_back();
+        }
+
+        if (ids.empty())
+            m_cells.erase(itCell);
+    }
+
+    m_where.erase(it);
+}
+
+//----------------------------------------------------------------------
+template <class TVisit>
+void GridIndex::for_cells(double left_, double top_, double right_, double bottom_, TVisit visit_) const
+{
+    const int64_t cx0 = (int64_t)std::floor(left_   / m_cell);
+    const int64_t cy0 = (int64_t)std::floor(top_    / m_cell);
+    const int64_t cx1 = (int64_t)std::floor(right_  / m_cell);
+    const int64_t cy1 = (int64_t)std::floor(bottom_ / m_cell);
+
+    const double covered = double(cx1 - cx0 + 1) * double(cy1 - cy0 + 1);
+
+    // Zoomed far out it is cheaper to walk the occupied cells
+    if (covered > (double)m_cells.size())
+    {
+        for (const auto& it : m_cells)
+        {
+            const int64_t cx = (int32_t)(it.first >> 32);
+            const int64_t cy = (int32_t)(it.first & 0xffffffff);
+
+            if (cx >= cx0 && cx <= cx1 && cy >= cy0 && cy <= cy1)
+                visit_(it.second);
+        }
+
+        return;
+    }
+
+    for (int64_t cx = cx0; cx <= cx1; ++cx)
+        for (int64_t cy = cy0; cy <= cy1; ++cy)
+        {
+            auto it = m_cells.find(key(cx, cy));
+            if (it != m_cells.end())
+                visit_(it->second);
+        }
+}
+
+//----------------------------------------------------------------------
+std::vector<TNodeId> GridIndex::Query(double left_, double top_, double right_, double bottom_) const
+{
+    std::vector<TNodeId> result;
+
+    for_cells(left_, top_, right_, bottom_, [&result](const std::vector<TNodeId>& ids_) {
+        result.insert(result.end(), ids_.begin(), ids_.end());
+    });
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+size_t GridIndex::Count(double left_, double top_, double right_, double bottom_) const
+{
+    size_t result = 0;
+
+    for_cells(left_, top_, right_, bottom_, [&result](const std::vector<TNodeId>& ids_) {
+        result += ids_.size();
+    });
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+template <class TVisit>
+bool BoxGridIndex::for_cells(const SBox& box_, TVisit visit_) const
+{
+    const int64_t cx0 = (int64_t)std::floor(box_.left   / m_cell);
+    const int64_t cy0 = (int64_t)std::floor(box_.top    / m_cell);
+    const int64_t cx1 = (int64_t)std::floor(box_.right  / m_cell);
+    const int64_t cy1 = (int64_t)std::floor(box_.bottom / m_cell);
+
+    if ((cx1 - cx0 + 1) * (cy1 - cy0 + 1) > max_cells)
+        return false;
+
+    for (int64_t cx = cx0; cx <= cx1; ++cx)
+        for (int64_t cy = cy0; cy <= cy1; ++cy)
+            visit_(key(cx, cy));
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+void BoxGridIndex::Clear()
+{
+    m_cells.clear();
+    m_boxes.clear();
+    m_large.clear();
+}
+
+//----------------------------------------------------------------------
+void BoxGridIndex::Insert(const TLinkId& id_, double left_, double top_, double right_, double bottom_)
+{
+    Remove(id_);
+
+    const SBox box { left_, top_, right_, bottom_ };
+    m_boxes.emplace(id_, box);
+
+    auto& cells = m_cells;
+    if (!for_cells(box, [&cells, &id_](TCell cell_) { cells[cell_].push_back(id_); }))
+        m_large.insert(id_);
+}
+
+//----------------------------------------------------------------------
+void BoxGridIndex::Remove(const TLinkId& id_)
+{
+    auto it = m_boxes.find(id_);
+    if (it == m_boxes.end())
+        return;
+
+    if (!m_large.erase(id_))
+    {
+        auto& cells = m_cells;
+        for_cells(it->second, [&cells, &id_](TCell cell_) {
+            auto itCell = cells.find(cell_);
+            if (itCell == cells.end())
+                return;
+
+            std::vector<TLinkId>& ids = itCell->second;
+
+            auto itId = std::find(ids.begin(), ids.end(), id_);
+            if (itId != ids.end())
+            {
+                *itId = std::move(ids.back());
+                ids.pop_back();
+            }
+
+            if (ids.empty())
+                cells.erase(itCell);
+        });
+    }
+
+    m_boxes.erase(it);
+}
+
+//----------------------------------------------------------------------
+std::vector<TLinkId> BoxGridIndex::Query(double left_, double top_, double right_, double bottom_) const
+{
+    std::unordered_set<TLinkId> found;
+
+    auto add = [&](const TLinkId& id_) {
+        auto it = m_boxes.find(id_);
+        if (it != m_boxes.end() && it->second.Overlaps(left_, top_, right_, bottom_))
+            found.insert(id_);
+    };
+
+    const int64_t cx0 = (int64_t)std::floor(left_   / m_cell);
+    const int64_t cy0 = (int64_t)std::floor(top_    / m_cell);
+    const int64_t cx1 = (int64_t)std::floor(right_  / m_cell);
+    const int64_t cy1 = (int64_t)std::floor(bottom_ / m_cell);
+
+    const double covered = double(cx1 - cx0 + 1) * double(cy1 - cy0 + 1);
+
+    // Zoomed far out it is cheaper to walk the occupied cells
+    if (covered > (double)m_cells.size())
+    {
+        for (const auto& it : m_cells)
+        {
+            const int64_t cx = (int32_t)(it.first >> 32);
+            const int64_t cy = (int32_t)(it.first & 0xffffffff);
+
+            if (cx >= cx0 && cx <= cx1 && cy >= cy0 && cy <= cy1)
+                for (const auto& itId : it.second)
+                    add(itId);
+        }
+    }
+    else
+    {
+        for (int64_t cx = cx0; cx <= cx1; ++cx)
+            for (int64_t cy = cy0; cy <= cy1; ++cy)
+            {
+                auto it = m_cells.find(key(cx, cy));
+                if (it != m_cells.end())
+                    for (const auto& itId : it->second)
+                        add(itId);
+            }
+    }
+
+    for (const auto& it : m_large)
+        add(it);
+
+    return std::vector<TLinkId>(found.begin(), found.end());
+}
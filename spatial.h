@@ -0,0 +1,114 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "scheme.h"
+
+//----------------------------------------------------------------------
+// Uniform grid over node positions.
+//
+// Each node lives in the cell containing its position; a rectangle query
+// returns the nodes of all cells it overlaps, so callers may get nodes
+// up to one cell outside of the rectangle.
+class GridIndex
+{
+public:
+    explicit GridIndex(double cell_ = 256.0) : m_cell(cell_) {}
+
+    void Clear();
+
+    // Inserts the node or moves it to the new position
+    void Insert(const TNodeId& id_, double x_, double y_);
+    void Remove(const TNodeId& id_);
+
+    std::vector<TNodeId> Query(double left_, double top_, double right_, double bottom_) const;
+
+    // Number of nodes Query() would return, without copying them
+    size_t Count(double left_, double top_, double right_, double bottom_) const;
+
+    size_t Size() const { return m_where.size(); }
+
+    // Bounding box of everything inserted since the last Clear()
+    bool   Empty()  const { return m_where.empty(); }
+    double Left()   const { return m_left;   }
+    double Top()    const { return m_top;    }
+    double Right()  const { return m_right;  }
+    double Bottom() const { return m_bottom; }
+
+private:
+    typedef uint64_t TCell;
+
+    TCell cell(double x_, double y_) const;
+
+    // Calls visit_ with the nodes of every occupied cell the rectangle overlaps
+    template <class TVisit>
+    void for_cells(double left_, double top_, double right_, double bottom_, TVisit visit_) const;
+
+    static TCell key(int64_t cx_, int64_t cy_)
+    {
+        return (uint64_t(uint32_t(cx_)) << 32) | uint32_t(cy_);
+    }
+
+    double                                          m_cell;
+    std::unordered_map<TCell, std::vector<TNodeId>> m_cells;
+    std::unordered_map<TNodeId, TCell>              m_where;
+
+    double m_left {}, m_top {}, m_right {}, m_bottom {};
+};
+
+//----------------------------------------------------------------------
+// Uniform grid over the bounding boxes of links.
+//
+// A box is kept in every cell it overlaps. Boxes over more than
+// max_cells cells are kept aside and checked by every query, so a long
+// link costs one entry instead of a cell for every part of the scheme
+// it spans.
+class BoxGridIndex
+{
+public:
+    explicit BoxGridIndex(double cell_ = 256.0) : m_cell(cell_) {}
+
+    void Clear();
+
+    // Inserts the box or moves it
+    void Insert(const TLinkId& id_, double left_, double top_, double right_, double bottom_);
+    void Remove(const TLinkId& id_);
+
+    // Every box overlapping the rectangle, once
+    std::vector<TLinkId> Query(double left_, double top_, double right_, double bottom_) const;
+
+private:
+    typedef uint64_t TCell;
+
+    static const int64_t max_cells = 64;
+
+    struct SBox
+    {
+        double left, top, right, bottom;
+
+        bool Overlaps(double left_, double top_, double right_, double bottom_) const
+        {
+            return left <= right_ && left_ <= right && top <= bottom_ && top_ <= bottom;
+        }
+    };
+
+    static TCell key(int64_t cx_, int64_t cy_)
+    {
+        return (uint64_t(uint32_t(cx_)) << 32) | uint32_t(cy_);
+    }
+
+    // Calls visit_ with the key of every cell the box overlaps, false if
+    // the box is too large for cells
+    template <class TVisit>
+    bool for_cells(const SBox& box_, TVisit visit_) const;
+
+    double                                          m_cell;
+    std::unordered_map<TCell, std::vector<TLinkId>> m_cells;
+    std::unordered_map<TLinkId, SBox>               m_boxes;
+    std::unordered_set<TLinkId>                     m_large;
+};
+
+#endif // SPATIAL_H
@@ -0,0 +1,68 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#include "test.h"
+#include "catalog.h"
+
+//----------------------------------------------------------------------
+static TCategoryList load_catalog(const std::string& folder_)
+{
+    TCategoryList result;
+
+    std::error_code err;
+    for (const auto& it : std::filesystem::directory_iterator(folder_, err))
+        if (it.is_regular_file())
+            result[it.path().filename().string()] = LoadDevList(it.path().string());
+
+    if (err)
+        Log("Failed to read " + folder_ + ": " + err.message());
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+// Runs every test, the first failed check ends the run.
+//
+// Usage: verifier_test [--data <folder>]
+
+int main(int argc, char* argv[])
+{
+    std::string data_folder = "../data/";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--data") && i + 1 < argc)
+            data_folder = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: verifier_test [--data <folder>]\n");
+            return 2;
+        }
+    }
+
+    const TCategoryList catalog = load_catalog(data_folder);
+    if (catalog.empty())
+    {
+        fprintf(stderr, "No catalog found in %s\n", data_folder.c_str());
+        return 1;
+    }
+
+    try
+    {
+        test_schemediff();
+        test_undo();
+        test_bindall();
+        test_fd();
+        test_catalogrules(catalog);
+        test_schemeio(catalog);
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "%s", e.what());
+        return 1;
+    }
+
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef VERIFIER_TEST_H
+#define VERIFIER_TEST_H
+
+#include <stdexcept>
+#include <string>
+
+#include "scheme.h"
+
+//----------------------------------------------------------------------
+// Asserts of the Qt-free core, in the manner of LibBoolEE/test.cpp: a
+// failed check throws and the run stops there.
+
+#define CPP_TEST(expr) \
+    if(!(expr)){ \
+        throw std::runtime_error(std::string(#expr) + " does not hold at " + __FILE__ + ":" + std::to_string(__LINE__) + "\n"); \
+    };
+
+//----------------------------------------------------------------------
+// Device with the given ports and rule, placed at x_
+inline SDevice test_device(const TDevId& id_, std::vector<std::string> inputs_, const std::string& rule_ = "", int x_ = 0)
+{
+    SDevice dev;
+    dev.id      = id_;
+    dev.name    = id_;
+    dev.rule    = rule_;
+    dev.gnode.x = x_;
+
+    for (const auto& it : inputs_)
+        dev.inputs.push_back(SInput(it));
+
+    return dev;
+}
+
+void test_schemediff();
+void test_undo();
+void test_bindall();
+void test_fd();
+void test_catalogrules(const TCategoryList& catalog_);
+void test_schemeio(const TCategoryList& catalog_);
+
+#endif // VERIFIER_TEST_H
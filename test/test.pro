@@ -0,0 +1,54 @@
+#-------------------------------------------------
+#
+# Asserts of the Qt-free core
+#
+#-------------------------------------------------
+
+TARGET = verifier_test
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= qt app_bundle
+
+QMAKE_CXXFLAGS += -std=c++17
+
+INCLUDEPATH += ..
+
+unix:!macx: LIBS += -lstdc++fs
+
+LIBS += -lz
+
+SOURCES += \
+        main.cpp \
+        test_schemediff.cpp \
+        test_undo.cpp \
+        test_bindall.cpp \
+        test_fd.cpp \
+        test_catalogrules.cpp \
+        test_schemeio.cpp \
+    ../schemediff.cpp \
+    ../undo.cpp \
+    ../bindall.cpp \
+    ../catalog.cpp \
+    ../rule.cpp \
+    ../catalogrules.cpp \
+    ../schemeio.cpp \
+    ../schemecompress.cpp \
+    ../portreach.cpp \
+    ../LibBoolEE/LibBoolEE.cpp \
+    ../profiler.cpp
+
+HEADERS += \
+        test.h \
+    ../scheme.h \
+    ../undo.h \
+    ../schemediff.h \
+    ../bindall.h \
+    ../catalog.h \
+    ../rule.h \
+    ../catalogrules.h \
+    ../schemeio.h \
+    ../schemecompress.h \
+    ../portreach.h \
+    ../LibBoolEE/LibBoolEE.h \
+    ../profiler.h
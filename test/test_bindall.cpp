@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <random>
+#include <set>
+
+#include "test.h"
+#include "bindall.h"
+
+//----------------------------------------------------------------------
+// Size of a maximum matching by trying every set of right vertices
+static int brute_force_matching(const HopcroftKarp::TAdjacency& adj_, int right_count_)
+{
+    std::vector<int> best(size_t(1) << right_count_, 0);
+
+    for (const auto& edges : adj_)
+    {
+        std::vector<int> next = best;
+
+        for (uint32_t used = 0; used < best.size(); ++used)
+            for (int v : edges)
+                if (!(used & (uint32_t(1) << v)))
+                    next[used | (uint32_t(1) << v)] = std::max(next[used | (uint32_t(1) << v)], best[used] + 1);
+
+        best.swap(next);
+    }
+
+    return *std::max_element(best.begin(), best.end());
+}
+
+//----------------------------------------------------------------------
+// Edges of adj_ only, every right vertex at most once
+static int matching_size(const HopcroftKarp::TAdjacency& adj_, int right_count_, const std::vector<int>& match_)
+{
+    if (match_.size() != adj_.size())
+        return -1;
+
+    std::vector<bool> used(right_count_);
+    int size = 0;
+
+    for (size_t u = 0; u < adj_.size(); ++u)
+    {
+        if (match_[u] == -1)
+            continue;
+
+        if (std::find(adj_[u].begin(), adj_[u].end(), match_[u]) == adj_[u].end() || used[match_[u]])
+            return -1;
+
+        used[match_[u]] = true;
+        ++size;
+    }
+
+    return size;
+}
+
+//----------------------------------------------------------------------
+// Maximum matchings of random graphs, from scratch and warm started, and
+// the bindings planned on them
+void test_bindall()
+{
+    std::mt19937 rng(7);
+
+    for (int round = 0; round < 500; ++round)
+    {
+        const int left_count  = 1 + rng() % 8;
+        const int right_count = 1 + rng() % 8;
+        const int density     = 1 + rng() % 4;
+
+        HopcroftKarp::TAdjacency adj(left_count);
+        for (auto& edges : adj)
+            for (int v = 0; v < right_count; ++v)
+                if (rng() % 5 < (unsigned)density)
+                    edges.push_back(v);
+
+        const int best = brute_force_matching(adj, right_count);
+
+        std::vector<int> match = HopcroftKarp::Run(adj, right_count);
+        CPP_TEST(matching_size(adj, right_count, match) == best);
+
+        // A greedy start from the back keeps its vertices matched
+        std::vector<int> start(left_count, -1);
+        std::vector<bool> used(right_count);
+
+        for (int u = left_count - 1; u >= 0; --u)
+            for (int v : adj[u])
+                if (!used[v])
+                {
+                    start[u] = v;
+                    used[v] = true;
+                    break;
+                }
+
+        match = HopcroftKarp::Run(adj, right_count, start);
+        CPP_TEST(matching_size(adj, right_count, match) == best);
+
+        for (int u = 0; u < left_count; ++u)
+            CPP_TEST(start[u] == -1 || match[u] != -1);
+    }
+
+    TCategoryList catalog;
+    catalog["connections"]["hdmi"] = test_device("hdmi", { "a:hdmi_f", "b:hdmi_m" }, "a | b");
+
+    PortReach reach;
+    reach.Build(catalog);
+
+    // The hub can feed both screens, once each
+    {
+        TNodeList nodes;
+        nodes["hub"]  = test_device("hub",    { "a:hdmi_m", "b:hdmi_m", "c:hdmi_m" });
+        nodes["tv1"]  = test_device("screen", { "a:hdmi_f", "b:hdmi_f" });
+        nodes["tv2"]  = test_device("screen", { "a:hdmi_f" });
+
+        std::vector<SBinding> bindings = PlanBindAll(nodes, { "hub", "tv1", "tv2" }, reach);
+        CPP_TEST(bindings.size() == 2);
+
+        std::set<std::pair<TNodeId, TNodeId>> pairs;
+        std::set<std::pair<TNodeId, int>>     ports;
+
+        for (const auto& it : bindings)
+        {
+            CPP_TEST(pairs.insert(std::minmax(it.lnode, it.rnode)).second);
+            CPP_TEST(ports.insert( { it.lnode, it.linput } ).second);
+            CPP_TEST(ports.insert( { it.rnode, it.rinput } ).second);
+        }
+    }
+
+    // The only free port goes to the node whose rule needs it
+    {
+        TNodeList nodes;
+        nodes["hub"]  = test_device("hub",    { "a:hdmi_m" });
+        nodes["tv1"]  = test_device("screen", { "a:hdmi_f" });
+        nodes["tv2"]  = test_device("screen", { "a:hdmi_f" }, "a");
+
+        std::vector<SBinding> bindings = PlanBindAll(nodes, { "hub", "tv1", "tv2" }, reach);
+        CPP_TEST(bindings.size() == 1);
+        CPP_TEST(bindings[0].lnode == "tv2" || bindings[0].rnode == "tv2");
+    }
+}
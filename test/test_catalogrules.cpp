@@ -0,0 +1,46 @@
+#include "test.h"
+#include "catalogrules.h"
+#include "rule.h"
+
+//----------------------------------------------------------------------
+// The generated tables of the stock catalog agree with LibBoolEE for
+// every mask of connected inputs
+void test_catalogrules(const TCategoryList& catalog_)
+{
+    size_t stock = 0;
+
+    for (const auto& itCategory : catalog_)
+        for (const auto& itDev : itCategory.second)
+        {
+            SDevice dev = itDev.second;
+
+            // Every catalog device is in the tables until data/ changes
+            const SCatalogRule* pRule = FindCatalogRule(dev);
+            CPP_TEST(pRule || dev.rule.empty());
+            if (!pRule)
+                continue;
+
+            ++stock;
+
+            for (uint32_t on = 0; on < (uint32_t(1) << dev.inputs.size()); ++on)
+            {
+                for (size_t i = 0; i < dev.inputs.size(); ++i)
+                    dev.inputs[i].connect.node = (on >> i) & 1 ? "test" : "";
+
+                CPP_TEST(pRule->Eval(on) == ResolveRule(dev));
+                CPP_TEST(ResolveCatalogRule(dev) == ResolveRule(dev));
+            }
+
+            // Edited devices are not stock any more
+            SDevice edited = dev;
+            edited.rule = "!(" + dev.rule + ")";
+            CPP_TEST(!FindCatalogRule(edited));
+            CPP_TEST(ResolveCatalogRule(edited) == ResolveRule(edited));
+
+            edited = dev;
+            edited.inputs.push_back(SInput("z:test"));
+            CPP_TEST(!FindCatalogRule(edited));
+        }
+
+    CPP_TEST(stock > 0);
+}
@@ -0,0 +1,130 @@
+#include <cstdlib>
+#include <random>
+
+#include <fcntl.h>
+
+#include "test.h"
+
+#include "nop/utility/fd_reader.h"
+#include "nop/utility/fd_writer.h"
+
+//----------------------------------------------------------------------
+static int temp_file()
+{
+    char name[] = "/tmp/verifier_test_XXXXXX";
+
+    const int fd = ::mkstemp(name);
+    if (fd >= 0)
+        ::unlink(name);
+
+    return fd;
+}
+
+//----------------------------------------------------------------------
+// Buffered writes and reads of pieces smaller than, across and larger
+// than a small buffer give back the same bytes
+void test_fd()
+{
+    static const size_t capacity = 16;
+
+    std::mt19937 rng(11);
+
+    std::vector<uint8_t> data(4096);
+    for (auto& it : data)
+        it = (uint8_t)rng();
+
+    // Piece sizes: single bytes, ranges that fit, cross or bypass the buffer
+    std::vector<size_t> pieces;
+    for (size_t total = 0; total < data.size(); )
+    {
+        static const size_t sizes[] = { 1, 1, 3, 7, 15, 16, 17, 40 };
+
+        const size_t size = std::min(sizes[rng() % 8], data.size() - total);
+        pieces.push_back(size);
+        total += size;
+    }
+
+    const int fd = temp_file();
+    CPP_TEST(fd >= 0);
+
+    {
+        nop::BufferedFdWriter writer(::dup(fd), capacity);
+
+        size_t offset = 0;
+        for (size_t size : pieces)
+        {
+            CPP_TEST(writer.Prepare(size));
+
+            if (size == 1)
+            {
+                CPP_TEST(writer.Write(data[offset]));
+            }
+            else
+            {
+                CPP_TEST(writer.Write(&data[offset], &data[offset] + size));
+            }
+
+            CPP_TEST(writer.pending() <= capacity);
+            offset += size;
+        }
+
+        // Padding across the buffer end
+        CPP_TEST(writer.Skip(capacity + 5, 0xab));
+        CPP_TEST(writer.Flush());
+        CPP_TEST(writer.pending() == 0);
+    }
+
+    CPP_TEST(::lseek(fd, 0, SEEK_END) == off_t(data.size() + capacity + 5));
+
+    // Unbuffered back, the writer wrote in order
+    {
+        std::vector<uint8_t> written(data.size() + capacity + 5);
+
+        CPP_TEST(::lseek(fd, 0, SEEK_SET) == 0);
+        nop::FdReader reader(::dup(fd));
+        CPP_TEST(reader.Read(written.data(), written.data() + written.size()));
+
+        CPP_TEST(std::equal(data.begin(), data.end(), written.begin()));
+        CPP_TEST(std::all_of(written.begin() + data.size(), written.end(), [](uint8_t byte_) { return byte_ == 0xab; }));
+    }
+
+    // Buffered back in other pieces
+    {
+        CPP_TEST(::lseek(fd, 0, SEEK_SET) == 0);
+        nop::BufferedFdReader reader(::dup(fd), capacity);
+
+        std::vector<uint8_t> read(data.size());
+
+        size_t offset = 0;
+        for (size_t i = pieces.size(); i-- > 0 && offset < read.size(); )
+        {
+            const size_t size = std::min(pieces[i], read.size() - offset);
+
+            CPP_TEST(reader.Ensure(size));
+            CPP_TEST(reader.available() >= std::min(size, capacity));
+
+            if (size == 1)
+            {
+                CPP_TEST(reader.Read(&read[offset]));
+            }
+            else
+            {
+                CPP_TEST(reader.Read(&read[offset], &read[offset] + size));
+            }
+
+            offset += size;
+        }
+
+        CPP_TEST(offset == read.size() && read == data);
+
+        // The padding is skipped up to its last byte
+        uint8_t last = 0;
+        CPP_TEST(reader.Skip(capacity + 4));
+        CPP_TEST(reader.Read(&last) && last == 0xab);
+
+        auto status = reader.Read(&last);
+        CPP_TEST(!status && status.error() == nop::ErrorStatus::ReadLimitReached);
+    }
+
+    ::close(fd);
+}
@@ -0,0 +1,121 @@
+#include "test.h"
+#include "schemediff.h"
+
+//----------------------------------------------------------------------
+static const SMergeConflict* find_conflict(const SMergeResult& result_, SMergeConflict::EKind kind_, const std::string& id_)
+{
+    for (const auto& it : result_.conflicts)
+        if (it.kind == kind_ && it.id == id_)
+            return &it;
+
+    return nullptr;
+}
+
+//----------------------------------------------------------------------
+// Three-way merges: changes of one side are taken, conflicts go to ours
+// and are listed, links left with one end are dropped with its binding
+void test_schemediff()
+{
+    TNodeList base_nodes;
+    TLinkList base_links;
+
+    base_nodes["a"] = test_device("hub",   { "a:x", "b:x" });
+    base_nodes["b"] = test_device("pc",    { "a:x" });
+    base_nodes["c"] = test_device("pc",    { "a:x" });
+    base_nodes["d"] = test_device("pc",    { "a:x" });
+    base_nodes["e"] = test_device("pc",    { "a:x" });
+
+    // Diff of a move and a new link
+    {
+        TNodeList nodes = base_nodes;
+        TLinkList links = base_links;
+
+        nodes["d"].gnode.x = 100;
+        Bind(nodes, links, "l", "a", 1, "e", 0);
+
+        SDelta delta = DiffSchemes(base_nodes, base_links, nodes, links);
+
+        CPP_TEST(delta.nodes.size() == 3);
+        CPP_TEST(delta.links.size() == 1 && !delta.links[0].before.has_value());
+        CPP_TEST(NodeChanges(delta.nodes[0]) == eNodeBindings);
+        CPP_TEST(NodeChanges(delta.nodes[1]) == eNodeMoved);
+        CPP_TEST(DiffSchemes(nodes, links, nodes, links).Empty());
+    }
+
+    // Changes of different nodes merge cleanly
+    {
+        TNodeList our_nodes = base_nodes, their_nodes = base_nodes;
+        TLinkList our_links = base_links, their_links = base_links;
+
+        our_nodes["b"].gnode.x = 10;
+        their_nodes["c"].gnode.x = 20;
+        their_nodes["f"] = test_device("pc", { "a:x" });
+        our_nodes.erase("e");
+
+        SMergeResult result = MergeSchemes(base_nodes, base_links, our_nodes, our_links, their_nodes, their_links);
+
+        CPP_TEST(result.conflicts.empty());
+        CPP_TEST(result.nodes.at("b").gnode.x == 10);
+        CPP_TEST(result.nodes.at("c").gnode.x == 20);
+        CPP_TEST(result.nodes.count("f") == 1);
+        CPP_TEST(result.nodes.count("e") == 0);
+    }
+
+    // Both sides moved the node, one removed a node the other moved
+    {
+        TNodeList our_nodes = base_nodes, their_nodes = base_nodes;
+
+        our_nodes["b"].gnode.x = 10;
+        their_nodes["b"].gnode.x = 20;
+        our_nodes.erase("d");
+        their_nodes["d"].gnode.x = 30;
+
+        SMergeResult result = MergeSchemes(base_nodes, base_links, our_nodes, base_links, their_nodes, base_links);
+
+        CPP_TEST(result.conflicts.size() == 2);
+        CPP_TEST(find_conflict(result, SMergeConflict::ePosition, "b"));
+        CPP_TEST(find_conflict(result, SMergeConflict::eNode, "d"));
+        CPP_TEST(result.nodes.at("b").gnode.x == 10);
+        CPP_TEST(result.nodes.count("d") == 0);
+    }
+
+    // The same input bound differently: ours stays, their link is left
+    // with one end and goes together with the binding of that end
+    {
+        TNodeList our_nodes = base_nodes, their_nodes = base_nodes;
+        TLinkList our_links = base_links, their_links = base_links;
+
+        Bind(our_nodes, our_links, "l1", "a", 0, "b", 0);
+        Bind(their_nodes, their_links, "l2", "a", 0, "c", 0);
+
+        SMergeResult result = MergeSchemes(base_nodes, base_links, our_nodes, our_links, their_nodes, their_links);
+
+        const SMergeConflict* pBinding = find_conflict(result, SMergeConflict::eBinding, "a");
+        CPP_TEST(pBinding && pBinding->input == 0);
+        CPP_TEST(pBinding->ours.node == "b" && pBinding->theirs.node == "c");
+        CPP_TEST(find_conflict(result, SMergeConflict::eDangling, "l2"));
+        CPP_TEST(result.conflicts.size() == 2);
+
+        CPP_TEST(result.links.size() == 1 && result.links.count("l1"));
+        CPP_TEST(result.nodes.at("a").inputs[0].connect.link == "l1");
+        CPP_TEST(result.nodes.at("b").inputs[0].connect.node == "a");
+        CPP_TEST(!result.nodes.at("c").inputs[0].IsOn());
+    }
+
+    // Our definition change drops the bindings their side made to the node
+    {
+        TNodeList our_nodes = base_nodes, their_nodes = base_nodes;
+        TLinkList their_links = base_links;
+
+        our_nodes["a"] = test_device("switch", { "a:x", "b:x", "c:x" });
+        Bind(their_nodes, their_links, "l3", "a", 1, "d", 0);
+
+        SMergeResult result = MergeSchemes(base_nodes, base_links, our_nodes, base_links, their_nodes, their_links);
+
+        CPP_TEST(find_conflict(result, SMergeConflict::eDangling, "l3"));
+        CPP_TEST(result.links.empty());
+        CPP_TEST(result.nodes.at("a").id == "switch");
+        CPP_TEST(!result.nodes.at("a").inputs[1].IsOn());
+        CPP_TEST(!result.nodes.at("d").inputs[0].IsOn());
+    }
+}
@@ -0,0 +1,134 @@
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#include "test.h"
+#include "schemeio.h"
+#include "schemecompress.h"
+#include "schemediff.h"
+
+//----------------------------------------------------------------------
+// Catalog devices with random positions and bindings, and one device
+// changed from the catalog
+static void make_scheme(const TCategoryList& catalog_, int count_, TNodeList& nodes_, TLinkList& links_)
+{
+    std::mt19937 rng(5);
+
+    std::vector<const SDevice*> devices;
+    for (const auto& itCategory : catalog_)
+        for (const auto& itDev : itCategory.second)
+            devices.push_back(&itDev.second);
+
+    std::vector<std::pair<TNodeId, int>> free;
+
+    for (int i = 0; i < count_; ++i)
+    {
+        const TNodeId id = "node" + std::to_string(i);
+
+        SDevice& dev = nodes_[id] = *devices[rng() % devices.size()];
+        dev.gnode.x = rng() % 10000;
+        dev.gnode.y = rng() % 10000;
+        dev.capacity = 0.0;
+
+        for (int input = 0; input < (int)dev.inputs.size(); ++input)
+            free.push_back( { id, input } );
+    }
+
+    SDevice& custom = nodes_["node0"];
+    custom.name += " (custom)";
+    custom.inputs.push_back(SInput("z:custom"));
+    free.push_back( { "node0", (int)custom.inputs.size() - 1 } );
+
+    std::shuffle(free.begin(), free.end(), rng);
+
+    for (size_t i = 0; i + 1 < free.size(); i += 3)
+        if (free[i].first != free[i + 1].first)
+            Bind(nodes_, links_, "link" + std::to_string(i), free[i].first, free[i].second, free[i + 1].first, free[i + 1].second);
+}
+
+//----------------------------------------------------------------------
+static bool loads_back(const std::string& file_name_, const TCategoryList& catalog_, const TNodeList& nodes_, const TLinkList& links_, const std::string* pDictionary_ = nullptr)
+{
+    TNodeList nodes;
+    TLinkList links;
+
+    return LoadScheme(file_name_, nodes, links, &catalog_, pDictionary_) && DiffSchemes(nodes_, links_, nodes, links).Empty();
+}
+
+//----------------------------------------------------------------------
+static std::string read_file(const std::string& file_name_)
+{
+    std::ifstream file(file_name_, std::ios::binary);
+
+    std::ostringstream content;
+    content << file.rdbuf();
+
+    return content.str();
+}
+
+//----------------------------------------------------------------------
+// Schemes saved in either format, compressed or not, load back the same
+void test_schemeio(const TCategoryList& catalog_)
+{
+    const std::string file_name = (std::filesystem::temp_directory_path() / "verifier_test.sch").string();
+
+    TNodeList nodes;
+    TLinkList links;
+    make_scheme(catalog_, 5000, nodes, links);
+
+    CPP_TEST(links.size() > 500);
+
+    CPP_TEST(SaveScheme(file_name, nodes, links));
+    CPP_TEST(!IsCompactScheme(file_name));
+    CPP_TEST(loads_back(file_name, catalog_, nodes, links));
+
+    const auto legacy_size = std::filesystem::file_size(file_name);
+    std::vector<std::string> samples { read_file(file_name) };
+
+    // The changed device goes to the dictionary of the file
+    CPP_TEST(SaveCompactScheme(file_name, catalog_, nodes, links));
+    CPP_TEST(IsCompactScheme(file_name));
+    CPP_TEST(loads_back(file_name, catalog_, nodes, links));
+    CPP_TEST(std::filesystem::file_size(file_name) < legacy_size / 2);
+    samples.push_back(read_file(file_name));
+
+    // Compressed files span several blocks of the deflate writer
+    CPP_TEST(legacy_size > 2 * DeflateFdWriter::block_size);
+
+    SCompression compression;
+
+    CPP_TEST(SaveScheme(file_name, nodes, links, &compression));
+    CPP_TEST(IsCompressedScheme(file_name) && !IsCompactScheme(file_name, nullptr));
+    CPP_TEST(loads_back(file_name, catalog_, nodes, links));
+    CPP_TEST(std::filesystem::file_size(file_name) < legacy_size / 2);
+
+    CPP_TEST(SaveCompactScheme(file_name, catalog_, nodes, links, &compression));
+    CPP_TEST(IsCompressedScheme(file_name) && !IsCompactScheme(file_name) && IsCompactScheme(file_name, nullptr));
+    CPP_TEST(loads_back(file_name, catalog_, nodes, links));
+
+    // A preset dictionary has to be the one the file was written with
+    compression.dictionary = TrainSchemeDictionary(samples);
+    CPP_TEST(!compression.dictionary.empty());
+
+    const std::string other = TrainSchemeDictionary( { samples[1] }, 1024);
+
+    for (bool compact : { false, true })
+    {
+        CPP_TEST(compact ? SaveCompactScheme(file_name, catalog_, nodes, links, &compression)
+                         : SaveScheme(file_name, nodes, links, &compression));
+        CPP_TEST(IsCompactScheme(file_name, &compression.dictionary) == compact);
+        CPP_TEST(loads_back(file_name, catalog_, nodes, links, &compression.dictionary));
+
+        TNodeList loaded_nodes;
+        TLinkList loaded_links;
+        CPP_TEST(!LoadScheme(file_name, loaded_nodes, loaded_links, &catalog_));
+        CPP_TEST(!LoadScheme(file_name, loaded_nodes, loaded_links, &catalog_, &other));
+    }
+
+    // Empty schemes too
+    CPP_TEST(SaveCompactScheme(file_name, catalog_, TNodeList(), TLinkList()));
+    CPP_TEST(loads_back(file_name, catalog_, TNodeList(), TLinkList()));
+
+    std::filesystem::remove(file_name);
+}
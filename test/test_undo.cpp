@@ -0,0 +1,124 @@
+#include "test.h"
+#include "undo.h"
+#include "schemediff.h"
+
+//----------------------------------------------------------------------
+static bool same_scheme(const TNodeList& l_nodes_, const TLinkList& l_links_, const TNodeList& r_nodes_, const TLinkList& r_links_)
+{
+    return DiffSchemes(l_nodes_, l_links_, r_nodes_, r_links_).Empty();
+}
+
+//----------------------------------------------------------------------
+// Edits collected by SchemeEdit, undone and redone by ApplyDelta, and the
+// stacks of UndoStack
+void test_undo()
+{
+    TNodeList nodes;
+    TLinkList links;
+
+    nodes["a"] = test_device("hub", { "a:x", "b:x" });
+    nodes["b"] = test_device("pc",  { "a:x" }, "", 100);
+    nodes["c"] = test_device("pc",  { "a:x" }, "", 200);
+    Bind(nodes, links, "l1", "a", 0, "b", 0);
+
+    const TNodeList base_nodes = nodes;
+    const TLinkList base_links = links;
+
+    // A new node bound to a free input
+    SchemeEdit edit;
+    edit.TouchNode("d", nodes);
+    edit.TouchNodeDeep("a", nodes, links);
+    edit.TouchLink("l2", links);
+
+    nodes["d"] = test_device("pc", { "a:x" }, "", 300);
+    Bind(nodes, links, "l2", "a", 1, "d", 0);
+
+    SDelta added = edit.Finish(nodes, links);
+
+    const TNodeList added_nodes = nodes;
+    const TLinkList added_links = links;
+
+    CPP_TEST(added.nodes.size() == 3 && added.links.size() == 2);
+
+    ApplyDelta(added, true, nodes, links);
+    CPP_TEST(same_scheme(nodes, links, base_nodes, base_links));
+
+    ApplyDelta(added, false, nodes, links);
+    CPP_TEST(same_scheme(nodes, links, added_nodes, added_links));
+
+    // A removed node takes its links and the bindings of its partners
+    edit.TouchNodeDeep("a", nodes, links);
+
+    for (const auto& it : nodes["a"].inputs)
+    {
+        nodes[it.connect.node].inputs[it.connect.input].connect.Reset();
+        links.erase(it.connect.link);
+    }
+    nodes.erase("a");
+
+    SDelta removed = edit.Finish(nodes, links);
+
+    const TNodeList removed_nodes = nodes;
+    const TLinkList removed_links = links;
+
+    CPP_TEST(removed.nodes.size() == 3 && removed.links.size() == 2);
+    CPP_TEST(links.empty());
+
+    ApplyDelta(removed, true, nodes, links);
+    CPP_TEST(same_scheme(nodes, links, added_nodes, added_links));
+
+    ApplyDelta(added, true, nodes, links);
+    CPP_TEST(same_scheme(nodes, links, base_nodes, base_links));
+
+    ApplyDelta(added, false, nodes, links);
+    ApplyDelta(removed, false, nodes, links);
+    CPP_TEST(same_scheme(nodes, links, removed_nodes, removed_links));
+
+    // Positions are the scene's own unless the delta carries them
+    ApplyDelta(removed, true, nodes, links);
+    nodes["b"].gnode.x = 150;
+
+    ApplyDelta(added, true, nodes, links);
+    CPP_TEST(nodes["b"].gnode.x == 150);
+
+    added.positions = true;
+    ApplyDelta(added, true, nodes, links);
+    CPP_TEST(nodes["b"].gnode.x == 100);
+
+    // A link made and taken back within one edit leaves no state
+    edit.TouchNodeDeep("c", nodes, links);
+    edit.TouchLink("l3", links);
+    Bind(nodes, links, "l3", "a", 1, "c", 0);
+    nodes["a"].inputs[1].connect.Reset();
+    nodes["c"].inputs[0].connect.Reset();
+    links.erase("l3");
+
+    SDelta vanished = edit.Finish(nodes, links);
+    CPP_TEST(vanished.links.empty());
+
+    // Undo and redo move deltas between the stacks, a push drops the
+    // undone ones and the oldest beyond the depth
+    UndoStack stack(2);
+    CPP_TEST(!stack.CanUndo() && !stack.CanRedo());
+
+    stack.Push(SDelta());
+    CPP_TEST(!stack.CanUndo());
+
+    stack.Push(SDelta(added));
+    stack.Push(SDelta(removed));
+
+    const SDelta* pUndone = stack.Undo();
+    CPP_TEST(pUndone && pUndone->nodes.size() == removed.nodes.size() && pUndone->links.size() == removed.links.size());
+    CPP_TEST(stack.CanUndo() && stack.CanRedo());
+
+    const SDelta* pRedone = stack.Redo();
+    CPP_TEST(pRedone && pRedone->links.size() == removed.links.size());
+    CPP_TEST(!stack.CanRedo());
+
+    stack.Undo();
+    stack.Push(SDelta(added));
+    CPP_TEST(!stack.CanRedo());
+
+    stack.Push(SDelta(removed));
+    CPP_TEST(stack.Undo() && stack.Undo() && !stack.Undo());
+}
@@ -0,0 +1,239 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "scheme.h"
+#include "catalog.h"
+#include "rule.h"
+
+//----------------------------------------------------------------------
+// Generator of the rule tables compiled into the verifier.
+//
+//  rulegen <catalog folder> <catalogrules.inc> [--max-inputs <count>]
+//
+//      Writes the truth table of every device rule in the catalog, see
+//      catalogrules.h. Each table is checked against LibBoolEE for every
+//      mask of inputs. Devices with more than --max-inputs inputs (16 by
+//      default, 8 KB per table), and rules the two disagree on, are left
+//      out and stay on LibBoolEE. The file is only written when its
+//      contents change, so the build does not redo work for nothing.
+//
+//  Run it on data/ whenever the catalog changes. Errors exit with 2.
+
+//----------------------------------------------------------------------
+struct SOptions
+{
+    std::string catalog;
+    std::string out;
+    int         max_inputs  = 16;
+};
+
+//----------------------------------------------------------------------
+typedef std::vector<uint64_t> TTable;
+
+//----------------------------------------------------------------------
+struct SEntry
+{
+    std::string rule;
+    uint32_t    inputs;
+    uint32_t    table;
+};
+
+//----------------------------------------------------------------------
+// Table of the rule over every mask of the device inputs, none if the
+// compiled rule and LibBoolEE disagree on any of them
+static std::optional<TTable> build_table(const SDevice& dev_)
+{
+    auto rule = Rule::Compile(dev_.rule);
+    if (!rule.has_value())
+        return std::nullopt;
+
+    const uint32_t inputs = (uint32_t)dev_.inputs.size();
+
+    // A rule over inputs the device does not have is an error LibBoolEE reports
+    if (rule->Vars() >> inputs)
+        return std::nullopt;
+
+    TTable table(((uint32_t(1) << inputs) + 63) / 64);
+
+    SDevice dev = dev_;
+
+    try
+    {
+        for (uint32_t on = 0; on < (uint32_t(1) << inputs); ++on)
+        {
+            for (uint32_t i = 0; i < inputs; ++i)
+                dev.inputs[i].connect.node = on & (uint32_t(1) << i) ? "rulegen" : "";
+
+            const bool holds = rule->Eval(on);
+            if (holds != ResolveRule(dev))
+                return std::nullopt;
+
+            if (holds)
+                table[on >> 6] |= uint64_t(1) << (on & 63);
+        }
+    }
+    catch (const std::runtime_error&)
+    {
+        return std::nullopt;
+    }
+
+    return table;
+}
+
+//----------------------------------------------------------------------
+static std::string quoted(const std::string& string_)
+{
+    std::string result = "\"";
+
+    for (char c : string_)
+    {
+        if (c == '"' || c == '\\')
+            result += '\\';
+        result += c;
+    }
+
+    return result + "\"";
+}
+
+//----------------------------------------------------------------------
+static bool parse_options(int argc, char* argv[], SOptions& options_)
+{
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool has_value = i + 1 < argc;
+
+        if (!strcmp(argv[i], "--max-inputs") && has_value) options_.max_inputs = atoi(argv[++i]);
+        else if (!strncmp(argv[i], "--", 2))
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return false;
+        }
+        else
+            args.push_back(argv[i]);
+    }
+
+    if (args.size() != 2 || options_.max_inputs < 1 || options_.max_inputs > 24)
+        return false;
+
+    options_.catalog = args[0];
+    options_.out     = args[1];
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    SOptions options;
+    if (!parse_options(argc, argv, options))
+    {
+        fprintf(stderr, "Usage: rulegen <catalog folder> <catalogrules.inc> [--max-inputs <count>]\n");
+        return 2;
+    }
+
+    // Sorted by device id, the order the verifier searches in
+    std::map<TDevId, SEntry> entries;
+    std::map<TTable, uint32_t> tables;
+    TTable bits;
+
+    int skipped = 0;
+
+    std::error_code err;
+    for (const auto& itFile : std::filesystem::directory_iterator(options.catalog, err))
+    {
+        if (!itFile.is_regular_file())
+            continue;
+
+        for (const auto& itDev : LoadDevList(itFile.path().string()))
+        {
+            const SDevice& dev = itDev.second;
+
+            if (dev.rule.empty() || entries.count(itDev.first))
+                continue;
+
+            auto table = dev.inputs.size() <= (size_t)options.max_inputs ? build_table(dev) : std::nullopt;
+            if (!table.has_value())
+            {
+                Log("Left to LibBoolEE: " + dev.name + " (" + itDev.first + ")");
+                ++skipped;
+                continue;
+            }
+
+            // Many devices share a rule and an input count
+            auto itTable = tables.find(table.value());
+            if (itTable == tables.end())
+            {
+                itTable = tables.emplace(table.value(), (uint32_t)bits.size()).first;
+                bits.insert(bits.end(), table->begin(), table->end());
+            }
+
+            entries[itDev.first] = { dev.rule, (uint32_t)dev.inputs.size(), itTable->second };
+        }
+    }
+
+    if (err)
+    {
+        Log("Failed to read " + options.catalog + ": " + err.message());
+        return 2;
+    }
+
+    if (entries.empty())
+    {
+        Log("No device rules in " + options.catalog);
+        return 2;
+    }
+
+    std::ostringstream out;
+
+    out << "// Generated by tools/rulegen from the catalog, do not edit.\n"
+           "// Run it again whenever data/ changes, see catalogrules.h.\n\n"
+           "// Truth tables, bit m of a table tells whether the rule holds with the\n"
+           "// inputs in mask m connected\n"
+           "static constexpr uint64_t catalog_rule_bits[] =\n"
+           "{";
+
+    for (size_t i = 0; i < bits.size(); ++i)
+    {
+        char word[24];
+        snprintf(word, sizeof(word), "0x%016llxull", (unsigned long long)bits[i]);
+        out << (i % 4 ? " " : "\n    ") << word << (i + 1 < bits.size() ? "," : "");
+    }
+
+    out << "\n};\n\n"
+           "static constexpr SCatalogRule catalog_rules[] =\n"
+           "{\n";
+
+    for (const auto& it : entries)
+        out << "    { " << quoted(it.first) << ", " << quoted(it.second.rule) << ", " << it.second.inputs << ", " << it.second.table << " },\n";
+
+    out << "};\n";
+
+    std::string current;
+    {
+        std::ifstream file(options.out, std::ios::binary);
+        current.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    if (current != out.str())
+    {
+        std::ofstream file(options.out, std::ios::binary | std::ios::trunc);
+        if (!(file << out.str()))
+        {
+            Log("Failed to write " + options.out);
+            return 2;
+        }
+    }
+
+    fprintf(stderr, "%zu devices, %zu tables, %zu words, %d left to LibBoolEE\n", entries.size(), tables.size(), bits.size(), skipped);
+
+    return 0;
+}
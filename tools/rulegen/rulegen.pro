@@ -0,0 +1,30 @@
+#-------------------------------------------------
+#
+# Generator of the rule tables of the stock
+# catalog compiled into the verifier
+#
+#-------------------------------------------------
+
+TARGET = rulegen
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= qt app_bundle
+
+QMAKE_CXXFLAGS += -std=c++17
+
+INCLUDEPATH += ../..
+
+unix:!macx: LIBS += -lstdc++fs
+
+SOURCES += \
+        main.cpp \
+    ../../catalog.cpp \
+    ../../rule.cpp \
+    ../../LibBoolEE/LibBoolEE.cpp
+
+HEADERS += \
+    ../../scheme.h \
+    ../../catalog.h \
+    ../../rule.h \
+    ../../LibBoolEE/LibBoolEE.h
@@ -0,0 +1,93 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "scheme.h"
+#include "schemecompress.h"
+
+//----------------------------------------------------------------------
+// Trainer of the preset dictionary for compressed schemes.
+//
+//  schemedict --out <file.dict> [--size N] <file.sch>...
+//
+//      Picks the most repeated segments of the given uncompressed
+//      schemes into a dictionary of at most N bytes (32768 by default,
+//      the deflate window). It is shipped as scheme.dict next to the
+//      data folder; a compressed scheme can only be read with the
+//      dictionary it was written with, so keep the old one around once
+//      schemes were saved with it.
+
+//----------------------------------------------------------------------
+struct SOptions
+{
+    std::string                 out;
+    size_t                      size    = 32 * 1024;
+    std::vector<std::string>    samples;
+};
+
+//----------------------------------------------------------------------
+static bool parse_options(int argc, char* argv[], SOptions& options_)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool has_value = i + 1 < argc;
+
+        if      (!strcmp(argv[i], "--out")  && has_value) options_.out  = argv[++i];
+        else if (!strcmp(argv[i], "--size") && has_value) options_.size = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strncmp(argv[i], "--", 2))
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return false;
+        }
+        else
+            options_.samples.push_back(argv[i]);
+    }
+
+    return !options_.out.empty() && options_.size > 0 && !options_.samples.empty();
+}
+
+//----------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    SOptions options;
+    if (!parse_options(argc, argv, options))
+    {
+        fprintf(stderr, "Usage: schemedict --out <file.dict> [--size N] <file.sch>...\n");
+        return 1;
+    }
+
+    std::vector<std::string> samples;
+
+    for (const auto& it : options.samples)
+    {
+        if (IsCompressedScheme(it))
+        {
+            Log("Skipped compressed " + it);
+            continue;
+        }
+
+        std::ifstream file(it, std::ios::binary);
+        if (!file)
+        {
+            Log("Failed to read " + it);
+            continue;
+        }
+
+        samples.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    const std::string dictionary = TrainSchemeDictionary(samples, options.size);
+
+    fprintf(stderr, "Samples: %zu, dictionary: %zu bytes\n", samples.size(), dictionary.size());
+
+    if (dictionary.empty() || !SaveSchemeDictionary(options.out, dictionary))
+    {
+        Log("Failed to write " + options.out);
+        return 1;
+    }
+
+    return 0;
+}
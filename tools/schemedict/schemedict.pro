@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# Trainer of the preset dictionary for
+# compressed schemes
+#
+#-------------------------------------------------
+
+TARGET = schemedict
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= qt app_bundle
+
+QMAKE_CXXFLAGS += -std=c++17
+
+INCLUDEPATH += ../..
+
+LIBS += -lz
+
+SOURCES += \
+        main.cpp \
+    ../../schemecompress.cpp
+
+HEADERS += \
+    ../../scheme.h \
+    ../../schemecompress.h
@@ -0,0 +1,237 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "scheme.h"
+#include "catalog.h"
+#include "schemediff.h"
+#include "schemeio.h"
+#include "schemecompress.h"
+
+//----------------------------------------------------------------------
+// Comparison and three-way merge of schemes, for version control.
+//
+//  schemediff diff <before.sch> <after.sch> [--catalog <folder>] [--dictionary <file.dict>]
+//
+//      Lists the nodes and links that differ, one per line:
+//          + node <id> <device>        - node <id> <device>
+//          ~ node <id> <device> [device] [moved]
+//              input <name>: <node>/<link> -> <node>/<link>
+//          + link <id> <node> <node>   - link <id> <node> <node>
+//      Exits with 0 when the schemes are the same, 1 when they differ.
+//
+//  schemediff merge <base.sch> <ours.sch> <theirs.sch> --out <file.sch> [--catalog <folder>] [--dictionary <file.dict>]
+//
+//      Takes the changes of both sides since base. Where both changed
+//      the same thing ours wins and the conflict is listed:
+//          ! <kind> <id> [input <name>: ours <node>/<link>, theirs <node>/<link>]
+//      Exits with 0 on a clean merge, 1 with conflicts. The result is
+//      saved compact when a catalog is given, in the legacy format
+//      otherwise.
+//
+//  The catalog is needed to read compact schemes, the dictionary to read
+//  schemes compressed with one. Errors exit with 2.
+
+//----------------------------------------------------------------------
+struct SOptions
+{
+    std::string                 mode;
+    std::vector<std::string>    files;
+    std::string                 out;
+    std::string                 catalog;
+    std::string                 dictionary;
+};
+
+//----------------------------------------------------------------------
+struct SScheme
+{
+    TNodeList nodes;
+    TLinkList links;
+};
+
+//----------------------------------------------------------------------
+static bool load_catalog(const std::string& folder_, TCategoryList& catalog_)
+{
+    std::error_code err;
+    for (const auto& it : std::filesystem::directory_iterator(folder_, err))
+        if (it.is_regular_file())
+            catalog_[it.path().filename().string()] = LoadDevList(it.path().string());
+
+    if (err)
+    {
+        Log("Failed to read " + folder_ + ": " + err.message());
+        return false;
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+static std::string describe(const SConnect& connect_)
+{
+    return connect_.link.empty() ? std::string("-") : connect_.node + "/" + connect_.link;
+}
+
+//----------------------------------------------------------------------
+static void print_node(const SDelta::SNodeState& state_)
+{
+    const int changes = NodeChanges(state_);
+
+    if (changes & (eNodeAdded | eNodeRemoved))
+    {
+        const SDevice& dev = changes & eNodeAdded ? state_.after.value() : state_.before.value();
+        printf("%c node %s %s\n", changes & eNodeAdded ? '+' : '-', state_.id.c_str(), dev.name.c_str());
+        return;
+    }
+
+    const SDevice& before = state_.before.value();
+    const SDevice& after  = state_.after .value();
+
+    printf("~ node %s %s%s%s\n", state_.id.c_str(), after.name.c_str(), changes & eNodeDevice ? " device" : "", changes & eNodeMoved ? " moved" : "");
+
+    if (!(changes & eNodeBindings) || before.inputs.size() != after.inputs.size())
+        return;
+
+    for (size_t i = 0; i < after.inputs.size(); ++i)
+    {
+        if (before.inputs[i].connect == after.inputs[i].connect)
+            continue;
+
+        printf("    input %s: %s -> %s\n", after.inputs[i].name.c_str(), describe(before.inputs[i].connect).c_str(), describe(after.inputs[i].connect).c_str());
+    }
+}
+
+//----------------------------------------------------------------------
+static void print_link(const SDelta::SLinkState& state_)
+{
+    if (state_.before.has_value())
+        printf("- link %s %s %s\n", state_.id.c_str(), state_.before->nodes[0].c_str(), state_.before->nodes[1].c_str());
+
+    if (state_.after.has_value())
+        printf("+ link %s %s %s\n", state_.id.c_str(), state_.after->nodes[0].c_str(), state_.after->nodes[1].c_str());
+}
+
+//----------------------------------------------------------------------
+static void print_conflict(const SMergeConflict& conflict_, const TNodeList& nodes_)
+{
+    static const char* kinds[] = { "node", "device", "position", "binding", "link", "dangling" };
+
+    if (conflict_.kind != SMergeConflict::eBinding)
+    {
+        printf("! %s %s\n", kinds[conflict_.kind], conflict_.id.c_str());
+        return;
+    }
+
+    auto itNode = nodes_.find(conflict_.id);
+    const std::string input = itNode != nodes_.end() && conflict_.input < (int)itNode->second.inputs.size() ? itNode->second.inputs[conflict_.input].name : std::to_string(conflict_.input);
+
+    printf("! %s %s input %s: ours %s, theirs %s\n", kinds[conflict_.kind], conflict_.id.c_str(), input.c_str(), describe(conflict_.ours).c_str(), describe(conflict_.theirs).c_str());
+}
+
+//----------------------------------------------------------------------
+static bool parse_options(int argc, char* argv[], SOptions& options_)
+{
+    if (argc < 2)
+        return false;
+
+    options_.mode = argv[1];
+
+    for (int i = 2; i < argc; ++i)
+    {
+        const bool has_value = i + 1 < argc;
+
+        if      (!strcmp(argv[i], "--out")          && has_value) options_.out          = argv[++i];
+        else if (!strcmp(argv[i], "--catalog")      && has_value) options_.catalog      = argv[++i];
+        else if (!strcmp(argv[i], "--dictionary")   && has_value) options_.dictionary   = argv[++i];
+        else if (!strncmp(argv[i], "--", 2))
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return false;
+        }
+        else
+            options_.files.push_back(argv[i]);
+    }
+
+    if (options_.mode == "diff")
+        return options_.files.size() == 2;
+
+    if (options_.mode == "merge")
+        return options_.files.size() == 3 && !options_.out.empty();
+
+    return false;
+}
+
+//----------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    SOptions options;
+    if (!parse_options(argc, argv, options))
+    {
+        fprintf(stderr, "Usage: schemediff diff <before.sch> <after.sch> [--catalog <folder>] [--dictionary <file.dict>]\n"
+                        "       schemediff merge <base.sch> <ours.sch> <theirs.sch> --out <file.sch> [--catalog <folder>] [--dictionary <file.dict>]\n");
+        return 2;
+    }
+
+    TCategoryList catalog;
+    if (!options.catalog.empty() && !load_catalog(options.catalog, catalog))
+        return 2;
+
+    std::string dictionary;
+    if (!options.dictionary.empty())
+    {
+        dictionary = LoadSchemeDictionary(options.dictionary);
+        if (dictionary.empty())
+        {
+            Log("Failed to read " + options.dictionary);
+            return 2;
+        }
+    }
+
+    const TCategoryList* pCatalog    = options.catalog   .empty() ? nullptr : &catalog;
+    const std::string*   pDictionary = options.dictionary.empty() ? nullptr : &dictionary;
+
+    std::vector<SScheme> schemes(options.files.size());
+
+    for (size_t i = 0; i < options.files.size(); ++i)
+    {
+        if (!LoadScheme(options.files[i], schemes[i].nodes, schemes[i].links, pCatalog, pDictionary))
+        {
+            Log("Failed to read " + options.files[i]);
+            return 2;
+        }
+    }
+
+    if (options.mode == "diff")
+    {
+        const SDelta delta = DiffSchemes(schemes[0].nodes, schemes[0].links, schemes[1].nodes, schemes[1].links);
+
+        for (const auto& it : delta.nodes)
+            print_node(it);
+
+        for (const auto& it : delta.links)
+            print_link(it);
+
+        return delta.Empty() ? 0 : 1;
+    }
+
+    const SMergeResult result = MergeSchemes(schemes[0].nodes, schemes[0].links,
+                                             schemes[1].nodes, schemes[1].links,
+                                             schemes[2].nodes, schemes[2].links);
+
+    for (const auto& it : result.conflicts)
+        print_conflict(it, result.nodes);
+
+    const bool saved = options.catalog.empty() ? SaveScheme(options.out, result.nodes, result.links)
+                                               : SaveCompactScheme(options.out, catalog, result.nodes, result.links);
+    if (!saved)
+    {
+        Log("Failed to write " + options.out);
+        return 2;
+    }
+
+    fprintf(stderr, "Nodes: %zu, links: %zu, conflicts: %zu\n", result.nodes.size(), result.links.size(), result.conflicts.size());
+
+    return result.conflicts.empty() ? 0 : 1;
+}
@@ -0,0 +1,36 @@
+#-------------------------------------------------
+#
+# Comparison and three-way merge of schemes
+#
+#-------------------------------------------------
+
+TARGET = schemediff
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= qt app_bundle
+
+QMAKE_CXXFLAGS += -std=c++17
+
+INCLUDEPATH += ../..
+
+unix:!macx: LIBS += -lstdc++fs
+
+LIBS += -lz
+
+SOURCES += \
+        main.cpp \
+    ../../catalog.cpp \
+    ../../schemediff.cpp \
+    ../../schemeio.cpp \
+    ../../schemecompress.cpp \
+    ../../profiler.cpp
+
+HEADERS += \
+    ../../scheme.h \
+    ../../catalog.h \
+    ../../undo.h \
+    ../../schemediff.h \
+    ../../schemeio.h \
+    ../../schemecompress.h \
+    ../../profiler.h
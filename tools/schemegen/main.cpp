@@ -0,0 +1,590 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <unordered_map>
+
+#include "scheme.h"
+#include "catalog.h"
+#include "rule.h"
+#include "portreach.h"
+#include "schemeio.h"
+#include "schemecompress.h"
+
+//----------------------------------------------------------------------
+// Seeded generator of synthetic catalogs and schemes for scale testing.
+//
+//  schemegen catalog --out <folder> [--devices N] [--categories M] [--ports P] [--seed S]
+//
+//      Writes a data folder: "connections" with P mating port families,
+//      "cables" with male-to-male cables between them and M categories
+//      sharing N devices with female ports, power and rules.
+//
+//  schemegen scheme --catalog <folder> --out <file.sch> [--nodes K]
+//                   [--density D] [--unsatisfied F] [--seed S] [--compact]
+//                   [--compress] [--dictionary <file.dict>]
+//
+//      Places devices of the catalog until the scheme has K nodes. Every
+//      new device connects the inputs its rule requires, plus each other
+//      free input with probability D, to free ports of recently placed
+//      nodes, directly when the ports mate or through a catalog cable.
+//      Required inputs nothing is left to mate with get a connection
+//      from the "connections" category whose rule holds with one end
+//      bound. Devices are left unconnected, failing their rules, as long
+//      as fewer than a fraction F of the nodes placed so far are. Cables
+//      and terminators count toward K, the scheme ends up past it by at
+//      most the few the last devices needed. The failing fraction
+//      achieved is printed: it is above F when the catalog has no
+//      terminator for some port, and below when devices left alone hold
+//      their rules anyway. The same seed always gives the same output. --compact
+//      writes the catalog-referencing format instead of the legacy one,
+//      --compress deflates the file, with the preset dictionary if given.
+
+//----------------------------------------------------------------------
+struct SOptions
+{
+    std::string mode;
+    std::string out;
+    std::string catalog;
+    int         devices     = 1000;
+    int         categories  = 10;
+    int         ports       = 20;
+    int         nodes       = 10000;
+    double      density     = 0.3;
+    double      unsatisfied = 0.05;
+    unsigned    seed        = 1;
+    bool        compact     = false;
+    bool        compress    = false;
+    std::string dictionary;
+};
+
+//----------------------------------------------------------------------
+static std::string uuid(std::mt19937& rng_)
+{
+    static const char* digits = "0123456789abcdef";
+
+    std::string result = "xxxxxxxx-xxxx-4xxx-xxxx-xxxxxxxxxxxx";
+    for (auto& it : result)
+        if (it == 'x')
+            it = digits[rng_() % 16];
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+static std::string port_name(int family_, bool female_)
+{
+    return "P" + std::to_string(family_) + (female_ ? "_F" : "_M");
+}
+
+//----------------------------------------------------------------------
+// "a & b & (c | d | e)": the first inputs are mandatory, the rest are
+// alternatives
+static std::string make_rule(int inputs_, std::mt19937& rng_)
+{
+    const int mandatory = 1 + rng_() % inputs_;
+
+    std::string rule;
+    for (int i = 0; i < mandatory; ++i)
+        rule += (i ? " & " : "") + std::string(1, ind2let(i + 1).value());
+
+    if (mandatory < inputs_)
+    {
+        rule += " & (";
+        for (int i = mandatory; i < inputs_; ++i)
+            rule += (i > mandatory ? " | " : "") + std::string(1, ind2let(i + 1).value());
+        rule += ")";
+    }
+
+    return rule;
+}
+
+//----------------------------------------------------------------------
+static bool generate_catalog(const SOptions& options_)
+{
+    std::mt19937 rng(options_.seed);
+
+    std::error_code err;
+    std::filesystem::create_directories(options_.out, err);
+    if (err)
+    {
+        Log("Failed to create " + options_.out + ": " + err.message());
+        return false;
+    }
+
+    const std::filesystem::path folder(options_.out);
+
+    {
+        std::ofstream file(folder / "connections");
+        for (int p = 0; p < options_.ports; ++p)
+        {
+            file << "id:"       << uuid(rng) << "\n";
+            file << "name:"     << port_name(p, true) << ":" << port_name(p, false) << "\n";
+            file << "input:A:"  << port_name(p, true)  << "\n";
+            file << "input:B:"  << port_name(p, false) << "\n";
+            file << "rule: A | B\n\n";
+        }
+    }
+
+    {
+        // Straight cables for every family and adapters between neighbours
+        std::ofstream file(folder / "cables");
+        for (int p = 0; p < options_.ports; ++p)
+        {
+            const int q = (p + 1) % options_.ports;
+
+            file << "id:"       << uuid(rng) << "\n";
+            file << "name:"     << port_name(p, false) << " cable\n";
+            file << "input:A:"  << port_name(p, false) << "\n";
+            file << "input:B:"  << port_name(p, false) << "\n";
+            file << "rule: A & B\n\n";
+
+            file << "id:"       << uuid(rng) << "\n";
+            file << "name:"     << port_name(p, false) << "-" << port_name(q, false) << " adapter\n";
+            file << "input:A:"  << port_name(p, false) << "\n";
+            file << "input:B:"  << port_name(q, false) << "\n";
+            file << "rule: A & B\n\n";
+        }
+    }
+
+    std::vector<std::ofstream> files;
+    for (int c = 0; c < options_.categories; ++c)
+        files.emplace_back(folder / ("category" + std::to_string(c)));
+
+    for (int i = 0; i < options_.devices; ++i)
+    {
+        std::ofstream& file = files[i % options_.categories];
+
+        const int inputs = 1 + rng() % 8;
+
+        file << "id:"   << uuid(rng) << "\n";
+        file << "name:Device " << i << "\n";
+
+        for (int j = 0; j < inputs; ++j)
+            file << "input:" << (char)toupper(ind2let(j + 1).value()) << ":" << port_name(rng() % options_.ports, true) << "\n";
+
+        file << "pwr:"  << 5 + rng() % 500 << "\n";
+        file << "rule: " << make_rule(inputs, rng) << "\n\n";
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+class SchemeGenerator
+{
+public:
+    SchemeGenerator(const TCategoryList& catalog_, const SOptions& options_) :
+        m_options(options_), m_rng(options_.seed)
+    {
+        m_reach.Build(catalog_);
+
+        std::vector<const SDevice*> connections;
+
+        for (const auto& itCategory : catalog_)
+        {
+            if (itCategory.first == "connections")
+            {
+                for (const auto& itDev : itCategory.second)
+                    connections.push_back(&itDev.second);
+                continue;
+            }
+
+            for (const auto& itDev : itCategory.second)
+            {
+                const SDevice& dev = itDev.second;
+
+                    if (dev.IsCable())
+                    m_cables.push_back(&dev);
+                else if (!dev.inputs.empty())
+                    m_devices.push_back(&dev);
+            }
+        }
+
+        // Port types each port type mates with
+        m_mates.resize(m_reach.Size());
+        for (int i = 0; i < m_reach.Size(); ++i)
+            for (int j = 0; j < m_reach.Size(); ++j)
+                if (m_reach.Mates(i, j))
+                    m_mates[i].push_back(j);
+
+        // Cable ends each port type mates with
+        m_cable_ends.resize(m_reach.Size());
+        for (const SDevice* pCable : m_cables)
+            for (int end = 0; end < 2; ++end)
+                if (auto near_type = m_reach.Index(pCable->inputs[end].Type()))
+                    for (int mate : m_mates[near_type.value()])
+                        m_cable_ends[mate].push_back( { pCable, end } );
+
+        // Connection ends that satisfy their rule alone, by the port type
+        // they mate
+        m_terminators.resize(m_reach.Size());
+        for (const SDevice* pConnection : connections)
+            for (int end = 0; end < (int)pConnection->inputs.size() && end < 32; ++end)
+            {
+                const std::optional<Rule>& rule = compiled(pConnection->rule);
+                if (!rule.has_value() || !rule->Eval(uint32_t(1) << end))
+                    continue;
+
+                if (auto near_type = m_reach.Index(pConnection->inputs[end].Type()))
+                    for (int mate : m_mates[near_type.value()])
+                        m_terminators[mate].push_back( { pConnection, end } );
+            }
+
+        m_free.resize(m_reach.Size());
+    }
+
+    bool Run(TNodeList& nodes_, TLinkList& links_)
+    {
+        if (m_devices.empty())
+        {
+            Log("No devices in the catalog");
+            return false;
+        }
+
+        m_nodes = &nodes_;
+        m_links = &links_;
+
+        // Devices placed before their partners get a second chance once
+        // settle_after more have been placed, the inputs still missing
+        // then are terminated. Cables and terminators count toward K as
+        // they come, every device not settled yet reserves a node for
+        // them, and placing resumes while settling left room.
+        static const size_t settle_after = 1000;
+
+        std::deque<int> placed;
+
+        auto settle = [&]() {
+            connect(placed.front(), false);
+            terminate(placed.front());
+            placed.pop_front();
+        };
+
+        while ((int)m_ids.size() < m_options.nodes)
+        {
+            while ((int)(m_ids.size() + placed.size()) < m_options.nodes)
+            {
+                const SDevice& device = *m_devices[m_rng() % m_devices.size()];
+
+                // Left alone, its ports are not offered to other nodes either
+                if (m_alone < m_options.unsatisfied * (m_ids.size() + 1))
+                {
+                    add_node(device, false);
+                    ++m_alone;
+                    continue;
+                }
+
+                const int node = add_node(device);
+
+                connect(node, true);
+                placed.push_back(node);
+
+                if (placed.size() > settle_after)
+                    settle();
+            }
+
+            while (!placed.empty())
+                settle();
+        }
+
+        return true;
+    }
+
+private:
+    struct SPort
+    {
+        int node;
+        int input;
+    };
+
+    // End of a cable, or of a connection used as a terminator
+    struct SCableEnd
+    {
+        const SDevice*  pCable;
+        int             end;
+    };
+
+    SDevice& dev(int node_) { return (*m_nodes)[m_ids[node_]]; }
+
+    // Uniform in [0, 1), the same for a seed on every standard library
+    double chance() { return m_rng() / 4294967296.0; }
+
+    int add_node(const SDevice& dev_, bool free_ports_ = true)
+    {
+        static const int spacing = 80;
+        static const int columns = 200;
+
+        const int node = (int)m_ids.size();
+
+        m_ids.push_back(uuid(m_rng));
+
+        SDevice& dev = (*m_nodes)[m_ids.back()] = dev_;
+        dev.gnode.x = (node % columns) * spacing;
+        dev.gnode.y = (node / columns) * spacing;
+
+        for (int i = 0; free_ports_ && i < (int)dev.inputs.size(); ++i)
+            if (auto type = m_reach.Index(dev.inputs[i].Type()))
+                m_free[type.value()].push_back( { node, i } );
+
+        return node;
+    }
+
+    // Most recent free port mating the given type on a node other than
+    // node_, stale entries are dropped on the way
+    std::optional<SPort> find_partner(int type_, int node_)
+    {
+        for (int mate : m_mates[type_])
+        {
+            std::vector<SPort>& ports = m_free[mate];
+
+            for (int i = (int)ports.size() - 1; i >= 0; --i)
+            {
+                const SPort port = ports[i];
+
+                if (dev(port.node).inputs[port.input].IsOn())
+                {
+                    ports.erase(ports.begin() + i);
+                    continue;
+                }
+
+                if (port.node != node_)
+                    return port;
+            }
+        }
+
+        return {};
+    }
+
+    void bind(const SPort& l_, const SPort& r_)
+    {
+        Bind(*m_nodes, *m_links, uuid(m_rng), m_ids[l_.node], l_.input, m_ids[r_.node], r_.input);
+    }
+
+    bool connect_input(int node_, int input_)
+    {
+        auto type = m_reach.Index(dev(node_).inputs[input_].Type());
+        if (!type.has_value())
+            return false;
+
+        if (auto partner = find_partner(type.value(), node_))
+        {
+            bind( { node_, input_ }, partner.value() );
+            return true;
+        }
+
+        // Through a cable with one end mating this port and a free port
+        // somewhere for the other end, starting at a random cable
+        const std::vector<SCableEnd>& ends = m_cable_ends[type.value()];
+        const size_t first = ends.empty() ? 0 : m_rng() % ends.size();
+
+        for (size_t i = 0; i < ends.size(); ++i)
+        {
+            const SCableEnd& end = ends[(first + i) % ends.size()];
+
+            auto far_type = m_reach.Index(end.pCable->inputs[1 - end.end].Type());
+            if (!far_type.has_value())
+                continue;
+
+            auto partner = find_partner(far_type.value(), node_);
+            if (!partner.has_value())
+                continue;
+
+            const int cable_node = add_node(*end.pCable);
+
+            bind( { node_, input_ }, { cable_node, end.end } );
+            bind( { cable_node, 1 - end.end }, partner.value() );
+
+            return true;
+        }
+
+        return false;
+    }
+
+    const std::optional<Rule>& compiled(const std::string& rule_)
+    {
+        auto itRule = m_rules.find(rule_);
+        if (itRule == m_rules.end())
+            itRule = m_rules.emplace(rule_, Rule::Compile(rule_)).first;
+
+        return itRule->second;
+    }
+
+    // Free inputs the rule still needs
+    uint32_t wanted(int node_)
+    {
+        const SDevice& device = dev(node_);
+
+        uint32_t on = 0;
+        for (int i = 0; i < (int)device.inputs.size(); ++i)
+            if (device.inputs[i].IsOn())
+                on |= uint32_t(1) << i;
+
+        if (const auto& rule = compiled(device.rule))
+            if (auto extension = rule->MinExtension(on, ((uint32_t(1) << device.inputs.size()) - 1) & ~on))
+                return extension.value();
+
+        return 0;
+    }
+
+    // Connects the inputs the rule still needs and, on the first pass,
+    // optional inputs with the configured density
+    void connect(int node_, bool optional_)
+    {
+        const uint32_t inputs = wanted(node_);
+
+        for (int i = 0; i < (int)dev(node_).inputs.size(); ++i)
+        {
+            if (dev(node_).inputs[i].IsOn())
+                continue;
+
+            if ((inputs & (uint32_t(1) << i)) || (optional_ && chance() < m_options.density))
+                connect_input(node_, i);
+        }
+    }
+
+    // Binds the inputs the rule still needs to new terminators
+    void terminate(int node_)
+    {
+        const uint32_t inputs = wanted(node_);
+
+        for (int i = 0; i < (int)dev(node_).inputs.size(); ++i)
+        {
+            if (!(inputs & (uint32_t(1) << i)))
+                continue;
+
+            auto type = m_reach.Index(dev(node_).inputs[i].Type());
+            if (!type.has_value() || m_terminators[type.value()].empty())
+                continue;
+
+            const std::vector<SCableEnd>& ends = m_terminators[type.value()];
+            const SCableEnd& end = ends[m_rng() % ends.size()];
+
+            const int terminator = add_node(*end.pCable, false);
+
+            bind( { node_, i }, { terminator, end.end } );
+        }
+    }
+
+    const SOptions&                     m_options;
+    std::mt19937                        m_rng;
+    PortReach                           m_reach;
+
+    std::vector<const SDevice*>         m_devices;
+    std::vector<const SDevice*>         m_cables;
+    std::vector<std::vector<int>>       m_mates;
+    std::vector<std::vector<SCableEnd>> m_cable_ends;   // By the port type they mate
+    std::vector<std::vector<SCableEnd>> m_terminators;  // Connection ends, likewise
+    std::vector<std::vector<SPort>>     m_free;     // Free ports by type
+    std::unordered_map<std::string, std::optional<Rule>> m_rules;
+
+    TNodeList*                          m_nodes {};
+    TLinkList*                          m_links {};
+    std::vector<TNodeId>                m_ids;
+    int                                 m_alone {};
+};
+
+//----------------------------------------------------------------------
+static bool generate_scheme(const SOptions& options_)
+{
+    TCategoryList catalog;
+
+    std::error_code err;
+    for (const auto& it : std::filesystem::directory_iterator(options_.catalog, err))
+        if (it.is_regular_file())
+            catalog[it.path().filename().string()] = LoadDevList(it.path().string());
+
+    if (err)
+    {
+        Log("Failed to read " + options_.catalog + ": " + err.message());
+        return false;
+    }
+
+    TNodeList nodes;
+    TLinkList links;
+
+    SchemeGenerator generator(catalog, options_);
+    if (!generator.Run(nodes, links))
+        return false;
+
+    int failing = 0;
+    for (const auto& it : nodes)
+        failing += ResolveRule(it.second) ? 0 : 1;
+
+    fprintf(stderr, "Nodes: %zu, links: %zu, failing rules: %d (%.1f%%, asked for %.1f%%)\n",
+            nodes.size(), links.size(), failing, nodes.empty() ? 0.0 : 100.0 * failing / nodes.size(), 100.0 * options_.unsatisfied);
+
+    SCompression compression;
+    if (!options_.dictionary.empty())
+    {
+        compression.dictionary = LoadSchemeDictionary(options_.dictionary);
+        if (compression.dictionary.empty())
+        {
+            Log("Failed to read " + options_.dictionary);
+            return false;
+        }
+    }
+
+    const SCompression* pCompression = options_.compress ? &compression : nullptr;
+
+    return options_.compact ? SaveCompactScheme(options_.out, catalog, nodes, links, pCompression) : SaveScheme(options_.out, nodes, links, pCompression);
+}
+
+//----------------------------------------------------------------------
+static bool parse_options(int argc, char* argv[], SOptions& options_)
+{
+    if (argc < 2)
+        return false;
+
+    options_.mode = argv[1];
+
+    for (int i = 2; i < argc; ++i)
+    {
+        const bool has_value = i + 1 < argc;
+
+        if      (!strcmp(argv[i], "--out")          && has_value) options_.out          = argv[++i];
+        else if (!strcmp(argv[i], "--catalog")      && has_value) options_.catalog      = argv[++i];
+        else if (!strcmp(argv[i], "--devices")      && has_value) options_.devices      = std::max(1, std::atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--categories")   && has_value) options_.categories   = std::max(1, std::atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--ports")        && has_value) options_.ports        = std::max(1, std::atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--nodes")        && has_value) options_.nodes        = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--density")      && has_value) options_.density      = std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--unsatisfied")  && has_value) options_.unsatisfied  = std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seed")         && has_value) options_.seed         = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--compact"))                   options_.compact      = true;
+        else if (!strcmp(argv[i], "--compress"))                  options_.compress     = true;
+        else if (!strcmp(argv[i], "--dictionary")   && has_value) options_.dictionary   = argv[++i];
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return false;
+        }
+    }
+
+    return !options_.out.empty() && (options_.mode != "scheme" || !options_.catalog.empty());
+}
+
+//----------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    SOptions options;
+    if (!parse_options(argc, argv, options))
+    {
+        fprintf(stderr, "Usage: schemegen catalog --out <folder> [--devices N] [--categories M] [--ports P] [--seed S]\n"
+                        "       schemegen scheme --catalog <folder> --out <file.sch> [--nodes K] [--density D] [--unsatisfied F] [--seed S]\n"
+                        "                        [--compact] [--compress] [--dictionary <file.dict>]\n");
+        return 1;
+    }
+
+    if (options.mode == "catalog")
+        return generate_catalog(options) ? 0 : 1;
+
+    if (options.mode == "scheme")
+        return generate_scheme(options) ? 0 : 1;
+
+    fprintf(stderr, "Unknown mode %s\n", options.mode.c_str());
+    return 1;
+}
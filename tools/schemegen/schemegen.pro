@@ -0,0 +1,40 @@
+#-------------------------------------------------
+#
+# Generator of synthetic catalogs and schemes
+# for scale testing
+#
+#-------------------------------------------------
+
+TARGET = schemegen
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= qt app_bundle
+
+QMAKE_CXXFLAGS += -std=c++17
+
+INCLUDEPATH += ../..
+
+unix:!macx: LIBS += -lstdc++fs
+
+LIBS += -lz
+
+SOURCES += \
+        main.cpp \
+    ../../catalog.cpp \
+    ../../rule.cpp \
+    ../../portreach.cpp \
+    ../../schemeio.cpp \
+    ../../schemecompress.cpp \
+    ../../profiler.cpp \
+    ../../LibBoolEE/LibBoolEE.cpp
+
+HEADERS += \
+    ../../scheme.h \
+    ../../catalog.h \
+    ../../rule.h \
+    ../../portreach.h \
+    ../../schemeio.h \
+    ../../schemecompress.h \
+    ../../profiler.h \
+    ../../LibBoolEE/LibBoolEE.h
@@ -0,0 +1,204 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "scheme.h"
+#include "rule.h"
+#include "schemesnapshot.h"
+
+//----------------------------------------------------------------------
+// Reader of the scheme snapshots the verifier publishes to shared memory.
+//
+//  schemesnap info <name>
+//
+//      Prints the sizes of the latest published scheme:
+//          sequence S, nodes N, inputs I, links L, power P W
+//
+//  schemesnap validate <name>
+//
+//      Checks device rules in place in the snapshot, without copying the
+//      scheme out, and lists the failing nodes:
+//          failing <node>
+//      Exits with 0 when every rule holds, 1 otherwise.
+//
+//  schemesnap watch <name> [--interval <ms>]
+//
+//      Validates every new publish until killed, one line per publish:
+//          sequence S: nodes N, links L, failing F
+//
+//  <name> is the shared memory name shown by the verifier, e.g.
+//  /systemverifier-1234. Errors exit with 2.
+
+//----------------------------------------------------------------------
+struct SOptions
+{
+    std::string mode;
+    std::string name;
+    int         interval    = 100;
+};
+
+//----------------------------------------------------------------------
+struct SSummary
+{
+    uint64_t                sequence    {};
+    uint32_t                nodes       {};
+    uint32_t                inputs      {};
+    uint32_t                links       {};
+    double                  power       {};
+    std::vector<TNodeId>    failing;
+};
+
+//----------------------------------------------------------------------
+// Compiled once per distinct rule text
+class RuleCache
+{
+public:
+    bool Holds(const SnapshotView& view_, uint32_t ind_)
+    {
+        const SSnapshotNode& node = view_.Node(ind_);
+        const uint32_t count = view_.InputsOf(node);
+
+        const std::string_view text = view_.String(node.rule);
+
+        auto it = m_rules.find(text);
+        if (it == m_rules.end())
+        {
+            m_texts.emplace_back(text);
+            it = m_rules.emplace(m_texts.back(), Rule::Compile(m_texts.back())).first;
+        }
+
+        // Rules LibBoolEE takes and the compiler does not, and devices
+        // with more inputs than a mask holds
+        if (!it->second.has_value() || count > 32)
+            return ResolveRule(view_.ToDevice(ind_));
+
+        uint32_t on = 0;
+        for (uint32_t i = 0; i < count; ++i)
+            if (view_.Input(node.first_input + i).IsOn())
+                on |= uint32_t(1) << i;
+
+        return it->second->Eval(on);
+    }
+
+private:
+    std::deque<std::string>                                     m_texts;
+    std::unordered_map<std::string_view, std::optional<Rule>>   m_rules;
+};
+
+//----------------------------------------------------------------------
+// Reads the latest publish, starting over when the publisher overwrote it
+// meanwhile
+static bool summarize(SnapshotReader& reader_, RuleCache& rules_, bool validate_, SSummary& summary_)
+{
+    while (true)
+    {
+        auto view = reader_.Begin();
+        if (!view.has_value())
+            return false;
+
+        summary_ = SSummary();
+        summary_.sequence   = view->Sequence();
+        summary_.nodes      = view->NodeCount();
+        summary_.inputs     = view->InputCount();
+        summary_.links      = view->LinkCount();
+
+        for (uint32_t i = 0; i < view->NodeCount(); ++i)
+        {
+            summary_.power += view->Node(i).power;
+
+            if (validate_ && !rules_.Holds(*view, i))
+                summary_.failing.emplace_back(view->String(view->Node(i).id));
+        }
+
+        if (reader_.Valid())
+            return true;
+    }
+}
+
+//----------------------------------------------------------------------
+static bool parse_options(int argc, char* argv[], SOptions& options_)
+{
+    if (argc < 3)
+        return false;
+
+    options_.mode = argv[1];
+    options_.name = argv[2];
+
+    for (int i = 3; i < argc; ++i)
+    {
+        const bool has_value = i + 1 < argc;
+
+        if (!strcmp(argv[i], "--interval") && has_value) options_.interval = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return false;
+        }
+    }
+
+    return (options_.mode == "info" || options_.mode == "validate" || options_.mode == "watch") && options_.interval > 0;
+}
+
+//----------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    SOptions options;
+    if (!parse_options(argc, argv, options))
+    {
+        fprintf(stderr, "Usage: schemesnap info <name>\n"
+                        "       schemesnap validate <name>\n"
+                        "       schemesnap watch <name> [--interval <ms>]\n");
+        return 2;
+    }
+
+    SnapshotReader reader;
+    if (!reader.Open(options.name))
+    {
+        Log("Failed to open " + options.name);
+        return 2;
+    }
+
+    RuleCache rules;
+    SSummary  summary;
+
+    if (options.mode == "watch")
+    {
+        uint64_t last = 0;
+
+        while (true)
+        {
+            if (reader.Sequence() != last && summarize(reader, rules, true, summary))
+            {
+                last = summary.sequence;
+
+                printf("sequence %llu: nodes %u, links %u, failing %zu\n", (unsigned long long)summary.sequence, summary.nodes, summary.links, summary.failing.size());
+                fflush(stdout);
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(options.interval));
+        }
+    }
+
+    if (!summarize(reader, rules, options.mode == "validate", summary))
+    {
+        Log("Nothing published to " + options.name);
+        return 2;
+    }
+
+    if (options.mode == "info")
+    {
+        printf("sequence %llu, nodes %u, inputs %u, links %u, power %g W\n", (unsigned long long)summary.sequence, summary.nodes, summary.inputs, summary.links, summary.power);
+        return 0;
+    }
+
+    for (const auto& it : summary.failing)
+        printf("failing %s\n", it.c_str());
+
+    return summary.failing.empty() ? 0 : 1;
+}
@@ -0,0 +1,32 @@
+#-------------------------------------------------
+#
+# Reader of the scheme snapshots published to
+# shared memory
+#
+#-------------------------------------------------
+
+TARGET = schemesnap
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= qt app_bundle
+
+QMAKE_CXXFLAGS += -std=c++17
+
+INCLUDEPATH += ../..
+
+unix:!macx: LIBS += -lstdc++fs -lrt
+
+SOURCES += \
+        main.cpp \
+    ../../schemesnapshot.cpp \
+    ../../rule.cpp \
+    ../../profiler.cpp \
+    ../../LibBoolEE/LibBoolEE.cpp
+
+HEADERS += \
+    ../../scheme.h \
+    ../../schemesnapshot.h \
+    ../../rule.h \
+    ../../profiler.h \
+    ../../LibBoolEE/LibBoolEE.h
@@ -0,0 +1,237 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "scheme.h"
+#include "catalog.h"
+#include "schemecompress.h"
+#include "verifyservice.h"
+
+//----------------------------------------------------------------------
+// Verification daemon and its command line client.
+//
+//  verifyd serve --catalog <folder> [--dictionary <file.dict>] [--socket <path>]
+//
+//      Loads the catalog once, compiles its rules and builds the port
+//      reachability, then answers requests on the socket until killed.
+//
+//  verifyd validate <file.sch>... [--socket <path>]
+//
+//      Checks device rules, UPS loads and connectivity of the schemes:
+//          <file>: OK|FAIL nodes N, links L, power P W, components C
+//              failing <node>      overloaded <ups>      island <node>
+//      Exits with 0 when every scheme is valid, 1 otherwise.
+//
+//  verifyd route <port> <port> [--socket <path>]
+//
+//      Prints the fewest catalog cables bringing the first port type to
+//      the second, one per line, nothing when they mate directly. Exits
+//      with 1 when there is no way.
+//
+//  verifyd bom <file.sch> [--format text|csv|json] [--socket <path>]
+//
+//      Prints the bill of materials of the scheme.
+//
+//  The socket is /tmp/verifyd.sock by default. Relative scheme paths are
+//  resolved by the client, the daemon may run in another folder. Errors
+//  exit with 2.
+
+//----------------------------------------------------------------------
+struct SOptions
+{
+    std::string                 mode;
+    std::vector<std::string>    args;
+    std::string                 socket      = "/tmp/verifyd.sock";
+    std::string                 catalog;
+    std::string                 dictionary;
+    BomEngine::EFormat          format      = BomEngine::eText;
+};
+
+//----------------------------------------------------------------------
+static int serve(const SOptions& options_)
+{
+    TCategoryList catalog;
+
+    std::error_code err;
+    for (const auto& it : std::filesystem::directory_iterator(options_.catalog, err))
+        if (it.is_regular_file())
+            catalog[it.path().filename().string()] = LoadDevList(it.path().string());
+
+    if (err)
+    {
+        Log("Failed to read " + options_.catalog + ": " + err.message());
+        return 2;
+    }
+
+    std::string dictionary;
+    if (!options_.dictionary.empty())
+    {
+        dictionary = LoadSchemeDictionary(options_.dictionary);
+        if (dictionary.empty())
+        {
+            Log("Failed to read " + options_.dictionary);
+            return 2;
+        }
+    }
+
+    VerifyServer server(catalog, options_.dictionary.empty() ? nullptr : &dictionary);
+
+    fprintf(stderr, "Serving %zu categories on %s\n", catalog.size(), options_.socket.c_str());
+
+    return server.Serve(options_.socket) ? 0 : 2;
+}
+
+//----------------------------------------------------------------------
+static int validate(VerifyClient& client_, const SOptions& options_)
+{
+    int result = 0;
+
+    for (const auto& it : options_.args)
+    {
+        auto status = client_.Validate(std::filesystem::absolute(it).string());
+        if (!status)
+        {
+            Log("Request failed: " + status.GetErrorMessage());
+            return 2;
+        }
+
+        const SValidation& validation = status.get();
+        if (!validation.loaded)
+        {
+            Log("Failed to read " + it);
+            result = 2;
+            continue;
+        }
+
+        printf("%s: %s nodes %d, links %d, power %g W, components %d\n", it.c_str(), validation.Valid() ? "OK" : "FAIL",
+               validation.nodes, validation.links, validation.power, validation.components);
+
+        for (const auto& itNode : validation.failing)
+            printf("    failing %s\n", itNode.c_str());
+
+        for (const auto& itNode : validation.overloaded)
+            printf("    overloaded %s\n", itNode.c_str());
+
+        for (const auto& itNode : validation.islands)
+            printf("    island %s\n", itNode.c_str());
+
+        if (!validation.Valid() && result == 0)
+            result = 1;
+    }
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+static int route(VerifyClient& client_, const SOptions& options_)
+{
+    auto status = client_.Route(options_.args[0], options_.args[1]);
+    if (!status)
+    {
+        Log("Request failed: " + status.GetErrorMessage());
+        return 2;
+    }
+
+    const SRoute& route = status.get();
+    if (!route.known)
+    {
+        Log("Unknown port type");
+        return 2;
+    }
+
+    for (const auto& it : route.cables)
+        printf("%s\n", it.c_str());
+
+    return route.reachable ? 0 : 1;
+}
+
+//----------------------------------------------------------------------
+static int bom(VerifyClient& client_, const SOptions& options_)
+{
+    auto status = client_.Bom(std::filesystem::absolute(options_.args[0]).string(), options_.format);
+    if (!status)
+    {
+        Log("Request failed: " + status.GetErrorMessage());
+        return 2;
+    }
+
+    if (!status.get().loaded)
+    {
+        Log("Failed to read " + options_.args[0]);
+        return 2;
+    }
+
+    fwrite(status.get().text.data(), 1, status.get().text.size(), stdout);
+    return 0;
+}
+
+//----------------------------------------------------------------------
+static bool parse_options(int argc, char* argv[], SOptions& options_)
+{
+    if (argc < 2)
+        return false;
+
+    options_.mode = argv[1];
+
+    for (int i = 2; i < argc; ++i)
+    {
+        const bool has_value = i + 1 < argc;
+
+        if      (!strcmp(argv[i], "--socket")       && has_value) options_.socket       = argv[++i];
+        else if (!strcmp(argv[i], "--catalog")      && has_value) options_.catalog      = argv[++i];
+        else if (!strcmp(argv[i], "--dictionary")   && has_value) options_.dictionary   = argv[++i];
+        else if (!strcmp(argv[i], "--format")       && has_value) options_.format       = BomEngine::FormatOf(std::string(".") + argv[++i]);
+        else if (!strncmp(argv[i], "--", 2))
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return false;
+        }
+        else
+            options_.args.push_back(argv[i]);
+    }
+
+    if (options_.mode == "serve")
+        return !options_.catalog.empty() && options_.args.empty();
+
+    if (options_.mode == "validate")
+        return !options_.args.empty();
+
+    if (options_.mode == "route")
+        return options_.args.size() == 2;
+
+    if (options_.mode == "bom")
+        return options_.args.size() == 1;
+
+    return false;
+}
+
+//----------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    SOptions options;
+    if (!parse_options(argc, argv, options))
+    {
+        fprintf(stderr, "Usage: verifyd serve --catalog <folder> [--dictionary <file.dict>] [--socket <path>]\n"
+                        "       verifyd validate <file.sch>... [--socket <path>]\n"
+                        "       verifyd route <port> <port> [--socket <path>]\n"
+                        "       verifyd bom <file.sch> [--format text|csv|json] [--socket <path>]\n");
+        return 2;
+    }
+
+    if (options.mode == "serve")
+        return serve(options);
+
+    VerifyClient client;
+    if (!client.Connect(options.socket))
+        return 2;
+
+    if (options.mode == "validate")
+        return validate(client, options);
+
+    if (options.mode == "route")
+        return route(client, options);
+
+    return bom(client, options);
+}
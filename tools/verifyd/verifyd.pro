@@ -0,0 +1,54 @@
+#-------------------------------------------------
+#
+# Verification daemon keeping the catalog loaded,
+# and its command line client
+#
+#-------------------------------------------------
+
+TARGET = verifyd
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= qt app_bundle
+
+QMAKE_CXXFLAGS += -std=c++17
+
+INCLUDEPATH += ../..
+
+unix:!macx: LIBS += -lstdc++fs
+
+LIBS += -lz -lpthread
+
+SOURCES += \
+        main.cpp \
+    ../../verifyservice.cpp \
+    ../../catalog.cpp \
+    ../../rule.cpp \
+    ../../catalogrules.cpp \
+    ../../portreach.cpp \
+    ../../power.cpp \
+    ../../components.cpp \
+    ../../bom.cpp \
+    ../../arenascheme.cpp \
+    ../../schemeview.cpp \
+    ../../schemeio.cpp \
+    ../../schemecompress.cpp \
+    ../../profiler.cpp \
+    ../../LibBoolEE/LibBoolEE.cpp
+
+HEADERS += \
+    ../../scheme.h \
+    ../../verifyservice.h \
+    ../../catalog.h \
+    ../../rule.h \
+    ../../catalogrules.h \
+    ../../portreach.h \
+    ../../power.h \
+    ../../components.h \
+    ../../bom.h \
+    ../../arenascheme.h \
+    ../../schemeview.h \
+    ../../schemeio.h \
+    ../../schemecompress.h \
+    ../../profiler.h \
+    ../../LibBoolEE/LibBoolEE.h
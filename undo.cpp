@@ -0,0 +1,148 @@
+#include "undo.h"
+
+#include <algorithm>
+
+//----------------------------------------------------------------------
+void SchemeEdit::TouchNode(const TNodeId& id_, const TNodeList& nodes_)
+{
+    if (id_.empty() || !m_nodes.insert(id_).second)
+        return;
+
+    auto it = nodes_.find(id_);
+    m_delta.nodes.push_back( { id_, it != nodes_.end() ? std::optional<SDevice>(it->second) : std::optional<SDevice>(), {} } );
+}
+
+//----------------------------------------------------------------------
+void SchemeEdit::TouchLink(const TLinkId& id_, const TLinkList& links_)
+{
+    if (id_.empty() || !m_links.insert(id_).second)
+        return;
+
+    auto it = links_.find(id_);
+    m_delta.links.push_back( { id_, it != links_.end() ? std::optional<SLink>(it->second) : std::optional<SLink>(), {} } );
+}
+
+//----------------------------------------------------------------------
+void SchemeEdit::TouchNodeDeep(const TNodeId& id_, const TNodeList& nodes_, const TLinkList& links_)
+{
+    TouchNode(id_, nodes_);
+
+    auto it = nodes_.find(id_);
+    if (it == nodes_.end())
+        return;
+
+    for (const auto& itInput : it->second.inputs)
+    {
+        TouchNode(itInput.connect.node, nodes_);
+        TouchLink(itInput.connect.link, links_);
+    }
+}
+
+//----------------------------------------------------------------------
+SDelta SchemeEdit::Finish(const TNodeList& nodes_, const TLinkList& links_)
+{
+    for (auto& it : m_delta.nodes)
+    {
+        auto itNode = nodes_.find(it.id);
+        if (itNode != nodes_.end())
+            it.after = itNode->second;
+    }
+
+    for (auto& it : m_delta.links)
+    {
+        auto itLink = links_.find(it.id);
+        if (itLink != links_.end())
+            it.after = itLink->second;
+    }
+
+    // Created and removed again within the edit, e.g. a binding taken back
+    auto vanished = [](const auto& state_) { return !state_.before.has_value() && !state_.after.has_value(); };
+
+    m_delta.nodes.erase(std::remove_if(m_delta.nodes.begin(), m_delta.nodes.end(), vanished), m_delta.nodes.end());
+    m_delta.links.erase(std::remove_if(m_delta.links.begin(), m_delta.links.end(), vanished), m_delta.links.end());
+
+    m_nodes.clear();
+    m_links.clear();
+
+    return std::move(m_delta);
+}
+
+//----------------------------------------------------------------------
+void ApplyDelta(const SDelta& delta_, bool undo_, TNodeList& nodes_, TLinkList& links_)
+{
+    for (const auto& it : delta_.links)
+    {
+        const std::optional<SLink>& state = undo_ ? it.before : it.after;
+
+        if (state.has_value())
+            links_[it.id] = state.value();
+        else
+            links_.erase(it.id);
+    }
+
+    for (const auto& it : delta_.nodes)
+    {
+        const std::optional<SDevice>& state = undo_ ? it.before : it.after;
+
+        if (!state.has_value())
+        {
+            nodes_.erase(it.id);
+            continue;
+        }
+
+        // Nodes still on the scene keep their current position
+        auto itNode = nodes_.find(it.id);
+        if (itNode != nodes_.end() && !delta_.positions)
+        {
+            SGraphNode gnode = itNode->second.gnode;
+            itNode->second = state.value();
+            itNode->second.gnode = gnode;
+        }
+        else
+            nodes_[it.id] = state.value();
+    }
+}
+
+//----------------------------------------------------------------------
+void UndoStack::Push(SDelta&& delta_)
+{
+    if (delta_.Empty())
+        return;
+
+    m_done.push_back(std::move(delta_));
+    m_undone.clear();
+
+    if (m_done.size() > m_depth)
+        m_done.pop_front();
+}
+
+//----------------------------------------------------------------------
+void UndoStack::Clear()
+{
+    m_done.clear();
+    m_undone.clear();
+}
+
+//----------------------------------------------------------------------
+const SDelta* UndoStack::Undo()
+{
+    if (m_done.empty())
+        return nullptr;
+
+    m_undone.push_back(std::move(m_done.back()));
+    m_done.pop_back();
+
+    return &m_undone.back();
+}
+
+//----------------------------------------------------------------------
+const SDelta* UndoStack::Redo()
+{
+    if (m_undone.empty())
+        return nullptr;
+
+    m_done.push_back(std::move(m_undone.back()));
+    m_undone.pop_back();
+
+    return &m_done.back();
+}
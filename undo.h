@@ -0,0 +1,87 @@
+#ifndef UNDO_H
+#define UNDO_H
+
+#include <deque>
+#include <unordered_set>
+
+#include "scheme.h"
+
+//----------------------------------------------------------------------
+// States of the nodes and links touched by one edit, before and after.
+// An empty state means the entity did not exist.
+struct SDelta
+{
+    struct SNodeState
+    {
+        TNodeId                 id;
+        std::optional<SDevice>  before;
+        std::optional<SDevice>  after;
+    };
+
+    struct SLinkState
+    {
+        TLinkId                 id;
+        std::optional<SLink>    before;
+        std::optional<SLink>    after;
+    };
+
+    std::vector<SNodeState> nodes;
+    std::vector<SLinkState> links;
+
+    // Node positions in the states are applied too. Edits made on the
+    // scene leave it off, their moves are the scene's own.
+    bool                    positions {};
+
+    bool Empty() const { return nodes.empty() && links.empty(); }
+};
+
+//----------------------------------------------------------------------
+// Collects a delta: every node and link an operation is about to modify
+// is touched first, the after states are taken when the edit finishes.
+class SchemeEdit
+{
+public:
+    void TouchNode(const TNodeId& id_, const TNodeList& nodes_);
+    void TouchLink(const TLinkId& id_, const TLinkList& links_);
+
+    // Node together with every link and partner node bound to it
+    void TouchNodeDeep(const TNodeId& id_, const TNodeList& nodes_, const TLinkList& links_);
+
+    SDelta Finish(const TNodeList& nodes_, const TLinkList& links_);
+
+private:
+    SDelta                      m_delta;
+    std::unordered_set<TNodeId> m_nodes;
+    std::unordered_set<TLinkId> m_links;
+};
+
+//----------------------------------------------------------------------
+// Puts the before (undo_ == true) or after states of a delta into the scheme.
+// Nodes still in the scheme keep their position unless the delta carries
+// positions.
+void ApplyDelta(const SDelta& delta_, bool undo_, TNodeList& nodes_, TLinkList& links_);
+
+//----------------------------------------------------------------------
+class UndoStack
+{
+public:
+    explicit UndoStack(size_t depth_ = 10000) : m_depth(depth_)
+    {}
+
+    void Push(SDelta&& delta_);
+    void Clear();
+
+    bool CanUndo() const { return !m_done.empty(); }
+    bool CanRedo() const { return !m_undone.empty(); }
+
+    // Delta to apply backwards / forwards, moved to the opposite stack
+    const SDelta* Undo();
+    const SDelta* Redo();
+
+private:
+    size_t              m_depth;
+    std::deque<SDelta>  m_done;
+    std::deque<SDelta>  m_undone;
+};
+
+#endif // UNDO_H
@@ -0,0 +1,415 @@
+#include "verifyservice.h"
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <set>
+#include <thread>
+
+#include "nop/rpc/simple_method_receiver.h"
+#include "nop/rpc/simple_method_sender.h"
+
+#include "components.h"
+#include "catalogrules.h"
+#include "schemeio.h"
+#include "profiler.h"
+
+//----------------------------------------------------------------------
+static bool make_address(const std::string& socket_path_, sockaddr_un& address_)
+{
+    memset(&address_, 0, sizeof(address_));
+    address_.sun_family = AF_UNIX;
+
+    if (socket_path_.size() >= sizeof(address_.sun_path))
+    {
+        Log("Socket path is too long: " + socket_path_);
+        return false;
+    }
+
+    memcpy(address_.sun_path, socket_path_.c_str(), socket_path_.size() + 1);
+    return true;
+}
+
+//----------------------------------------------------------------------
+// A socket file left by a previous run blocks the bind. It is only removed
+// when it is a socket nobody listens on, a live daemon or a file that is
+// not a socket is left alone and fails the start
+static bool remove_stale_socket(const std::string& socket_path_, const sockaddr_un& address_)
+{
+    struct stat info;
+    if (::lstat(socket_path_.c_str(), &info) < 0)
+    {
+        if (errno == ENOENT)
+            return true;
+
+        Log("Failed to check " + socket_path_ + ": " + strerror(errno));
+        return false;
+    }
+
+    if (!S_ISSOCK(info.st_mode))
+    {
+        Log(socket_path_ + " exists and is not a socket");
+        return false;
+    }
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        Log(std::string("Failed to create a socket: ") + strerror(errno));
+        return false;
+    }
+
+    const bool refused = ::connect(fd, (const sockaddr*)&address_, sizeof(address_)) < 0 && errno == ECONNREFUSED;
+    ::close(fd);
+
+    if (!refused)
+    {
+        Log("Another daemon is serving on " + socket_path_);
+        return false;
+    }
+
+    if (::unlink(socket_path_.c_str()) < 0)
+    {
+        Log("Failed to remove " + socket_path_ + ": " + strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+VerifyServer::VerifyServer(const TCategoryList& catalog_, const std::string* pDictionary_) :
+    m_catalog       (catalog_       ),
+    m_pDictionary   (pDictionary_   ),
+    m_bom           (catalog_, pDictionary_)
+{
+    PROFILE_SCOPE("verify_server");
+
+    m_reach.Build(m_catalog);
+
+    std::set<std::pair<int, int>> known;
+
+    for (const auto& itCategory : m_catalog)
+    {
+        for (const auto& itDev : itCategory.second)
+        {
+            const SDevice& dev = itDev.second;
+
+            if (dev.capacity > 0.0)
+                m_capacities[itDev.first] = dev.capacity;
+
+            if (!m_rules.count(dev.rule))
+                m_rules.emplace(dev.rule, Rule::Compile(dev.rule));
+
+            if (itCategory.first == "connections" || !dev.IsCable())
+                continue;
+
+            auto p = m_reach.Index(dev.inputs[0].Type());
+            auto q = m_reach.Index(dev.inputs[1].Type());
+            if (!p.has_value() || !q.has_value())
+                continue;
+
+            // Cables differing only in length are interchangeable here,
+            // the first one listed stands for them
+            if (!known.insert( { std::min(p.value(), q.value()), std::max(p.value(), q.value()) } ).second)
+                continue;
+
+            m_cables.push_back( { &itDev.first, { p.value(), q.value() } } );
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+bool VerifyServer::Serve(const std::string& socket_path_)
+{
+    sockaddr_un address;
+    if (!make_address(socket_path_, address) || !remove_stale_socket(socket_path_, address))
+        return false;
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        Log(std::string("Failed to create a socket: ") + strerror(errno));
+        return false;
+    }
+
+    if (::bind(fd, (const sockaddr*)&address, sizeof(address)) < 0 || ::listen(fd, SOMAXCONN) < 0)
+    {
+        Log("Failed to listen on " + socket_path_ + ": " + strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    // Clients going away mid-reply are write errors, not signals
+    ::signal(SIGPIPE, SIG_IGN);
+
+    while (true)
+    {
+        const int connection = ::accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (connection < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            Log(std::string("Failed to accept a connection: ") + strerror(errno));
+            ::close(fd);
+            return false;
+        }
+
+        std::thread([this, connection]() { serve_connection(connection); }).detach();
+    }
+}
+
+//----------------------------------------------------------------------
+void VerifyServer::serve_connection(int fd_)
+{
+    // Reader and writer close their own descriptor
+    nop::Deserializer<nop::BufferedFdReader>  deserializer  { fd_ };
+    nop::Serializer<nop::BufferedFdWriter>    serializer    { ::dup(fd_) };
+
+    auto receiver = nop::MakeSimpleMethodReceiver(&serializer, &deserializer);
+
+    auto dispatch = nop::BindInterface(
+        VerifyInterface::Validate::Bind([this](const std::string& file_name_) { return Validate(file_name_); }),
+        VerifyInterface::Route   ::Bind([this](const std::string& from_port_, const std::string& to_port_) { return Route(from_port_, to_port_); }),
+        VerifyInterface::Bom     ::Bind([this](const std::string& file_name_, int format_) { return Bom(file_name_, format_); }));
+
+    while (true)
+    {
+        auto status = dispatch(&receiver);
+        if (status)
+            status = serializer.writer().Flush();
+
+        if (!status)
+        {
+            // The client closing the connection between requests is the
+            // normal end of it
+            if (status.error() != nop::ErrorStatus::ReadLimitReached)
+                Log("Verify connection failed: " + status.GetErrorMessage());
+            return;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+bool VerifyServer::rule_holds(const SDevice& dev_) const
+{
+    // Devices with more inputs than a mask holds go through LibBoolEE
+    if (dev_.inputs.size() > 32)
+        return ResolveRule(dev_);
+
+    uint32_t on = 0;
+    for (size_t i = 0; i < dev_.inputs.size(); ++i)
+        if (dev_.inputs[i].IsOn())
+            on |= uint32_t(1) << i;
+
+    // Stock devices have their table compiled in
+    if (const SCatalogRule* pRule = FindCatalogRule(dev_))
+        return pRule->Eval(on);
+
+    auto itRule = m_rules.find(dev_.rule);
+
+    // Rules of devices made outside the catalog go through LibBoolEE
+    if (itRule == m_rules.end() || !itRule->second.has_value())
+        return ResolveRule(dev_);
+
+    return itRule->second->Eval(on);
+}
+
+//----------------------------------------------------------------------
+SValidation VerifyServer::Validate(const std::string& file_name_) const
+{
+    PROFILE_SCOPE("verify_validate");
+
+    SValidation result;
+
+    TNodeList nodes;
+    TLinkList links;
+
+    result.loaded = LoadScheme(file_name_, nodes, links, &m_catalog, m_pDictionary);
+    if (!result.loaded)
+        return result;
+
+    result.nodes = (int)nodes.size();
+    result.links = (int)links.size();
+
+    for (const auto& it : nodes)
+        if (!rule_holds(it.second))
+            result.failing.push_back(it.first);
+
+    PowerModel power;
+    power.SetCapacities(m_capacities);
+    power.Rebuild(nodes);
+
+    result.power = power.Total();
+
+    for (const auto& it : power.Ups())
+        if (it.second.Overloaded())
+            result.overloaded.push_back(it.first);
+
+    ComponentIndex components;
+    components.Rebuild(nodes, links);
+
+    result.components = components.Count();
+    if (result.components > 1)
+        result.islands = components.Islands();
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+// Breadth-first over the port type at the free end of the chain, so the
+// route found takes the fewest cables
+SRoute VerifyServer::Route(const std::string& from_port_, const std::string& to_port_) const
+{
+    SRoute result;
+
+    // The catalog stores port types lower case
+    auto from = m_reach.Index(to_lower(from_port_));
+    auto to   = m_reach.Index(to_lower(to_port_));
+
+    result.known = from.has_value() && to.has_value();
+    if (!result.known || !m_reach.Reachable(from.value(), to.value()))
+        return result;
+
+    result.reachable = true;
+
+    struct SStep
+    {
+        int prev    { -1 };
+        int cable   { -1 };
+    };
+
+    std::vector<SStep> steps(m_reach.Size());
+    std::vector<bool>  visited(m_reach.Size());
+    std::deque<int>    queue { from.value() };
+
+    visited[from.value()] = true;
+
+    while (!queue.empty())
+    {
+        int end = queue.front();
+        queue.pop_front();
+
+        if (m_reach.Mates(end, to.value()))
+        {
+            for (; end != from.value(); end = steps[end].prev)
+                result.cables.push_back(*m_cables[steps[end].cable].pId);
+
+            std::reverse(result.cables.begin(), result.cables.end());
+            break;
+        }
+
+        for (int c = 0; c < (int)m_cables.size(); ++c)
+        {
+            for (int side = 0; side < 2; ++side)
+            {
+                const int in  = m_cables[c].port[side];
+                const int out = m_cables[c].port[1 - side];
+
+                if (visited[out] || !m_reach.Mates(end, in))
+                    continue;
+
+                visited[out] = true;
+                steps[out] = { end, c };
+                queue.push_back(out);
+            }
+        }
+    }
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+SBomReport VerifyServer::Bom(const std::string& file_name_, int format_)
+{
+    PROFILE_SCOPE("verify_bom");
+
+    SBomReport result;
+
+    TNodeList nodes;
+    TLinkList links;
+
+    result.loaded = LoadScheme(file_name_, nodes, links, &m_catalog, m_pDictionary);
+    if (!result.loaded)
+        return result;
+
+    const BomEngine::EFormat format = format_ == BomEngine::eCsv || format_ == BomEngine::eJson ? (BomEngine::EFormat)format_ : BomEngine::eText;
+
+    // The engine interns device ids as it goes
+    std::lock_guard<std::mutex> lock(m_bom_mutex);
+
+    SBom bom = m_bom.Build(nodes, links);
+    bom.source = file_name_;
+
+    result.text = m_bom.Report( { bom }, format);
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+bool VerifyClient::Connect(const std::string& socket_path_)
+{
+    sockaddr_un address;
+    if (!make_address(socket_path_, address))
+        return false;
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        Log(std::string("Failed to create a socket: ") + strerror(errno));
+        return false;
+    }
+
+    if (::connect(fd, (const sockaddr*)&address, sizeof(address)) < 0)
+    {
+        Log("Failed to connect to " + socket_path_ + ": " + strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    // Replies of a daemon that went away are write errors, not signals
+    ::signal(SIGPIPE, SIG_IGN);
+
+    m_pSerializer   = std::make_unique<nop::Serializer<nop::FdWriter>>(fd);
+    m_pDeserializer = std::make_unique<nop::Deserializer<nop::BufferedFdReader>>(::dup(fd));
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+nop::Status<SValidation> VerifyClient::Validate(const std::string& file_name_)
+{
+    if (!m_pSerializer)
+        return nop::ErrorStatus::IOError;
+
+    auto sender = nop::MakeSimpleMethodSender(m_pSerializer.get(), m_pDeserializer.get());
+    return VerifyInterface::Validate::Invoke(&sender, file_name_);
+}
+
+//----------------------------------------------------------------------
+nop::Status<SRoute> VerifyClient::Route(const std::string& from_port_, const std::string& to_port_)
+{
+    if (!m_pSerializer)
+        return nop::ErrorStatus::IOError;
+
+    auto sender = nop::MakeSimpleMethodSender(m_pSerializer.get(), m_pDeserializer.get());
+    return VerifyInterface::Route::Invoke(&sender, from_port_, to_port_);
+}
+
+//----------------------------------------------------------------------
+nop::Status<SBomReport> VerifyClient::Bom(const std::string& file_name_, BomEngine::EFormat format_)
+{
+    if (!m_pSerializer)
+        return nop::ErrorStatus::IOError;
+
+    auto sender = nop::MakeSimpleMethodSender(m_pSerializer.get(), m_pDeserializer.get());
+    return VerifyInterface::Bom::Invoke(&sender, file_name_, (int)format_);
+}
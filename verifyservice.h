@@ -0,0 +1,144 @@
+#ifndef VERIFYSERVICE_H
+#define VERIFYSERVICE_H
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+#include "nop/serializer.h"
+#include "nop/rpc/interface.h"
+#include "nop/utility/fd_reader.h"
+#include "nop/utility/fd_writer.h"
+
+#include "scheme.h"
+#include "portreach.h"
+#include "power.h"
+#include "rule.h"
+#include "bom.h"
+
+//----------------------------------------------------------------------
+// Verification service: a daemon that keeps the catalog loaded, its rules
+// compiled and the port reachability built, and answers requests of build
+// scripts and tools over a UNIX domain socket.
+//
+// Requests are libnop RPC: a method selector followed by the arguments,
+// answered by the return value, all nop-encoded on the stream. A client
+// may send any number of requests over one connection. Scheme files are
+// passed by path and read by the daemon, which has the catalog to resolve
+// compact schemes and the dictionary to inflate compressed ones.
+
+//----------------------------------------------------------------------
+struct SValidation
+{
+    bool                    loaded      {};
+    int                     nodes       {};
+    int                     links       {};
+    double                  power       {};
+    int                     components  {};
+    std::vector<TNodeId>    failing;        // Nodes whose rule does not hold
+    std::vector<TNodeId>    overloaded;     // UPSes loaded over capacity
+    std::vector<TNodeId>    islands;        // Nodes outside the largest component
+
+    bool Valid() const { return loaded && failing.empty() && overloaded.empty(); }
+
+    NOP_STRUCTURE(SValidation, loaded, nodes, links, power, components, failing, overloaded, islands);
+};
+
+//----------------------------------------------------------------------
+// Shortest way of bringing one port type to another
+struct SRoute
+{
+    bool                    known       {}; // Both port types are in the catalog
+    bool                    reachable   {};
+    std::vector<TDevId>     cables;         // Catalog cables in order, none when the ports mate
+
+    NOP_STRUCTURE(SRoute, known, reachable, cables);
+};
+
+//----------------------------------------------------------------------
+struct SBomReport
+{
+    bool        loaded  {};
+    std::string text;           // In the requested BomEngine::EFormat
+
+    NOP_STRUCTURE(SBomReport, loaded, text);
+};
+
+//----------------------------------------------------------------------
+class VerifyInterface : public nop::Interface<VerifyInterface>
+{
+public:
+    NOP_INTERFACE("SystemVerifier.Verify");
+
+    NOP_METHOD(Validate,    SValidation(const std::string& file_name));
+    NOP_METHOD(Route,       SRoute(const std::string& from_port, const std::string& to_port));
+    NOP_METHOD(Bom,         SBomReport(const std::string& file_name, int format));
+
+    NOP_INTERFACE_API(Validate, Route, Bom);
+};
+
+//----------------------------------------------------------------------
+class VerifyServer
+{
+public:
+    // pDictionary_ may be null, both must outlive the server
+    VerifyServer(const TCategoryList& catalog_, const std::string* pDictionary_ = nullptr);
+
+    // Listens on socket_path_, replacing a stale socket file, and serves
+    // every connection on its own thread. Only returns on errors, among
+    // them a daemon already serving there and a path that is not a socket.
+    bool Serve(const std::string& socket_path_);
+
+    SValidation Validate(const std::string& file_name_) const;
+    SRoute      Route(const std::string& from_port_, const std::string& to_port_) const;
+    SBomReport  Bom(const std::string& file_name_, int format_);
+
+private:
+    struct SCable
+    {
+        const TDevId*   pId;
+        int             port[2];
+    };
+
+    void serve_connection(int fd_);
+    bool rule_holds(const SDevice& dev_) const;
+
+    const TCategoryList&                                    m_catalog;
+    const std::string*                                      m_pDictionary;
+    PortReach                                               m_reach;
+    std::vector<SCable>                                     m_cables;
+    TCapacityList                                           m_capacities;
+
+    // Compiled once per distinct catalog rule, read concurrently
+    std::unordered_map<std::string, std::optional<Rule>>    m_rules;
+
+    std::mutex                                              m_bom_mutex;
+    BomEngine                                               m_bom;
+};
+
+//----------------------------------------------------------------------
+// Blocking client of a VerifyServer, one request at a time
+class VerifyClient
+{
+public:
+    VerifyClient() = default;
+
+    VerifyClient(const VerifyClient&) = delete;
+    VerifyClient& operator=(const VerifyClient&) = delete;
+
+    bool Connect(const std::string& socket_path_);
+
+    // Errors are connection errors, the connection is unusable after them
+    nop::Status<SValidation> Validate(const std::string& file_name_);
+    nop::Status<SRoute>      Route(const std::string& from_port_, const std::string& to_port_);
+    nop::Status<SBomReport>  Bom(const std::string& file_name_, BomEngine::EFormat format_);
+
+private:
+    // Requests are small and go out unbuffered, which also sends them
+    // before the sender starts waiting for the reply
+    std::unique_ptr<nop::Serializer<nop::FdWriter>>             m_pSerializer;
+    std::unique_ptr<nop::Deserializer<nop::BufferedFdReader>>   m_pDeserializer;
+};
+
+#endif // VERIFYSERVICE_H